@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// Heap profiler, compiled in with -DSMA_ALLOC_PROFILER (every translation
+// unit, and -rdynamic for function names in the stacks). It replaces the
+// global operator new/delete to:
+//   - count allocations, frees and bytes exactly, per thread and per stage;
+//   - capture the call stack of a sample of allocations, about one per
+//     SMA_ALLOC_SAMPLE bytes allocated (default 256 KiB, 1 = every one),
+//     and attribute estimated bytes to each call site;
+//   - flag, with its stack, any allocation made inside a NoAllocScope;
+//   - when asked to (reportAllocsAtExit() or SMA_ALLOC_AT_EXIT set), print
+//     the memory still allocated at exit.
+// Without the flag the scopes below are empty and nothing is replaced.
+
+struct AllocCounters {
+    std::uint64_t allocations {};
+    std::uint64_t frees {};
+    std::uint64_t bytes {};          // allocated over the run
+    std::uint64_t live_bytes {};     // allocated and not yet freed
+    std::uint64_t sampled {};        // allocations whose stack was captured
+    std::uint64_t violations {};     // allocations inside a NoAllocScope
+};
+
+#ifdef SMA_ALLOC_PROFILER
+
+constexpr bool alloc_profiler_enabled = true;
+
+// Tags the calling thread's allocations with a stage name (a string
+// literal) until destroyed. Stages nest; the innermost wins.
+class AllocStage {
+public:
+    explicit AllocStage(const char* name);
+    ~AllocStage();
+    AllocStage(const AllocStage&) = delete;
+    AllocStage& operator=(const AllocStage&) = delete;
+
+private:
+    int previous;
+};
+
+// Marks a region of the calling thread that must not allocate, e.g. a
+// per-bar loop. Allocations inside still succeed but are reported.
+class NoAllocScope {
+public:
+    explicit NoAllocScope(const char* what);
+    ~NoAllocScope();
+    NoAllocScope(const NoAllocScope&) = delete;
+    NoAllocScope& operator=(const NoAllocScope&) = delete;
+
+private:
+    const char* previous;
+};
+
+AllocCounters allocCounters();
+// Totals, per thread, per stage, the top call sites and any violations.
+void printAllocReport(std::ostream& out, std::size_t top_sites = 10);
+// Stack sampling on or off; counting and no-alloc checks go on regardless.
+void setAllocSampling(bool on);
+void reportAllocsAtExit();
+
+#else
+
+constexpr bool alloc_profiler_enabled = false;
+
+class AllocStage {
+public:
+    explicit AllocStage(const char*) {}
+};
+
+class NoAllocScope {
+public:
+    explicit NoAllocScope(const char*) {}
+};
+
+inline AllocCounters allocCounters() { return {}; }
+void printAllocReport(std::ostream& out, std::size_t top_sites = 10);
+inline void setAllocSampling(bool) {}
+inline void reportAllocsAtExit() {}
+
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+// As-of join between timestamp columns: for each left (fine) bar, the last
+// right (coarse) bar already complete at that time. A right bar stamped t
+// counts as complete from t + lag, so daily bars stamped at midnight join
+// with lag = 86400 and never leak the day's own close into that day.
+//
+// Results are index maps into the right series (-1 before its first
+// complete bar), not copied rows; gatherAsOf() materialises a column when
+// one is needed. Both time columns must be ascending.
+
+// Resumable merge over one right series, so the left side can arrive in
+// blocks (e.g. from streamCSV) and the right side can grow between blocks.
+class AsOfCursor {
+public:
+    AsOfCursor(std::span<const std::int64_t> right, std::int64_t lag = 0) : right(right), lag(lag) {}
+
+    // Same series with bars appended (a view of the longer column).
+    void extendRight(std::span<const std::int64_t> longer) { right = longer; }
+
+    // Joins the next block of left times. Times must not go backwards
+    // across calls. out.size() must be at least left.size().
+    void join(std::span<const std::int64_t> left, std::span<std::int32_t> out);
+
+    // Right bars complete as of the last left time joined.
+    std::size_t position() const { return next; }
+
+private:
+    std::span<const std::int64_t> right;
+    std::int64_t lag {};
+    std::size_t next {}; // first right bar not yet complete
+};
+
+std::vector<std::int32_t> asOfJoin(std::span<const std::int64_t> left, std::span<const std::int64_t> right,
+                                   std::int64_t lag = 0);
+
+// Several right series against one left column, block by block so each
+// left block is read from cache once per series. result[k] is for rights[k].
+std::vector<std::vector<std::int32_t>> asOfJoin(std::span<const std::int64_t> left,
+                                                std::span<const std::span<const std::int64_t>> rights,
+                                                std::span<const std::int64_t> lags);
+
+// column[index[i]] per left bar, `missing` where the index is -1.
+std::vector<double> gatherAsOf(std::span<const double> column, std::span<const std::int32_t> index,
+                               double missing = std::numeric_limits<double>::quiet_NaN());
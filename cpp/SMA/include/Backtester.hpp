@@ -0,0 +1,111 @@
+#pragma once
+
+#include <iosfwd>
+
+#include "DataLoader.hpp"
+#include "Strategy.hpp"
+
+class MinuteStore;
+
+// Bump whenever a change alters backtest results, so cached results are not
+// reused, or the saved strategy state, so state files are not misread.
+constexpr int backtest_engine_version = 3;
+
+struct BacktestConfig {
+    double initial_cash = 10000.0;
+    double cost_bps = 0.0; // charged on every entry and exit, in basis points
+};
+
+struct BacktestResult {
+    double final_equity {};
+    double total_return {};
+    double max_drawdown {}; // fraction of the running peak, 0.25 = 25%
+    int trades {};          // number of position changes
+    int bars {};
+    int bars_in_market {};
+};
+
+// One round trip: long from the close of entry_bar to the close of exit_bar.
+struct Trade {
+    int entry_bar {};
+    int exit_bar = -1; // -1 while still open
+    double entry_price {};
+    double exit_price {};
+};
+
+// All-in / all-out account driven one bar at a time.
+// The target position is applied at the bar's close.
+class Backtester {
+public:
+    explicit Backtester(const BacktestConfig& config = {});
+
+    void onBar(double close, int target_position);
+
+    // Sells the whole position at `price` during the bar, before its close
+    // (a stop or limit order filling). Follow with onBar(close, 0).
+    void exitIntrabar(double price);
+
+    // Appends every entry to `log` and fills in its exit, from the next bar on.
+    void recordTrades(std::vector<Trade>* log) { trade_log = log; }
+
+    int position() const { return holding; }
+    double equity() const { return last_equity; }
+    BacktestResult result() const;
+
+    // Binary snapshot of the account and running metrics, for resuming a run.
+    void save(std::ostream& out) const;
+    bool load(std::istream& in);
+
+private:
+    BacktestConfig config;
+    double cash;
+    double units {};
+    int holding {};
+    double last_equity;
+    double peak;
+    double max_drawdown {};
+    int trades {};
+    int bars {};
+    int bars_in_market {};
+    std::vector<Trade>* trade_log {};
+};
+
+// Runs one SMA crossover over a whole column of closes, appending its
+// trades to `trades` if given.
+BacktestResult runSmaBacktest(const PriceView& prices, const SmaParams& params,
+                              const BacktestConfig& config = {}, std::vector<Trade>* trades = nullptr);
+
+// Runs a precomputed signal column: non-zero means long at that bar's close.
+BacktestResult runSignalBacktest(const PriceView& prices, std::span<const double> signal,
+                                 const BacktestConfig& config = {});
+
+// Resting exits for a long position, as fractions of its entry price. 0 = none.
+struct BracketExits {
+    double stop_loss {};   // sell stop at entry * (1 - stop_loss)
+    double take_profit {}; // sell limit at entry * (1 + take_profit)
+};
+
+// How a bar whose range reaches both the stop and the target is settled.
+// OHLC alone cannot say which came first.
+enum class IntrabarPolicy {
+    StopFirst, // OHLC only: assume the stop filled first, the conservative call
+    Lazy,      // OHLC where it decides; the bar's fine bars only where it does not
+    Full,      // the fine bars of every bar with a position open: the reference
+};
+
+struct IntrabarStats {
+    std::size_t bars_checked {};    // bars with exits resting
+    std::size_t ambiguous {};       // both levels inside the bar's range
+    std::size_t fine_scans {};      // bars settled from their fine bars
+    std::size_t unresolved {};      // stop assumed: no fine data, or one fine bar reached both
+    std::size_t fine_rows_read {};
+};
+
+// SMA crossover entries at the close, bracket exits filled during the bar.
+// After a bracket exit the strategy stays out until the crossover resets.
+// `fine` holds the finer bars of each `bar_seconds`-long bar, starting at
+// the bar's time; without it Lazy and Full behave as StopFirst.
+BacktestResult runBracketBacktest(const PriceView& prices, const SmaParams& params, const BracketExits& exits,
+                                  IntrabarPolicy policy, const MinuteStore* fine = nullptr,
+                                  IntrabarStats* stats = nullptr, const BacktestConfig& config = {},
+                                  std::int64_t bar_seconds = 86400);
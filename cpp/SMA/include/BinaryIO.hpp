@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+// Raw little helpers for state files. Values are written in native layout,
+// so a file is only meant to be read back on the same kind of machine.
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return static_cast<bool>(in);
+}
+
+template <typename T>
+void writeVector(std::ostream& out, const std::vector<T>& values) {
+    writeValue(out, static_cast<std::uint64_t>(values.size()));
+    out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template <typename T>
+bool readVector(std::istream& in, std::vector<T>& values, std::uint64_t max_size) {
+    std::uint64_t size {};
+    if (!readValue(in, size) || size > max_size) return false;
+    values.resize(size);
+    in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(size * sizeof(T)));
+    return static_cast<bool>(in);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct AssetPair {
+    std::uint32_t a {};
+    std::uint32_t b {};
+};
+
+// Rolling sample covariance and correlation of N series over the last
+// `window` bars, kept up to date in O(N^2) per bar (O(pairs) with a pair
+// list) by adding the new bar's outer product to running sums and taking
+// the outer product of the bar leaving the window back out.
+//
+// Cross-product sums live in a packed upper triangle. Rows are grouped in
+// blocks of four that start at the same 4-aligned column, so a block is
+// updated in one pass over the new and old bars, each load feeding four
+// rows, and the inner loops are contiguous and vectorize.
+//
+// Values are shifted by each series' first value before they are summed,
+// which keeps the sums small and the `sum xy - sum x sum y / n` form
+// accurate, and the sums are rebuilt from the window every 16 windows so
+// add/remove rounding cannot drift.
+class RollingCovariance {
+public:
+    // Every pair.
+    RollingCovariance(std::size_t assets, int window);
+    // Only `pairs`; covariance() and the matrices are not available, use
+    // pairCovariance() and pairCorrelation().
+    RollingCovariance(std::size_t assets, int window, std::vector<AssetPair> pairs);
+
+    // One value per asset, e.g. this bar's returns.
+    void update(std::span<const double> values);
+
+    bool ready() const { return count == length; }
+    std::size_t assets() const { return asset_count; }
+    int window() const { return length; }
+
+    // NaN until two bars have been seen.
+    double covariance(std::size_t i, std::size_t j) const;
+    double correlation(std::size_t i, std::size_t j) const;
+    double pairCovariance(std::size_t k) const;
+    double pairCorrelation(std::size_t k) const;
+
+    // Full N x N, row-major.
+    std::vector<double> covarianceMatrix() const;
+    std::vector<double> correlationMatrix() const;
+
+private:
+    // Adds the outer product of x and takes out that of y (both shifted, zero padded).
+    void accumulate(const double* x, const double* y);
+    void rebuild();
+    double variance(std::size_t i) const;
+    double fromSums(double cross, double sum_i, double sum_j) const;
+
+    std::size_t asset_count {};
+    std::size_t stride {};            // assets rounded up to a multiple of 4
+    int length {};
+    int count {};
+    int next {};                      // ring slot the next bar goes into
+    int since_rebuild {};
+
+    std::vector<double> shift;        // first bar, subtracted from every bar
+    std::vector<double> ring;         // window x stride, shifted, zero padded
+    std::vector<double> sums;         // per asset
+    std::vector<double> squares;      // per asset, pair mode only
+    std::vector<double> arriving;     // this bar, shifted
+    std::vector<double> zeros;
+    std::vector<double> cross;        // packed triangle, or one per pair
+    std::vector<std::size_t> row_offset;
+    std::vector<AssetPair> pairs;     // empty for every pair
+};
+
+// Sample covariance of `rows` (bars x assets, row-major) computed directly
+// with two passes. N x N, row-major. The reference for RollingCovariance.
+std::vector<double> windowCovariance(std::span<const double> rows, std::size_t assets);
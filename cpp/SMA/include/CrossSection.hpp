@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Backtester.hpp"
+
+// Per-symbol score a rotation ranks on. Higher ranks first.
+enum class ScoreKind {
+    Momentum,    // close / close `lookback` bars ago - 1
+    SmaDistance, // close / SMA(lookback) - 1
+};
+
+// Scores of N symbols whose close columns cover the same bars.
+//
+// Work goes one tile of bars at a time: each symbol's scores for the tile
+// are computed along its own column (contiguous, vectorizes), then the
+// tile is transposed so a bar's cross-section is one contiguous row for
+// the selection that follows. SMA sums carry over between consecutive
+// tiles rather than being rebuilt.
+class CrossSectionScorer {
+public:
+    CrossSectionScorer(std::vector<std::span<const double>> closes, ScoreKind kind, int lookback);
+
+    // Scores of bars [first, first + count), bar-major: out[b * symbols() + s].
+    // Bars without enough history, or with a non-positive price, score -inf.
+    void scores(std::size_t first, std::size_t count, std::span<double> out);
+
+    std::size_t symbols() const { return closes.size(); }
+    std::size_t bars() const { return bar_count; }
+
+private:
+    std::vector<std::span<const double>> closes;
+    ScoreKind kind;
+    std::size_t lookback;
+    std::size_t bar_count {};
+    std::size_t next_bar {};   // bar the running SMA sums end before
+    std::vector<double> sums;  // per symbol, closes of the `lookback` bars before next_bar
+    std::vector<double> tile;  // symbol-major scratch
+};
+
+// The k best of a cross-section (higher score first, ties to the lower
+// symbol index), kept from one bar to the next.
+//
+// A bar whose ranks barely moved costs one scan: if no outsider beats the
+// weakest member, the set stands. Otherwise only the members and the
+// outsiders that beat that member can be in the new set, and nth_element
+// runs over just those. The first bar is a full nth_element.
+class TopKSelector {
+public:
+    explicit TopKSelector(std::size_t k, bool incremental = true);
+
+    // Returns true if the membership changed.
+    bool update(std::span<const double> scores);
+
+    // Current members, in no particular order.
+    std::span<const std::uint32_t> members() const { return chosen; }
+    // Members swapped in by the last update.
+    std::size_t changed() const { return last_changed; }
+
+    std::size_t unchanged_bars {};
+    std::size_t repaired_bars {};
+    std::size_t full_bars {};
+
+private:
+    void selectFrom(std::vector<std::uint32_t>& pool, std::span<const double> scores);
+    void commit();
+
+    std::size_t k;
+    bool incremental;
+    std::vector<std::uint32_t> chosen;
+    std::vector<std::uint8_t> held;     // per symbol
+    std::vector<std::uint32_t> candidates;
+    std::size_t last_changed {};
+};
+
+struct RotationConfig {
+    ScoreKind score = ScoreKind::Momentum;
+    int lookback = 60;
+    std::size_t top_k = 20;
+    bool bottom = false;        // hold the k lowest scores instead (mean reversion)
+    bool incremental = true;
+    std::size_t tile_bars = 64;
+    BacktestConfig backtest;    // cost_bps charged on the share of the book replaced
+};
+
+struct RotationResult {
+    double final_equity {};
+    double total_return {};
+    double max_drawdown {};
+    double average_turnover {};  // share of the book replaced per bar
+    std::size_t bars {};
+    std::size_t unchanged_bars {}; // selections kept without a repair
+    std::size_t repaired_bars {};
+};
+
+// Equal-weight book of the top (or bottom) k symbols, re-ranked at every
+// close and held to the next. Symbols with a -inf score are not held.
+RotationResult runRotation(const std::vector<std::span<const double>>& closes, const RotationConfig& config);
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Generator.hpp"
+
+struct ValidationPolicy;
+struct AnomalyReport;
+
+struct PriceRow {
+    std::string date;
+    double open;
+    double high;
+    double low;
+    double close;
+    int volume;
+};
+
+// Read-only column view over price data.
+// Kernels take this so they run the same on owned vectors or on a slice.
+struct PriceView {
+    std::span<const std::int64_t> time;
+    std::span<const double> open;
+    std::span<const double> high;
+    std::span<const double> low;
+    std::span<const double> close;
+    std::span<const std::int64_t> volume;
+
+    std::size_t size() const { return close.size(); }
+    PriceView slice(std::size_t first, std::size_t count) const;
+};
+
+// Column-major price data: one vector per field, all the same length.
+struct PriceSeries {
+    std::vector<std::int64_t> time; // unix seconds, UTC
+    std::vector<double> open;
+    std::vector<double> high;
+    std::vector<double> low;
+    std::vector<double> close;
+    std::vector<std::int64_t> volume;
+
+    std::size_t size() const { return close.size(); }
+    void reserve(std::size_t n);
+    void clear();
+    void push(std::int64_t t, double o, double h, double l, double c, std::int64_t v);
+    PriceView view() const;
+};
+
+// A run of consecutive bars as they come off the parser.
+struct PriceBlock {
+    std::size_t first_row {}; // index of bars[0] in the whole file
+    PriceSeries bars;
+};
+
+// One parsed CSV line.
+struct PriceBar {
+    std::int64_t time;
+    double open;
+    double high;
+    double low;
+    double close;
+    std::int64_t volume;
+};
+
+// Date,Open,High,Low,Close,Volume. The header and malformed lines return false.
+bool parseBar(std::string_view line, PriceBar& bar);
+
+// "YYYY-MM-DD HH:MM" (or just the date) -> unix seconds. Returns -1 on bad input.
+std::int64_t parseTimestamp(std::string_view text);
+std::string formatTimestamp(std::int64_t t);
+
+// Streaming FNV-1a over raw bytes, so a fingerprint can grow with the file.
+struct ByteHash {
+    std::uint64_t state = 0xcbf29ce484222325ull;
+    std::uint64_t length = 0;
+
+    void add(const char* data, std::size_t size);
+    std::uint64_t value() const; // state mixed with the length
+};
+
+// Hash of the first `bytes` bytes of the file (all of it for fingerprintFile).
+// Changes whenever that data does; 0 if the file cannot be read.
+std::uint64_t fingerprintPrefix(const std::string& filepath, std::uint64_t bytes);
+std::uint64_t fingerprintFile(const std::string& filepath);
+
+std::vector<PriceRow> loadCSV(const std::string& filepath);
+
+// With a policy, every bar goes through a BarValidator inside the parse loop
+// and what it finds is added to `report`.
+PriceSeries loadSeries(const std::string& filepath, const ValidationPolicy* policy = nullptr,
+                       AnomalyReport* report = nullptr);
+
+// Streams the file as column blocks of block_rows bars.
+// A reader thread fetches chunk_bytes at a time ahead of the parser, so disk
+// reads overlap parsing and at most a couple of chunks are buffered.
+// `policy` is copied; `report` must outlive the generator.
+Generator<PriceBlock> streamCSV(std::string filepath,
+                                std::size_t block_rows = 4096,
+                                std::size_t chunk_bytes = 1 << 20,
+                                const ValidationPolicy* policy = nullptr,
+                                AnomalyReport* report = nullptr);
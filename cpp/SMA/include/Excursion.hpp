@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Backtester.hpp"
+
+class ThreadPool;
+
+// How far a long trade went for and against it while open, over the highs
+// and lows of the bars after entry up to and including the exit bar.
+// Fractions of the entry price, or of the running peak for the drawdown.
+struct TradeExcursion {
+    double favorable {};   // MFE: highest high / entry - 1
+    double adverse {};     // MAE: 1 - lowest low / entry
+    double drawdown {};    // worst fall from the running peak (entry included) to a later low
+    int bars_to_peak {};   // entry to the first bar at the highest high
+    int bars_to_trough {}; // entry to the first bar at the lowest low
+    int bars {};           // bars held after entry
+};
+
+// Range queries over the high and low columns of one dataset, built once
+// and shared by every trade of every run on it.
+//
+// Highest high and lowest low (with the first bar reaching them) come from
+// sparse tables of bar indices, O(1) per query after O(n log n) build. The
+// intra-trade drawdown is not a plain range extreme, so it comes from a
+// segment tree whose nodes keep (highest high, lowest low, worst fall);
+// two halves combine as the worse of their falls and the fall from the
+// left half's high to the right half's low, O(log n) per query.
+class ExcursionIndex {
+public:
+    explicit ExcursionIndex(const PriceView& prices);
+
+    // Open trades (exit_bar == -1) are measured up to the last bar.
+    TradeExcursion measure(const Trade& trade) const;
+
+    // Every trade, in chunks on `pool` if given. out.size() >= trades.size().
+    void measure(std::span<const Trade> trades, std::span<TradeExcursion> out, ThreadPool* pool = nullptr) const;
+
+    // Bar of the highest high / lowest low in [first, last], the first one on ties.
+    std::size_t highest(std::size_t first, std::size_t last) const;
+    std::size_t lowest(std::size_t first, std::size_t last) const;
+
+    std::size_t size() const { return high.size(); }
+
+private:
+    struct Node {
+        double high {};
+        double low {};
+        double fall {}; // 1 - low / high for the worst high before (or at) a low
+    };
+
+    static Node combine(const Node& left, const Node& right);
+    Node fallOver(std::size_t first, std::size_t last) const;
+
+    std::span<const double> high;
+    std::span<const double> low;
+    std::vector<std::vector<std::int32_t>> highest_table; // level k: over [i, i + 2^k)
+    std::vector<std::vector<std::int32_t>> lowest_table;
+    std::size_t leaves {};
+    std::vector<Node> tree;
+};
+
+// The same numbers by scanning the trade's bars. The reference ExcursionIndex is checked against.
+TradeExcursion scanExcursion(const PriceView& prices, const Trade& trade);
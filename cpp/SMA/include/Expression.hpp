@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "DataLoader.hpp"
+
+// Small indicator/signal language, e.g.
+//   sma(close,10) > sma(close,50) and rsi(close,14) < 70
+//
+// Columns: open high low close volume
+// Functions: sma(x,n) ema(x,n) rsi(x,n)   (n is a constant)
+// Operators: + - * /  < <= > >= == !=  and or not  ( )
+// Conditions evaluate to 1.0 / 0.0; anything non-zero counts as true.
+
+enum class ExprOp {
+    Column,
+    Constant,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Neg,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Equal,
+    NotEqual,
+    And,
+    Or,
+    Not,
+    Sma,
+    Ema,
+    Rsi,
+};
+
+struct ExprNode {
+    ExprOp op {};
+    int a = -1;        // first operand (node index)
+    int b = -1;        // second operand
+    int column {};     // ExprOp::Column: 0 open, 1 high, 2 low, 3 close, 4 volume
+    int window {};     // sma/ema/rsi length
+    double value {};   // ExprOp::Constant
+};
+
+// Rules parsed once into one shared DAG.
+// Identical subexpressions are interned to a single node, so
+// sma(close,10) used by several rules is computed once per block.
+class ExprProgram {
+public:
+    // Parses a rule and merges it into the DAG. Returns the rule index,
+    // or -1 with a message in `error` if the text does not parse.
+    int addRule(const std::string& text, std::string& error);
+
+    std::size_t ruleCount() const { return rules.size(); }
+    std::size_t nodeCount() const { return nodes.size(); }
+
+    // Evaluates every rule over the whole series, column-at-a-time in blocks of
+    // block_rows values so each node's buffer stays in cache.
+    // result[r][i] is rule r at bar i.
+    std::vector<std::vector<double>> evaluate(const PriceView& prices, std::size_t block_rows = 2048) const;
+
+    // Used by the parser.
+    int intern(const ExprNode& node);
+
+private:
+    using NodeKey = std::tuple<int, int, int, int, int, double>;
+
+    std::vector<ExprNode> nodes; // children always come before their parents
+    std::map<NodeKey, int> node_ids;
+    std::vector<int> rules;
+};
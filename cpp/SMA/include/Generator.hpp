@@ -0,0 +1,80 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+// Minimal pull-based coroutine generator.
+// The producer co_yields values, the consumer pulls them one at a time,
+// so only the value being handed over is alive between the two.
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        std::optional<T> current;
+        std::exception_ptr error;
+
+        Generator get_return_object() {
+            return Generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(T value) {
+            current = std::move(value);
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    class iterator {
+    public:
+        explicit iterator(Generator* owner) : owner(owner) { advance(); }
+        T& operator*() const { return *value; }
+        iterator& operator++() {
+            advance();
+            return *this;
+        }
+        bool operator==(std::default_sentinel_t) const { return value == nullptr; }
+
+    private:
+        void advance() { value = owner->next(); }
+
+        Generator* owner;
+        T* value {};
+    };
+
+    Generator(Generator&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() {
+        if (handle) handle.destroy();
+    }
+
+    // Resumes the producer until its next co_yield.
+    // Returns nullptr once the producer has finished.
+    T* next() {
+        if (!handle || handle.done()) return nullptr;
+        handle.promise().current.reset();
+        handle.resume();
+        if (handle.promise().error) std::rethrow_exception(handle.promise().error);
+        if (handle.done()) return nullptr;
+        return &*handle.promise().current;
+    }
+
+    iterator begin() { return iterator{this}; }
+    std::default_sentinel_t end() { return {}; }
+
+private:
+    explicit Generator(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
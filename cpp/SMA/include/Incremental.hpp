@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Backtester.hpp"
+
+struct IncrementalStats {
+    bool resumed {};         // false = full recompute
+    std::string reason;      // why the saved state was not used
+    std::size_t new_bars {}; // bars processed by this run
+    std::size_t total_bars {};
+    std::size_t rejected {}; // out-of-order rows skipped; no state is saved then
+};
+
+// Backtests `strategies` over a CSV that only ever grows at the end.
+//
+// After each run the byte offset reached, a hash of the bytes before it and
+// every strategy's indicator and account state are saved to `state_path`.
+// The next run checks that the file still starts with those exact bytes and
+// continues from the offset, so a daily update parses and computes only the
+// new bars (the check itself is one hashing pass over the old bytes, no
+// parsing). Any edit to earlier rows, a different strategy list or config,
+// or a missing/corrupt state file falls back to a full recompute.
+//
+// Only newline-terminated lines are consumed; a last line still being
+// written is left for the next run. Rows that do not move time forward are
+// skipped with an error, and the state is not saved while the file has any.
+std::vector<BacktestResult> runIncrementalBacktest(const std::string& filepath, const std::string& state_path,
+                                                   const std::vector<SmaParams>& strategies,
+                                                   const BacktestConfig& config, IncrementalStats& stats);
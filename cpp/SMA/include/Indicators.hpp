@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <span>
+#include <vector>
+
+// Simple moving average updated one value at a time in O(1).
+// Keeps the last `window` values and a running sum. Each add and subtract
+// leaves a rounding error in the sum, which would build up over a long
+// series, so after every `reanchor_windows` windows of values the sum is
+// recomputed from the window itself (compensated). The hot path only counts
+// down to that; `reanchor = false` turns it off, for comparison.
+class RollingMean {
+public:
+    explicit RollingMean(int window, bool reanchor = true);
+
+    // Adds a value and returns the mean, or NaN until the window is full.
+    // Defined inline: it runs once per bar from several translation units.
+    double update(double value) {
+        if (count == length) {
+            sum -= buffer[next];
+        } else {
+            count++;
+        }
+        buffer[next] = value;
+        sum += value;
+        next++;
+        if (next == length) next = 0;
+        if (--until_reanchor == 0) [[unlikely]] reanchor();
+        return this->value();
+    }
+
+    // update() over a block, same bits, into out[0 .. values.size()). Runs
+    // between reanchors and ring wraps with the sum in a local, so a column
+    // costs about what rollingMean() does and the state carries to the next block.
+    void update(std::span<const double> values, double* out);
+
+    bool ready() const { return count == length; }
+    double value() const {
+        if (count < length) return std::numeric_limits<double>::quiet_NaN();
+        return sum / length;
+    }
+    int window() const { return length; }
+
+    // Binary snapshot of the window, for resuming a run later.
+    // load() fails if the saved window length differs.
+    void save(std::ostream& out) const;
+    bool load(std::istream& in);
+
+    static constexpr int reanchor_windows = 8;
+
+private:
+    void reanchor(); // out of line, so the call stays off the hot path
+
+    std::vector<double> buffer;
+    int length;
+    int next {};
+    int count {};
+    std::int64_t until_reanchor; // values left before the next reanchor
+    double sum {};
+};
+
+// Exponential moving average, seeded with the SMA of the first `window` values.
+class ExponentialMean {
+public:
+    explicit ExponentialMean(int window);
+
+    // Adds a value and returns the EMA, or NaN until `window` values have been seen.
+    double update(double value);
+
+private:
+    int length;
+    int count {};
+    double alpha;
+    double average {};
+};
+
+// Wilder's RSI over `window` price changes, 0..100.
+class RelativeStrengthIndex {
+public:
+    explicit RelativeStrengthIndex(int window);
+
+    // Adds a close and returns the RSI, or NaN until `window` changes have been seen.
+    double update(double close);
+
+private:
+    int length;
+    int count {};
+    double previous {};
+    double average_gain {};
+    double average_loss {};
+};
+
+// Sorted multiset with O(log n) insert, erase, k-th smallest and rank
+// (Hettinger's indexable skiplist). Each link stores how many elements it
+// skips, so walking down the levels counts positions as it goes. Nodes live
+// in flat arrays and are recycled, so a rolling window allocates nothing
+// after construction.
+class IndexableSkiplist {
+public:
+    explicit IndexableSkiplist(std::size_t capacity);
+
+    // NaN is not stored: it would never compare equal to be erased again.
+    void insert(double value);
+    // Removes one element equal to `value`; false if there is none.
+    bool erase(double value);
+
+    // k-th smallest, 0-based. k < size().
+    double at(std::size_t k) const;
+    // Elements < value, and elements <= value.
+    std::size_t countBelow(double value) const;
+    std::size_t countAtMost(double value) const;
+
+    std::size_t size() const { return count; }
+
+private:
+    static constexpr std::int32_t head = 0;
+    static constexpr std::int32_t end = 1; // +inf sentinel every level ends at
+
+    std::int32_t& next(std::int32_t node, int level) { return links[static_cast<std::size_t>(node) * levels + level]; }
+    std::int32_t next(std::int32_t node, int level) const { return links[static_cast<std::size_t>(node) * levels + level]; }
+    std::size_t& width(std::int32_t node, int level) { return widths[static_cast<std::size_t>(node) * levels + level]; }
+    std::size_t width(std::int32_t node, int level) const { return widths[static_cast<std::size_t>(node) * levels + level]; }
+    int randomLevel();
+
+    int levels {};
+    std::size_t count {};
+    std::vector<double> values;
+    std::vector<std::uint8_t> node_levels;
+    std::vector<std::int32_t> links;
+    std::vector<std::size_t> widths;
+    std::vector<std::int32_t> free_nodes;
+    std::uint64_t state = 0x9E3779B97F4A7C15ull;
+};
+
+struct QuantileBand {
+    double lower {};
+    double middle {}; // median
+    double upper {};
+};
+
+// Order statistics of the last `window` values, O(log window) per update.
+// Quantiles interpolate linearly between order statistics (h = (n - 1) q),
+// the same definition as the whole-column functions below. A NaN takes its
+// place in the window but is not ranked; results are NaN while it is there.
+class RollingQuantile {
+public:
+    explicit RollingQuantile(int window);
+
+    void update(double value);
+
+    bool ready() const { return count == length; }
+    int window() const { return length; }
+
+    // NaN until the window is full.
+    double quantile(double q) const;
+    double median() const { return quantile(0.5); }
+    // quantile(q), median, quantile(1 - q).
+    QuantileBand band(double q) const;
+    // Share of the window below `value`, ties counted half, 0..100. Called
+    // after update(close), the percentile rank of that close.
+    double percentileRank(double value) const;
+
+private:
+    IndexableSkiplist sorted;
+    std::vector<double> buffer;
+    int length;
+    int next {};
+    int count {};
+    int missing {}; // NaNs in the window
+};
+
+// Whole-column SMA. Uses RollingMean, so it matches the streaming result bit for bit.
+std::vector<double> rollingMean(std::span<const double> values, int window);
+
+// Whole-column rolling quantiles, one column per entry of `qs`, NaN during
+// warm-up. Values are ranked once up front and the window is a Fenwick tree
+// of counts over the ranks, so each bar is two O(log n) updates and one
+// O(log n) search per quantile. Matches RollingQuantile exactly.
+std::vector<std::vector<double>> rollingQuantiles(std::span<const double> values, int window,
+                                                  std::span<const double> qs);
+std::vector<double> rollingMedian(std::span<const double> values, int window);
+// Percentile rank of each value within the window ending at it, as RollingQuantile::percentileRank.
+std::vector<double> rollingPercentileRank(std::span<const double> values, int window);
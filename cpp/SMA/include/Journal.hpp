@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Backtester.hpp"
+#include "RingBuffer.hpp"
+
+enum class JournalKind : std::uint8_t {
+    Bar,   // inbound bar: value = close
+    Order, // strategy decision: value = target position
+    Fill,  // execution: value = fill price, detail = position after it
+};
+
+// One fixed-size journal entry. `stream` is the strategy index for orders
+// and fills, the symbol for bars.
+struct JournalRecord {
+    std::int64_t time {};        // event time, unix seconds
+    std::int64_t captured_ns {}; // steady clock when the live path recorded it
+    double value {};
+    std::int32_t detail {};
+    JournalKind kind {};
+    std::uint8_t reserved {};
+    std::uint16_t stream {};
+};
+static_assert(sizeof(JournalRecord) == 32);
+
+// Where each block of records starts, written after the last block so a
+// reader can seek by time without scanning.
+struct JournalBlock {
+    std::uint64_t first_record {};
+    std::uint64_t count {};
+    std::int64_t first_time {};
+    std::int64_t last_time {};
+};
+
+// Appends records to a journal file from one hot thread.
+//
+// record() stamps the capture time and pushes onto a SpscRingBuffer; a
+// writer thread drains it into fixed-size blocks and writes them out, so
+// the hot thread never touches the file. If the writer falls a whole ring
+// behind, record() waits for it (counted in stalls()) rather than drop an
+// event. close() writes the block index; a journal without one (e.g. after
+// a crash) is still readable up to its last whole block.
+class JournalWriter {
+public:
+    static constexpr std::size_t ring_records = 1 << 16;
+
+    JournalWriter() = default;
+    ~JournalWriter();
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    bool open(const std::string& filepath, std::size_t block_records = 4096);
+    void close();
+    bool isOpen() const { return writer.joinable(); }
+
+    // Hot thread only.
+    void record(JournalKind kind, std::uint16_t stream, std::int64_t time, double value, std::int32_t detail = 0) {
+        JournalRecord entry {time, captureNanos(), value, detail, kind, 0, stream};
+        while (!ring->tryPush(entry)) {
+            stall_count++;
+            std::this_thread::yield();
+        }
+        record_count++;
+    }
+
+    std::uint64_t records() const { return record_count; }
+    std::uint64_t stalls() const { return stall_count; }
+
+    static std::int64_t captureNanos();
+
+private:
+    void drain();
+
+    std::ofstream file;
+    std::unique_ptr<SpscRingBuffer<JournalRecord, ring_records>> ring;
+    std::thread writer;
+    std::atomic<bool> stopping {};
+    std::size_t block_records {};
+    std::vector<JournalBlock> index;
+    std::uint64_t record_count {};
+    std::uint64_t stall_count {};
+};
+
+// Reads a journal back one block at a time.
+class JournalReader {
+public:
+    bool open(const std::string& filepath);
+
+    std::size_t blockCount() const { return index.size(); }
+    const JournalBlock& block(std::size_t i) const { return index[i]; }
+    std::uint64_t records() const { return index.empty() ? 0 : index.back().first_record + index.back().count; }
+    // First block that may hold an event at or after `time`.
+    std::size_t findBlock(std::int64_t time) const;
+
+    bool readBlock(std::size_t i, std::vector<JournalRecord>& out);
+
+private:
+    std::ifstream file;
+    std::uint64_t data_offset {};
+    std::vector<JournalBlock> index;
+};
+
+// The live path: SMA crossover strategies on one symbol's bars, every bar,
+// order and fill recorded to `journal` as it happens.
+std::vector<BacktestResult> runRecordedBacktest(const PriceView& prices, const std::vector<SmaParams>& strategies,
+                                                const BacktestConfig& config, JournalWriter& journal);
+
+struct ReplayOptions {
+    double speed = 0.0; // 0 = as fast as possible, 1 = the recorded wall-clock pace, 2 = twice that...
+};
+
+struct ReplayResult {
+    std::uint64_t records {};
+    std::uint64_t bars {};
+    std::uint64_t decisions {};      // orders and fills replayed
+    std::uint64_t mismatches {};     // replayed orders/fills that differ from the recorded ones
+    std::uint64_t first_mismatch = std::numeric_limits<std::uint64_t>::max(); // record number of the first one
+    std::vector<BacktestResult> results;
+};
+
+// Feeds the journal's bars through the same strategy and account code as
+// runRecordedBacktest and checks that every order and fill it produces is
+// bit-for-bit the one recorded, in the same order.
+ReplayResult replayJournal(const std::string& filepath, const std::vector<SmaParams>& strategies,
+                           const BacktestConfig& config, const ReplayOptions& options = {});
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "DataLoader.hpp"
+
+// Fine-grained (e.g. minute) bars in a read-only memory-mapped file, for
+// looking at a few days out of years of data without reading the rest.
+//
+// File: a 64-byte header, then time, open, high, low and close columns
+// (each 64-byte aligned), then a sparse time index holding every
+// `index_stride`-th time. A lookup searches the small index, then one
+// stride of the time column, so it faults in a page or two; the columns of
+// the rows returned are only read when the caller reads them.
+//
+// Needs POSIX mmap; on Windows open() fails and callers fall back to
+// resolving fills from OHLC alone.
+class MinuteStore {
+public:
+    static constexpr std::size_t index_stride = 512; // one 4 KiB page of times
+
+    MinuteStore() = default;
+    ~MinuteStore();
+    MinuteStore(const MinuteStore&) = delete;
+    MinuteStore& operator=(const MinuteStore&) = delete;
+
+    // Writes `bars` (ascending times) in the store's format.
+    static bool write(const std::string& filepath, const PriceView& bars);
+
+    bool open(const std::string& filepath);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    std::size_t size() const { return rows; }
+    std::size_t fileBytes() const { return mapped_bytes; }
+    static constexpr std::size_t row_bytes = sizeof(std::int64_t) + 4 * sizeof(double);
+
+    // Bars with from <= time < to. Only time, open, high, low and close are set.
+    PriceView range(std::int64_t from, std::int64_t to) const;
+
+private:
+    std::size_t lowerBound(std::int64_t t) const;
+
+    const unsigned char* base {};
+    std::size_t mapped_bytes {};
+    std::size_t rows {};
+    const std::int64_t* times {};
+    const double* opens {};
+    const double* highs {};
+    const double* lows {};
+    const double* closes {};
+    const std::int64_t* sparse {};
+    std::size_t sparse_count {};
+};
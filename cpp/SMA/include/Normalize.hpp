@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+// A rate sampled on its own clock: an FX rate (quote per unit of a
+// currency), a CPI or a GDP deflator. Joined as-of like AsOfCursor: a value
+// stamped t applies from t + lag, so a monthly CPI published a month late
+// uses lag = one month. Times ascending.
+struct RateSeries {
+    std::span<const std::int64_t> time;
+    std::span<const double> value;
+    std::int64_t lag {};
+    bool divide {}; // divide by the rate (deflators) instead of multiplying (FX)
+};
+
+// One column to normalise: out[i] = in[i] * scale * each rate as of time[i]
+// (or divided by it, per RateSeries::divide). `rates` index the series
+// passed to normalizeColumns(); a deflator with scale 100 gives real values
+// at base 100. `out` may be `in`. Rows before any rate's first complete
+// value come out NaN. Divisions are done as multiplications by reciprocals,
+// so results can differ from a plain division in the last bit.
+struct NormalizeColumn {
+    std::span<const std::int64_t> time;
+    std::span<const double> in;
+    std::span<double> out;
+    std::vector<std::size_t> rates;
+    double scale = 1.0;
+};
+
+// Applies every column's rates in one pass over it: per block of rows the
+// rates are joined and multiplied into a cache-resident factor block, then
+// the column is scaled by it, so nothing column-sized is materialised.
+// Columns run in parallel on `pool` when one is given.
+void normalizeColumns(std::span<const RateSeries> rates, std::span<const NormalizeColumn> columns,
+                      ThreadPool* pool = nullptr);
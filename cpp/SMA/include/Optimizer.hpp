@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+// One axis of the search box: min, min + step, ..., up to max.
+struct SearchDimension {
+    double min {};
+    double max {};
+    double step = 1.0;
+};
+
+// Score of a point (one value per dimension, already on the grid) evaluated
+// on the first `fraction` of the history; higher is better. Called from
+// pool threads, several at once.
+using Objective = std::function<double(std::span<const double> point, double fraction)>;
+
+struct OptimizerConfig {
+    std::size_t batch = 0;       // candidates per generation; 0 = the CMA-ES default, 4 + 3 ln(dimensions)
+    double budget = 2000.0;      // whole-history evaluations to spend; partial ones count pro rata
+    double target = std::numeric_limits<double>::infinity(); // stop once a whole-history score reaches this
+    int rungs = 3;               // successive halving: rung r sees 1/2^(rungs-1-r) of the history
+    double sigma = 0.3;          // initial step size, as a fraction of each range
+    std::uint64_t seed = 1;
+};
+
+// Best score so far, after `evaluations` whole-history equivalents.
+struct OptimizerStep {
+    double evaluations {};
+    double best_score {};
+};
+
+struct OptimizerResult {
+    std::vector<double> best;
+    double best_score = -std::numeric_limits<double>::infinity();
+    double evaluations {};       // whole-history equivalents spent
+    std::size_t backtests {};    // objective calls, at any fraction
+    std::size_t generations {};
+    std::size_t restarts {};
+    std::vector<OptimizerStep> progress; // one entry per improvement
+};
+
+// CMA-ES over the box, with successive halving inside each generation.
+//
+// A generation samples `batch` points from the search distribution and
+// snaps them to the grid. All of them are scored on the shortest prefix of
+// the history, the better half goes on to twice the history, and so on
+// until the survivors see all of it. Candidates dropped early rank below
+// those that went further, so the distribution still learns from every
+// sample. Each rung's calls run in parallel on `pool`; a point already
+// scored at a rung is not run again. When the distribution shrinks below
+// one grid step, or stops producing new points, it restarts from a random
+// mean. Deterministic for a given seed, whatever the pool size: the pool
+// only spreads the calls of a batch whose size does not depend on it.
+OptimizerResult optimizeCmaEs(std::span<const SearchDimension> dimensions, const Objective& objective,
+                              const OptimizerConfig& config = {}, ThreadPool* pool = nullptr);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Backtester.hpp"
+
+struct PipelineConfig {
+    std::size_t block_rows = 4096;
+    std::size_t max_blocks_in_flight = 4; // blocks alive at once, counting the one being parsed
+    std::size_t threads = 0;              // 0 = one per core
+    BacktestConfig backtest;
+};
+
+struct PipelineProgress {
+    std::size_t strategy {}; // index into the strategies passed in
+    std::size_t rows_done {};
+    std::int64_t last_time {};
+    double equity {};
+    int position {};
+};
+
+// Load -> indicators -> backtest, overlapped.
+// The loader coroutine yields blocks while the strategies consume earlier ones
+// on the pool, so progress is reported before the file has finished loading.
+// Each strategy sees its blocks in file order; different strategies run in parallel.
+std::vector<BacktestResult> runStreamingBacktest(
+    const std::string& filepath, const std::vector<SmaParams>& strategies,
+    const PipelineConfig& config = {},
+    const std::function<void(const PipelineProgress&)>& on_progress = {});
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "Backtester.hpp"
+
+struct CacheKey {
+    std::uint64_t hi {};
+    std::uint64_t lo {};
+};
+
+// 128-bit key over (dataset fingerprint, strategy id, parameters, engine version).
+CacheKey makeCacheKey(std::uint64_t dataset, std::string_view strategy, std::span<const double> params);
+
+struct CacheStats {
+    std::uint64_t hits {};
+    std::uint64_t misses {};
+    std::uint64_t stores {};
+    std::uint64_t evictions {};
+};
+
+// On-disk, mmap-backed map from CacheKey to BacktestResult.
+//
+// The file is a fixed number of 8-way buckets, so its size is bounded and a
+// lookup touches one bucket. Inserting into a full bucket evicts its least
+// recently used entry. Every bucket has a sequence counter: readers retry if
+// it changed under them, writers hold it odd while they write. That works
+// across threads and across processes sharing the file, with no syscalls on
+// the lookup path. The cache is best-effort: if a bucket stays busy, a lookup
+// reports a miss and a store is dropped rather than blocking the sweep. A
+// bucket held for over a second belongs to a writer that died inside
+// store(); the next caller to find it takes it over and empties it.
+// One instance may be shared by threads; its counters are atomic.
+//
+// Needs POSIX mmap; on Windows open() fails and callers run uncached.
+class ResultCache {
+public:
+    ResultCache() = default;
+    ~ResultCache();
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Opens or creates the file. A new file gets room for `capacity` results
+    // (rounded up to whole buckets); an existing one keeps its own size.
+    bool open(const std::string& filepath, std::size_t capacity = 1 << 16);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    bool lookup(const CacheKey& key, BacktestResult& out);
+    bool store(const CacheKey& key, const BacktestResult& result);
+
+    std::size_t capacity() const;
+    CacheStats stats() const; // this instance only
+
+private:
+    struct Counters {
+        std::atomic<std::uint64_t> hits {};
+        std::atomic<std::uint64_t> misses {};
+        std::atomic<std::uint64_t> stores {};
+        std::atomic<std::uint64_t> evictions {};
+    };
+
+    unsigned char* base {};
+    std::size_t mapped_bytes {};
+    std::size_t bucket_count {};
+    Counters counters;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Backtester.hpp"
+#include "ThreadPool.hpp"
+
+// Sweep and Monte Carlo results as a column table: one double column per
+// parameter or metric, so a query over one metric reads only that column.
+//
+// Built in memory with append*(), then saved. File: a 64-byte header, the
+// column names (32 bytes each, NUL padded), then the columns, each 64-byte
+// aligned. open() maps a saved table read-only and queries run straight on
+// the mapping; a mapped table cannot be appended to. Names are cut to 31
+// characters in the file.
+//
+// Needs POSIX mmap to open a file; on Windows open() fails, building and
+// saving still work.
+class ResultTable {
+public:
+    static constexpr std::size_t name_bytes = 32;
+
+    ResultTable() = default;
+    explicit ResultTable(std::vector<std::string> names);
+    ~ResultTable();
+    ResultTable(const ResultTable&) = delete;
+    ResultTable& operator=(const ResultTable&) = delete;
+
+    // fast, slow, path, total_return, max_drawdown, trades, turnover,
+    // exposure, final_equity: the columns appendSweep() fills.
+    static std::vector<std::string> sweepColumns();
+
+    // One row per pair; `path` tells Monte Carlo paths of the same grid apart.
+    // Turnover is position changes per 252 bars, exposure the fraction of bars held.
+    void appendSweep(const std::vector<SmaParams>& pairs, const std::vector<BacktestResult>& results,
+                     double path = 0.0);
+    void appendRow(std::span<const double> row); // one value per column, in order
+    void reserve(std::size_t rows);
+
+    bool save(const std::string& filepath) const;
+    bool open(const std::string& filepath); // replaces whatever the table held
+    void close();                           // unmaps; a table built in memory is kept
+    bool isMapped() const { return base != nullptr; }
+
+    std::size_t rows() const { return row_count; }
+    std::size_t columns() const { return names.size(); }
+    const std::string& name(std::size_t column) const { return names[column]; }
+    std::size_t find(const std::string& name) const; // columns() when there is none
+    std::span<const double> column(std::size_t column) const { return {data[column], row_count}; }
+
+private:
+    void refresh(); // points data at the owned columns after they grow
+
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> owned;
+    std::vector<const double*> data;
+    std::size_t row_count {};
+    const unsigned char* base {};
+    std::size_t mapped_bytes {};
+};
+
+// Keeps rows with min <= value < max. NaN never passes.
+struct RowFilter {
+    std::size_t column {};
+    double min = -std::numeric_limits<double>::infinity();
+    double max = std::numeric_limits<double>::infinity();
+};
+
+struct ParetoAxis {
+    std::size_t column {};
+    bool maximize = true;
+};
+
+// Queries take the rows to look at (all of them when `rows` is null) and
+// run in row chunks on `pool` when one is given. Row ids come back
+// ascending, except from topK, which ranks them; ties go to the lower row.
+
+// Keeps `rows` in the order given, so filtering a previous selection
+// narrows it and a topK ranking stays ranked.
+std::vector<std::uint32_t> filterRows(const ResultTable& table, std::span<const RowFilter> filters,
+                                      const std::vector<std::uint32_t>* rows = nullptr, ThreadPool* pool = nullptr);
+
+// The k best rows by `column`, best first. NaN never ranks.
+std::vector<std::uint32_t> topK(const ResultTable& table, std::size_t column, std::size_t k, bool largest = true,
+                                const std::vector<std::uint32_t>* rows = nullptr, ThreadPool* pool = nullptr);
+
+// Rows no other row beats on every axis at once (at least as good on all,
+// strictly better on one). Each chunk keeps its own front, which stays
+// small, then the chunk fronts are merged the same way.
+std::vector<std::uint32_t> paretoFront(const ResultTable& table, std::span<const ParetoAxis> axes,
+                                       const std::vector<std::uint32_t>* rows = nullptr, ThreadPool* pool = nullptr);
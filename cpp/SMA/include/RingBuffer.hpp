@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+// The window of a ring buffer as at most two contiguous runs, oldest first.
+template <typename T>
+struct RingSpans {
+    std::span<const T> first;
+    std::span<const T> second;
+
+    std::size_t size() const { return first.size() + second.size(); }
+};
+
+// Fixed-capacity FIFO over a power-of-two slot array. Positions are free
+// running counters and a slot is `position & mask`, so wrapping is a mask,
+// not a branch. push() onto a full buffer drops the oldest item, which is
+// what a rolling window wants. Shared by RingBuffer and DynamicRingBuffer,
+// which differ only in where the slots live.
+template <typename T, typename Slots>
+class BasicRingBuffer {
+public:
+    void push(const T& item) {
+        slots[tail & mask()] = item;
+        tail++;
+        head += tail - head > limit; // evict the oldest once over capacity
+    }
+
+    // Only when !empty().
+    void pop() { head++; }
+    const T& front() const { return slots[head & mask()]; }
+    const T& back() const { return slots[(tail - 1) & mask()]; }
+
+    // i-th oldest item.
+    const T& operator[](std::size_t i) const { return slots[(head + i) & mask()]; }
+
+    std::size_t size() const { return tail - head; }
+    std::size_t capacity() const { return limit; }
+    bool empty() const { return tail == head; }
+    bool full() const { return tail - head == limit; }
+    void clear() { head = tail; }
+
+    // The items oldest first, for loops the compiler can vectorize.
+    RingSpans<T> spans() const {
+        const std::size_t start = head & mask();
+        const std::size_t count = size();
+        const std::size_t first = std::min(count, slots.size() - start);
+        return {std::span<const T>(slots.data() + start, first), std::span<const T>(slots.data(), count - first)};
+    }
+
+protected:
+    BasicRingBuffer(std::size_t capacity, Slots slots) : slots(std::move(slots)), limit(capacity) {}
+
+private:
+    std::size_t mask() const { return slots.size() - 1; }
+
+    Slots slots;
+    std::size_t limit;
+    std::size_t head {}; // position of the oldest item
+    std::size_t tail {}; // position the next item goes to
+};
+
+// Capacity fixed at compile time, slots inline. N need not be a power of
+// two; the slot array is rounded up to one.
+template <typename T, std::size_t N>
+class RingBuffer : public BasicRingBuffer<T, std::array<T, std::bit_ceil(N)>> {
+    static_assert(N > 0);
+
+public:
+    RingBuffer() : BasicRingBuffer<T, std::array<T, std::bit_ceil(N)>>(N, {}) {}
+};
+
+// Capacity chosen at run time, slots on the heap.
+template <typename T>
+class DynamicRingBuffer : public BasicRingBuffer<T, std::vector<T>> {
+public:
+    explicit DynamicRingBuffer(std::size_t capacity)
+        : BasicRingBuffer<T, std::vector<T>>(std::max<std::size_t>(1, capacity),
+                                             std::vector<T>(std::bit_ceil(std::max<std::size_t>(1, capacity)))) {}
+};
+
+// Lock-free queue for exactly one producer thread and one consumer thread.
+// Each side owns one index and only reads the other's, with acquire/release
+// ordering publishing the slot contents. Both sides keep a cached copy of
+// the other's index and reload it only when the queue looks full (or
+// empty), so in steady state a push or pop touches no shared cache line
+// but the slot itself.
+template <typename T, std::size_t N>
+class SpscRingBuffer {
+    static_assert(N > 0);
+
+public:
+    static constexpr std::size_t slot_count = std::bit_ceil(N);
+
+    // Producer side. False when full.
+    bool tryPush(const T& item) {
+        const std::size_t tail = producer.index.load(std::memory_order_relaxed);
+        if (tail - producer.cached >= slot_count) {
+            producer.cached = consumer.index.load(std::memory_order_acquire);
+            if (tail - producer.cached >= slot_count) return false;
+        }
+        slots[tail & (slot_count - 1)] = item;
+        producer.index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. False when empty.
+    bool tryPop(T& out) {
+        const std::size_t head = consumer.index.load(std::memory_order_relaxed);
+        if (head == consumer.cached) {
+            consumer.cached = producer.index.load(std::memory_order_acquire);
+            if (head == consumer.cached) return false;
+        }
+        out = slots[head & (slot_count - 1)];
+        consumer.index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: pops up to out.size() items at once; returns how many.
+    std::size_t tryPop(std::span<T> out) {
+        const std::size_t head = consumer.index.load(std::memory_order_relaxed);
+        if (consumer.cached - head < out.size()) consumer.cached = producer.index.load(std::memory_order_acquire);
+        const std::size_t count = std::min(out.size(), consumer.cached - head);
+        for (std::size_t i = 0; i < count; i++) out[i] = slots[(head + i) & (slot_count - 1)];
+        if (count > 0) consumer.index.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Approximate from either side while the other is running.
+    std::size_t size() const {
+        return producer.index.load(std::memory_order_acquire) - consumer.index.load(std::memory_order_acquire);
+    }
+
+private:
+    struct alignas(64) Side {
+        std::atomic<std::size_t> index {};
+        std::size_t cached {}; // last seen index of the other side
+    };
+
+    Side producer;
+    Side consumer;
+    alignas(64) std::array<T, slot_count> slots {};
+};
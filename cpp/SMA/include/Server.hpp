@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "Backtester.hpp"
+
+// Binary protocol between `sma serve` and its clients over a Unix socket.
+// Every message is a fixed header followed by `size` payload bytes, all in
+// host byte order (both ends are on the same machine). Replies come back on
+// a connection in the order its requests were sent.
+enum class WireOp : std::uint16_t {
+    Backtest = 1, // payload: WireBacktest, then `count` WirePair
+    Stats = 2,    // no payload; reply: LatencyHistogram::buckets
+};
+
+enum class WireStatus : std::uint16_t {
+    Ok = 0,
+    BadRequest = 1,
+    UnknownDataset = 2,
+    WindowTooLong = 3, // per pair, in WireResult::status: a window longer than the dataset
+};
+
+struct WireHeader {
+    std::uint32_t size {};    // payload bytes after the header
+    std::uint16_t op {};      // WireOp in requests, WireStatus in replies
+    std::uint16_t dataset {}; // index into the server's dataset list
+    std::uint64_t id {};      // echoed back in the reply
+};
+static_assert(sizeof(WireHeader) == 16);
+
+struct WireBacktest {
+    double initial_cash {};
+    double cost_bps {};
+    std::uint32_t count {};
+    std::uint32_t reserved {};
+};
+static_assert(sizeof(WireBacktest) == 24);
+
+struct WirePair {
+    std::int32_t fast {};
+    std::int32_t slow {};
+};
+
+// One per pair in a Backtest reply. A pair that could not run has a
+// non-Ok status and zero results; the rest of the request still runs.
+struct WireResult {
+    double final_equity {};
+    double total_return {};
+    double max_drawdown {};
+    std::int32_t trades {};
+    std::int32_t bars {};
+    std::int32_t bars_in_market {};
+    std::int32_t status {}; // WireStatus
+};
+static_assert(sizeof(WireResult) == 40);
+
+constexpr std::uint32_t max_wire_payload = 1 << 20;
+
+// Blocking full-length transfers on a socket; false on error or end of stream.
+bool writeAll(int fd, const void* data, std::size_t size);
+bool readAll(int fd, void* data, std::size_t size);
+
+// Request latencies in power-of-two microsecond buckets:
+// bucket 0 is under 1 us, bucket b is [2^(b-1), 2^b) us.
+struct LatencyHistogram {
+    static constexpr std::size_t bucket_count = 32;
+    std::array<std::uint64_t, bucket_count> buckets {};
+
+    void record(double seconds);
+    std::uint64_t count() const;
+    double percentile(double p) const; // upper bound of the bucket, in us
+    void print(std::ostream& out) const;
+};
+
+struct ServerConfig {
+    std::string socket_path = "/tmp/sma.sock";
+    std::vector<std::string> datasets; // CSV files, addressed by index
+    std::size_t threads = 0;           // 0 = hardware concurrency
+    std::size_t pairs_per_task = 64;   // how finely big requests are split
+    std::size_t column_cache_bytes = std::size_t(256) << 20; // SMA columns kept warm per dataset
+    std::size_t max_pending_reply_bytes = std::size_t(16) << 20; // per connection; reading pauses above it
+};
+
+// Loads every dataset once, then serves requests until `stop` is set.
+// Requests that arrive together are run as one batch on the thread pool;
+// SMA columns stay cached per dataset across requests, the least recently
+// used dropped after a batch once they pass column_cache_bytes. A client
+// that sends without reading its replies is not read from again until it
+// has drained them below max_pending_reply_bytes. A client that closes its
+// end after sending still gets every reply.
+// Needs Unix sockets; on Windows it fails straight away.
+int serveBacktests(const ServerConfig& config, const volatile std::sig_atomic_t& stop);
+
+class BacktestClient {
+public:
+    BacktestClient() = default;
+    ~BacktestClient();
+    BacktestClient(const BacktestClient&) = delete;
+    BacktestClient& operator=(const BacktestClient&) = delete;
+
+    bool connect(const std::string& socket_path);
+    void close();
+
+    // Sends without waiting, so several requests can be in flight.
+    bool send(std::uint16_t dataset, const std::vector<SmaParams>& pairs, const BacktestConfig& config = {});
+    // Reads the reply to the oldest request still outstanding. Pairs the
+    // server refused come back zeroed with their status in `statuses`;
+    // without it, any refused pair makes the call fail.
+    bool receive(std::vector<BacktestResult>& results, std::vector<WireStatus>* statuses = nullptr);
+
+    bool stats(LatencyHistogram& histogram);
+
+private:
+    bool readReply(WireHeader& header, std::vector<unsigned char>& payload);
+
+    int fd = -1;
+    std::uint64_t next_id = 1;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Backtester.hpp"
+
+struct ShardConfig {
+    std::size_t workers = 4;
+    std::size_t shard_pairs = 64;   // pairs handed out at a time
+    int lanes = 8;                  // batched kernel width inside a worker
+    int max_attempts = 3;           // per shard, counting crashes only
+    double straggler_factor = 4.0;  // re-issue a shard running this many times the median
+    int crash_shard = -1;           // testing: the worker given this shard first exits mid-shard
+    int slow_worker = -1;           // testing: this worker sleeps slow_ms per shard
+    int slow_ms = 0;
+};
+
+struct ShardStats {
+    std::size_t shards {};
+    std::size_t crashes {};     // workers lost mid-shard
+    std::size_t retried {};     // shards re-run after a crash
+    std::size_t reissued {};    // stragglers handed to an idle worker as well
+    std::size_t duplicates {};  // late results for shards already done, dropped
+    std::size_t respawned {};
+    std::vector<std::size_t> shards_per_worker;
+};
+
+// runSmaSweepBatched spread over forked worker processes.
+//
+// Workers inherit the prices through fork and talk to the coordinator over a
+// socketpair each, using the server's WirePair/WireResult records, so a
+// worker could as well sit behind a socket on another host. Shards are handed
+// out one at a time as workers free up, so fast workers take more of them.
+// Once the queue is empty, idle workers also take copies of shards running
+// far longer than the median; the first result wins. A worker that dies has
+// its shard requeued and is replaced.
+//
+// Every pair runs the same kernel as in-process, so the results are identical.
+// Fork before starting other threads. Returns an empty vector on failure;
+// on Windows it always fails.
+std::vector<BacktestResult> runSmaSweepSharded(const PriceView& prices, const std::vector<SmaParams>& pairs,
+                                               const BacktestConfig& config = {}, const ShardConfig& shard = {},
+                                               ShardStats* stats = nullptr);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "DataLoader.hpp"
+
+// Columnar price series in POSIX shared memory, one segment per symbol
+// ("/sma.<symbol>"), so every process on the host reads the same copy.
+//
+// Segment: a 64-byte header, then the six columns back to back, each
+// `capacity` values long and 64-byte aligned. The header's generation counter
+// is a seqlock: the publisher holds it odd while it rewrites the columns.
+// Readers map the segment read-only and never parse or copy; they take a view
+// with its generation and check unchanged() once they are done with it.
+//
+// When a series outgrows its segment the publisher retires it and creates a
+// bigger one under the same name. Mappings of the old segment stay valid, so
+// readers finish what they are doing and attach again.
+//
+// Needs POSIX shm; on Windows publish() and attach() fail.
+
+// Daemon side: owns the segment and removes it on close.
+class SeriesPublisher {
+public:
+    SeriesPublisher() = default;
+    ~SeriesPublisher();
+    SeriesPublisher(const SeriesPublisher&) = delete;
+    SeriesPublisher& operator=(const SeriesPublisher&) = delete;
+
+    // Creates the segment on first use, then rewrites it in place.
+    bool publish(const std::string& symbol, const PriceView& prices);
+    void close();
+
+    std::uint64_t generation() const { return published_generation; }
+
+private:
+    bool create(std::size_t rows);
+
+    std::string name;
+    unsigned char* base {};
+    std::size_t mapped_bytes {};
+    std::size_t capacity {};
+    std::uint64_t published_generation {};
+};
+
+// Client side: a read-only mapping of one symbol.
+class SharedSeries {
+public:
+    SharedSeries() = default;
+    ~SharedSeries();
+    SharedSeries(const SharedSeries&) = delete;
+    SharedSeries& operator=(const SharedSeries&) = delete;
+
+    bool attach(const std::string& symbol);
+    void detach();
+    bool isAttached() const { return base != nullptr; }
+
+    // The bars as of now, waiting out a publish in progress. Empty if the
+    // segment stays mid-update for over a second, as when its publisher died.
+    // Valid until detach(); trust what was read only if unchanged(generation).
+    PriceView view(std::uint64_t* generation = nullptr) const;
+    bool unchanged(std::uint64_t generation) const;
+
+    // The publisher moved to a new segment; attach again for newer data.
+    bool retired() const;
+
+private:
+    const unsigned char* base {};
+    std::size_t mapped_bytes {};
+    std::size_t capacity {};
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <iosfwd>
+#include <span>
+#include <vector>
+
+#include "Indicators.hpp"
+
+struct SmaParams {
+    int fast {};
+    int slow {};
+};
+
+// SMA crossover with a trend filter and a trailing stop: the space the
+// optimizer searches, too large for an exhaustive grid once it grows.
+struct FilteredSmaParams {
+    int fast {};
+    int slow {};
+    int filter {};  // long only while close is above SMA(filter); 0 = off
+    double stop {}; // exit once close is this fraction below its high since entry; 0 = off
+};
+
+// Long while the fast SMA is above the slow SMA, flat otherwise.
+class SmaCrossStrategy {
+public:
+    explicit SmaCrossStrategy(const SmaParams& params);
+
+    // Feeds one close and returns the target position (1 = long, 0 = flat).
+    int onBar(double close);
+    // onBar() over a run of closes with the block SMA kernel, the same targets
+    // bit for bit. `scratch` is resized to hold both SMA columns.
+    void onBars(std::span<const double> closes, std::vector<double>& scratch, int* targets);
+
+    const SmaParams& params() const { return config; }
+
+    void save(std::ostream& out) const;
+    bool load(std::istream& in);
+
+private:
+    SmaParams config;
+    RollingMean fast_mean;
+    RollingMean slow_mean;
+};
+
+// The same rule on precomputed SMA values; NaN (warm-up) means flat.
+inline int smaCrossSignal(double fast_sma, double slow_sma) {
+    return fast_sma > slow_sma ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "Backtester.hpp"
+
+class ResultCache;
+class ThreadPool;
+
+// Rolling means of close, one column per window, computed on first use and
+// kept for later sweeps over the same prices. Safe to share between threads;
+// columns are never moved, and only dropped by trim().
+class SmaColumnCache {
+public:
+    explicit SmaColumnCache(const PriceView& prices) : prices(prices) {}
+
+    // Makes sure every window used by `pairs` has its column, computing the
+    // missing ones in parallel on `pool` if one is given.
+    void prepare(const std::vector<SmaParams>& pairs, ThreadPool* pool = nullptr);
+    const std::vector<double>& column(int window);
+
+    // Drops the least recently used columns until they take at most
+    // `max_bytes`. Columns handed out earlier may go, so only call it while
+    // no sweep is using this cache.
+    void trim(std::size_t max_bytes);
+
+    std::size_t size();
+    std::size_t bytes();
+
+private:
+    struct Column {
+        std::vector<double> values;
+        std::uint64_t used {}; // `uses` when last asked for
+    };
+
+    PriceView prices;
+    std::mutex mutex;
+    std::map<int, Column> columns;
+    std::uint64_t uses {};
+};
+
+// Every (fast, slow) pair on the grid with fast < slow.
+std::vector<SmaParams> makeSmaGrid(int fast_min, int fast_max, int fast_step,
+                                   int slow_min, int slow_max, int slow_step);
+
+// One runSmaBacktest per pair. The reference the batched kernel is checked against.
+std::vector<BacktestResult> runSmaSweep(const PriceView& prices, const std::vector<SmaParams>& pairs,
+                                        const BacktestConfig& config = {}, ThreadPool* pool = nullptr);
+
+// Strategy-major sweep: each distinct SMA window is computed once, then
+// `lanes` (4, 8 or 16) parameter sets advance together bar by bar with their
+// cash, units and positions held in lane arrays, so each close is loaded
+// once per batch. Position changes are selects, not branches. lanes = 1
+// runs the scalar backtester per pair on the same columns instead, which
+// shows what the lanes add beyond sharing the SMA work.
+// Results are identical to runSmaSweep. Build with -march=native so the
+// lane loops use the widest vectors the machine has.
+std::vector<BacktestResult> runSmaSweepBatched(const PriceView& prices, const std::vector<SmaParams>& pairs,
+                                               const BacktestConfig& config = {}, int lanes = 8,
+                                               ThreadPool* pool = nullptr);
+
+// Same, with the SMA columns taken from (and added to) `columns`.
+std::vector<BacktestResult> runSmaSweepBatched(const PriceView& prices, const std::vector<SmaParams>& pairs,
+                                               SmaColumnCache& columns, const BacktestConfig& config = {},
+                                               int lanes = 8, ThreadPool* pool = nullptr);
+
+// runSmaSweepBatched that first looks every pair up in `cache` under the
+// dataset fingerprint and only runs the missing ones, storing them back.
+// `computed` (optional) receives how many pairs actually ran.
+std::vector<BacktestResult> runSmaSweepCached(const PriceView& prices, const std::vector<SmaParams>& pairs,
+                                              ResultCache& cache, std::uint64_t dataset,
+                                              const BacktestConfig& config = {}, int lanes = 8,
+                                              ThreadPool* pool = nullptr, std::size_t* computed = nullptr);
+
+// FilteredSmaParams over `prices` with its SMA columns from `columns`.
+// `prices` may be a prefix of the cache's prices, which is how the
+// optimizer scores a candidate on part of the history.
+BacktestResult runFilteredSmaBacktest(const PriceView& prices, const FilteredSmaParams& params,
+                                      SmaColumnCache& columns, const BacktestConfig& config = {});
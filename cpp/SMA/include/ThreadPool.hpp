@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// CPUs of each NUMA node, read from /sys/devices/system/node and limited to
+// the CPUs this process may run on. Elsewhere, one node with every CPU.
+struct CpuTopology {
+    std::vector<std::vector<int>> nodes;
+
+    static CpuTopology detect();
+    std::size_t cpuCount() const;
+};
+
+enum class PoolPinning {
+    None,  // the OS places workers
+    Cores, // each worker pinned to one CPU, spread evenly over the nodes
+};
+
+struct WorkerStats {
+    int node {};
+    int cpu = -1;                  // pinned CPU, -1 if not pinned
+    std::uint64_t tasks {};
+    std::uint64_t stolen_local {};  // taken from a worker on the same node
+    std::uint64_t stolen_remote {}; // taken from a worker on another node
+    double busy_seconds {};
+    double utilization {};          // busy time over the time since the stats were reset
+};
+
+// Worker threads with a task queue each, grouped by NUMA node.
+//
+// A worker runs its own queue first, then steals from workers on its node,
+// and only takes work from another node once its own node has nothing
+// queued and that node has more queued than it has workers. Tasks can be
+// aimed at a node, so work on node-local data stays there.
+class ThreadPool {
+public:
+    // threads == 0 picks std::thread::hardware_concurrency().
+    // `topology` defaults to CpuTopology::detect().
+    explicit ThreadPool(std::size_t threads = 0, PoolPinning pinning = PoolPinning::None,
+                        const CpuTopology* topology = nullptr);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Round robin over all workers; from inside a worker, onto its own queue.
+    void submit(std::function<void()> task);
+    // Onto a worker of `node`.
+    void submit(std::function<void()> task, std::size_t node);
+
+    // Blocks until every submitted task has finished.
+    void wait();
+
+    // Runs fn(node) once on a worker of every node and waits. Memory the
+    // call allocates and fills is first touched, so placed, on that node.
+    void onEachNode(const std::function<void(std::size_t node)>& fn);
+
+    std::size_t size() const { return workers.size(); }
+    std::size_t nodeCount() const { return node_workers.size(); }
+
+    std::vector<WorkerStats> stats() const;
+    void resetStats();
+
+private:
+    struct Task {
+        std::function<void()> run;
+        bool stealable = true;
+    };
+
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex; // guards tasks
+        std::deque<Task> tasks;
+        std::size_t node {};
+        int cpu = -1;
+        std::atomic<std::uint64_t> tasks_run {};
+        std::atomic<std::uint64_t> stolen_local {};
+        std::atomic<std::uint64_t> stolen_remote {};
+        std::atomic<std::uint64_t> busy_ns {};
+    };
+
+    void push(std::size_t worker, Task task);
+    bool take(std::size_t self, bool remote, Task& task);
+    bool remoteBacklog(std::size_t node) const;
+    void workerLoop(std::size_t self);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::vector<std::size_t>> node_workers;
+    std::atomic<std::size_t> next_worker {};
+
+    // Counters below are guarded by `mutex`.
+    std::mutex mutex;
+    std::vector<std::size_t> node_queued;
+    std::size_t queued {};
+    std::size_t unfinished {};
+    bool stopping {};
+    std::deque<std::condition_variable> node_wake;
+    std::condition_variable idle;
+
+    std::chrono::steady_clock::time_point stats_since;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "DataLoader.hpp"
+
+enum class PartialSessionPolicy {
+    Keep,          // flag only
+    Drop,
+    MergeIntoNext, // fold into the following bar (open from the partial, high/low/volume combined)
+};
+
+struct ValidationPolicy {
+    PartialSessionPolicy partial_sessions = PartialSessionPolicy::Keep;
+    // Session calendar, bit d for weekday d (0 = Sunday). Bars off it are
+    // partial sessions and days off it are never gaps. Short days trade thin
+    // by design, so they are not volume-checked. Defaults fit FX: Sunday
+    // evening to Friday, with Sunday short.
+    std::uint8_t session_days = 0x3f;
+    std::uint8_t short_days = 0x01;
+    double partial_volume_ratio = 0.1;  // or volume below this fraction of the recent average
+    bool fill_gaps = false;             // forward-fill missing session days with flat bars
+    std::int64_t bar_seconds = 86400;   // calendar step used to find gaps
+    bool repair_ohlc = false;           // widen high/low to contain open and close
+    double outlier_sigma = 8.0;         // flag |return| beyond this many rolling std devs
+    int lookback = 20;                  // bars behind the volume and return statistics
+};
+
+enum class AnomalyKind {
+    PartialSession,
+    Gap,
+    OhlcInconsistent,
+    Outlier,
+    OutOfOrder,
+};
+constexpr std::size_t anomaly_kinds = 5;
+
+struct Anomaly {
+    AnomalyKind kind {};
+    std::int64_t time {};
+    std::size_t row {}; // data row in the file (header excluded)
+};
+
+struct AnomalyReport {
+    std::array<std::size_t, anomaly_kinds> counts {};
+    std::vector<Anomaly> samples; // the first max_samples anomalies
+    std::size_t max_samples = 32;
+    std::size_t rows_in {};
+    std::size_t rows_out {};
+    std::size_t dropped {};
+    std::size_t merged {};
+    std::size_t filled {};
+    std::size_t repaired {};
+
+    void print(std::ostream& out) const;
+};
+
+// Checks and repairs bars one at a time as the parser produces them, so no
+// separate pass over the data is needed. Keeps only O(lookback) state.
+// Checks the policy turns off (outlier_sigma or partial_volume_ratio <= 0,
+// bar_seconds <= 0) cost nothing per row.
+class BarValidator {
+public:
+    BarValidator(const ValidationPolicy& policy, AnomalyReport& report);
+
+    // Validates one parsed bar, repairing or merging it in place. Gap fillers
+    // before it go straight to `out`; the bar itself is left to the caller to
+    // append, when this returns true, so the common path costs no extra copy.
+    bool add(PriceBar& bar, PriceSeries& out);
+
+    // Emits a partial session still waiting to be merged.
+    void finish(PriceSeries& out);
+
+private:
+    // Running sum and sum of squares over the last `lookback` values.
+    // Compared without dividing, to keep the per-bar cost to a few adds.
+    // fill() until full(), then slide().
+    struct WindowStats {
+        std::vector<double> values;
+        std::size_t next {};
+        double sum {};
+        double sum_squares {};
+        bool warm {};
+
+        void fill(double x) {
+            values[next] = x;
+            sum += x;
+            sum_squares += x * x;
+            if (++next == values.size()) {
+                next = 0;
+                warm = true;
+            }
+        }
+        void slide(double x) {
+            const double old = values[next];
+            sum -= old;
+            sum_squares -= old * old;
+            values[next] = x;
+            sum += x;
+            sum_squares += x * x;
+            if (++next == values.size()) next = 0;
+        }
+        bool full() const { return warm; }
+    };
+
+    void flag(AnomalyKind kind, std::int64_t time);
+
+    ValidationPolicy policy;
+    AnomalyReport& report;
+    bool check_volumes {};
+    bool check_outliers {};
+    bool check_gaps {};
+    double window {};        // lookback, as a double
+    double sigma_squared {}; // outlier_sigma squared
+    WindowStats volumes;
+    WindowStats changes;
+    std::int64_t previous_time {}; // of the last bar accepted, emitted or not
+    double previous_close {};
+    bool has_previous {};
+    PriceBar pending {}; // partial session waiting to merge
+    bool has_pending {};
+    double last_close {}; // of the last bar emitted, used for gap fills
+    bool has_emitted {};
+};
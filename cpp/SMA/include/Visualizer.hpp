@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ResultTable.hpp"
+
+// A metric over two parameters of a result table, e.g. total_return over
+// (fast, slow).
+struct HeatmapSpec {
+    std::size_t x {};
+    std::size_t y {};
+    std::size_t value {};
+    std::string title;
+};
+
+// Writes the heatmap as SVG. Reads the table's columns in place, so a
+// mapped table is rendered without loading it. Cells several rows land on
+// (other parameters, Monte Carlo paths) show their mean; NaN rows are
+// skipped and empty cells are left grey. Values straddling zero get a
+// diverging scale (red below, blue above), others a single-hue one.
+bool writeHeatmap(const ResultTable& table, const HeatmapSpec& spec, const std::string& filepath,
+                  const std::vector<std::uint32_t>* rows = nullptr);
@@ -0,0 +1,449 @@
+#include <ostream>
+
+#include "AllocProfiler.hpp"
+
+#ifndef SMA_ALLOC_PROFILER
+
+void printAllocReport(std::ostream& out, std::size_t) {
+    out << "Allocation profiler not built in (compile everything with -DSMA_ALLOC_PROFILER)" << std::endl;
+}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <cxxabi.h>
+#include <execinfo.h>
+#define SMA_HAVE_BACKTRACE 1
+#endif
+
+namespace {
+
+constexpr int max_stages = 64;
+constexpr int max_frames = 16;
+constexpr int skipped_frames = 3; // record, allocate, operator new
+constexpr std::size_t max_sites = 4096;
+constexpr std::int64_t default_sample_bytes = 256 * 1024;
+
+// Just before every user pointer.
+struct Header {
+    std::uint64_t size;
+    std::uint32_t site;   // call site index + 1 if sampled, else 0
+    std::uint32_t offset; // from the start of the malloc block to the user pointer
+};
+constexpr std::size_t header_bytes = sizeof(Header);
+static_assert(header_bytes == 16);
+
+// Counters are written only by their thread and read by the report, so a
+// relaxed load and store is enough; no locked read-modify-write.
+void add(std::atomic<std::uint64_t>& counter, std::uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct StageCounters {
+    std::atomic<std::uint64_t> allocations;
+    std::atomic<std::uint64_t> bytes;
+};
+
+// Per thread, never freed, so a finished thread still shows in the report.
+struct ThreadState {
+    std::atomic<std::uint64_t> allocations;
+    std::atomic<std::uint64_t> frees;
+    std::atomic<std::uint64_t> bytes;
+    std::atomic<std::uint64_t> freed_bytes;
+    std::atomic<std::uint64_t> sampled;
+    std::atomic<std::uint64_t> violations;
+    StageCounters stages[max_stages];
+    int stage;                // index into stage_names, 0 = none
+    const char* no_alloc;     // innermost NoAllocScope, or null
+    bool busy;                // inside the profiler: count, but never sample
+    std::int64_t until_sample;
+    std::uint64_t random;
+    int index;
+    ThreadState* next;
+};
+
+struct Site {
+    std::uint64_t hash;
+    int depth;
+    void* frames[max_frames];
+    int stage;
+    const char* violation; // NoAllocScope name for a violation site
+    std::uint64_t samples;
+    std::uint64_t estimated_bytes;
+    std::uint64_t live_samples;
+    std::uint64_t live_bytes;
+};
+
+// All constant-initialised, so usable from the first allocation of static init.
+std::atomic<ThreadState*> threads {nullptr};
+std::atomic<int> thread_count {0};
+std::atomic<bool> locked {false};
+Site sites[max_sites];
+std::size_t site_count = 0;
+const char* stage_names[max_stages] = {"(none)"};
+std::atomic<int> stage_count {1}; // bumped with release once the new name is stored
+std::atomic<std::int64_t> sample_bytes {-1};
+std::atomic<bool> sampling {true};
+std::atomic<bool> report_at_exit {false};
+thread_local ThreadState* current = nullptr;
+
+// Guards the site table and stage names. Only taken on sampled paths.
+void lock() {
+    while (locked.exchange(true, std::memory_order_acquire)) {
+    }
+}
+void unlock() { locked.store(false, std::memory_order_release); }
+
+std::int64_t sampleBytes() {
+    std::int64_t bytes = sample_bytes.load(std::memory_order_relaxed);
+    if (bytes < 0) {
+        const char* text = std::getenv("SMA_ALLOC_SAMPLE");
+        bytes = text != nullptr ? std::max<long long>(1, std::atoll(text)) : default_sample_bytes;
+        sample_bytes.store(bytes, std::memory_order_relaxed);
+    }
+    return bytes;
+}
+
+// Randomised around the mean so periodic allocation patterns do not alias.
+std::int64_t nextSample(ThreadState& t) {
+    t.random ^= t.random << 13;
+    t.random ^= t.random >> 7;
+    t.random ^= t.random << 17;
+    const std::int64_t mean = sampleBytes();
+    return mean / 2 + static_cast<std::int64_t>(t.random % static_cast<std::uint64_t>(mean));
+}
+
+ThreadState& self() {
+    if (current == nullptr) {
+        ThreadState* t = static_cast<ThreadState*>(std::calloc(1, sizeof(ThreadState)));
+        if (t == nullptr) std::abort();
+        t->random = 0x9E3779B97F4A7C15ull + reinterpret_cast<std::uintptr_t>(t);
+        t->index = thread_count.fetch_add(1, std::memory_order_relaxed);
+        t->until_sample = nextSample(*t);
+        t->next = threads.load(std::memory_order_relaxed);
+        while (!threads.compare_exchange_weak(t->next, t, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+        current = t;
+    }
+    return *current;
+}
+
+__attribute__((noinline)) std::uint32_t record(ThreadState& t, std::size_t size, std::uint64_t weight) {
+    Site site {};
+    site.stage = t.stage;
+    site.violation = t.no_alloc;
+#ifdef SMA_HAVE_BACKTRACE
+    void* frames[max_frames + skipped_frames];
+    const int depth = backtrace(frames, max_frames + skipped_frames);
+    site.depth = std::max(0, depth - skipped_frames);
+    std::copy_n(frames + (depth - site.depth), site.depth, site.frames);
+#endif
+    std::uint64_t hash = 1469598103934665603ull ^ static_cast<std::uint64_t>(site.stage);
+    for (int i = 0; i < site.depth; i++) {
+        hash = (hash ^ reinterpret_cast<std::uintptr_t>(site.frames[i])) * 1099511628211ull;
+    }
+    hash = (hash ^ reinterpret_cast<std::uintptr_t>(site.violation)) * 1099511628211ull;
+    site.hash = hash | 1; // 0 marks a free slot
+
+    lock();
+    std::size_t slot = hash % max_sites;
+    for (std::size_t probe = 0; probe < max_sites && sites[slot].hash != 0 && sites[slot].hash != site.hash; probe++) {
+        slot = (slot + 1) % max_sites;
+    }
+    if (sites[slot].hash == 0 && site_count < max_sites - 1) {
+        sites[slot] = site;
+        site_count++;
+    }
+    std::uint32_t id = 0;
+    if (sites[slot].hash == site.hash) {
+        Site& s = sites[slot];
+        s.samples++;
+        s.estimated_bytes += weight;
+        s.live_samples++;
+        s.live_bytes += size;
+        id = static_cast<std::uint32_t>(slot) + 1;
+    }
+    unlock();
+    add(t.sampled, 1);
+    return id;
+}
+
+__attribute__((noinline)) void* allocate(std::size_t size, std::size_t alignment) {
+    ThreadState& t = self();
+    // malloc blocks are 16-aligned, so the first `align` boundary past the
+    // header is at most `align` bytes in. Plain malloc/free on every platform.
+    const std::size_t align = std::max(header_bytes, alignment);
+    char* block = static_cast<char*>(std::malloc(size + align));
+    if (block == nullptr) return nullptr;
+
+    const std::uintptr_t first = reinterpret_cast<std::uintptr_t>(block) + header_bytes;
+    char* user = block + ((first + align - 1) / align * align - reinterpret_cast<std::uintptr_t>(block));
+    const std::size_t offset = static_cast<std::size_t>(user - block);
+    Header* header = reinterpret_cast<Header*>(user - header_bytes);
+    header->size = size;
+    header->site = 0;
+    header->offset = static_cast<std::uint32_t>(offset);
+
+    add(t.allocations, 1);
+    add(t.bytes, size);
+    add(t.stages[t.stage].allocations, 1);
+    add(t.stages[t.stage].bytes, size);
+    if (t.busy) return user;
+
+    t.until_sample -= static_cast<std::int64_t>(size);
+    const bool violation = t.no_alloc != nullptr;
+    const bool sample = t.until_sample <= 0 && sampling.load(std::memory_order_relaxed);
+    if (violation || sample) {
+        t.busy = true;
+        std::uint64_t weight = size;
+        if (sample) {
+            weight = std::max<std::uint64_t>(size, static_cast<std::uint64_t>(sampleBytes()));
+            t.until_sample = nextSample(t);
+        }
+        if (violation) add(t.violations, 1);
+        header->site = record(t, size, weight);
+        t.busy = false;
+    }
+    return user;
+}
+
+void deallocate(void* pointer) {
+    if (pointer == nullptr) return;
+    char* user = static_cast<char*>(pointer);
+    const Header* header = reinterpret_cast<const Header*>(user - header_bytes);
+    ThreadState& t = self();
+    add(t.frees, 1);
+    add(t.freed_bytes, header->size);
+    if (header->site != 0) {
+        lock();
+        Site& site = sites[header->site - 1];
+        site.live_samples--;
+        site.live_bytes -= header->size;
+        unlock();
+    }
+    std::free(user - header->offset);
+}
+
+void* allocateOrThrow(std::size_t size, std::size_t alignment) {
+    void* pointer = allocate(size, alignment);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+std::string frameName(void* frame) {
+#ifdef SMA_HAVE_BACKTRACE
+    char** symbols = backtrace_symbols(&frame, 1);
+    if (symbols == nullptr) return "?";
+    std::string text = symbols[0];
+    std::free(symbols);
+    // "binary(mangled+0x1f) [0x...]": demangle the middle if there is one.
+    const std::size_t open = text.find('(');
+    const std::size_t plus = text.find('+', open);
+    if (open != std::string::npos && plus != std::string::npos && plus > open + 1) {
+        int status = 0;
+        char* name = abi::__cxa_demangle(text.substr(open + 1, plus - open - 1).c_str(), nullptr, nullptr, &status);
+        if (status == 0 && name != nullptr) {
+            text = name;
+            std::free(name);
+        }
+    }
+    return text;
+#else
+    (void)frame;
+    return "?";
+#endif
+}
+
+void printSite(std::ostream& out, const Site& site, std::uint64_t bytes, const char* label) {
+    out << "  " << bytes << " " << label << ", " << site.samples << " samples, stage " << stage_names[site.stage];
+    if (site.violation != nullptr) out << ", inside no-alloc \"" << site.violation << "\"";
+    out << "\n";
+    for (int i = 0; i < site.depth && i < 8; i++) out << "      " << frameName(site.frames[i]) << "\n";
+}
+
+// Copy of the site table, taken under the lock.
+std::vector<Site> siteSnapshot() {
+    std::vector<Site> out;
+    out.reserve(max_sites);
+    lock();
+    for (const Site& site : sites) {
+        if (site.hash != 0) out.push_back(site);
+    }
+    unlock();
+    return out;
+}
+
+void printLeaks(std::ostream& out, const AllocCounters& totals, std::size_t top_sites) {
+    out << "Still allocated: " << totals.allocations - totals.frees << " blocks, " << totals.live_bytes << " bytes\n";
+    std::vector<Site> live = siteSnapshot();
+    std::erase_if(live, [](const Site& s) { return s.live_samples == 0; });
+    std::sort(live.begin(), live.end(), [](const Site& a, const Site& b) { return a.live_bytes > b.live_bytes; });
+    for (std::size_t i = 0; i < live.size() && i < top_sites; i++) printSite(out, live[i], live[i].live_bytes, "bytes live");
+    if (live.empty() && totals.allocations > totals.frees) {
+        out << "  (none of them sampled; SMA_ALLOC_SAMPLE=1 captures every allocation's stack)\n";
+    }
+}
+
+// Constructed before, so destroyed after, every other static object.
+struct ExitReport {
+    ~ExitReport() {
+        if (!report_at_exit.load(std::memory_order_relaxed) && std::getenv("SMA_ALLOC_AT_EXIT") == nullptr) return;
+        ThreadState& t = self();
+        t.busy = true;
+        std::cerr << "Allocation profiler at exit:\n";
+        printLeaks(std::cerr, allocCounters(), 10);
+        std::cerr.flush();
+    }
+};
+__attribute__((init_priority(101))) ExitReport exit_report;
+
+} // namespace
+
+AllocStage::AllocStage(const char* name) {
+    ThreadState& t = self();
+    previous = t.stage;
+    auto lookup = [name](int first, int last) {
+        for (int i = first; i < last; i++) {
+            if (stage_names[i] == name || std::strcmp(stage_names[i], name) == 0) return i;
+        }
+        return -1;
+    };
+    // Names below the count are complete and never change, so no lock to read
+    // them. A miss looks again under the lock, at names added since.
+    const int seen = stage_count.load(std::memory_order_acquire);
+    int found = lookup(1, seen);
+    if (found < 0) {
+        lock();
+        const int count = stage_count.load(std::memory_order_relaxed);
+        found = lookup(seen, count);
+        if (found < 0 && count < max_stages) {
+            stage_names[count] = name;
+            stage_count.store(count + 1, std::memory_order_release);
+            found = count;
+        }
+        unlock();
+    }
+    if (found > 0) t.stage = found;
+}
+
+AllocStage::~AllocStage() { self().stage = previous; }
+
+void setAllocSampling(bool on) { sampling.store(on, std::memory_order_relaxed); }
+
+void reportAllocsAtExit() { report_at_exit.store(true, std::memory_order_relaxed); }
+
+NoAllocScope::NoAllocScope(const char* what) {
+    ThreadState& t = self();
+    previous = t.no_alloc;
+    t.no_alloc = what;
+}
+
+NoAllocScope::~NoAllocScope() { self().no_alloc = previous; }
+
+AllocCounters allocCounters() {
+    AllocCounters totals;
+    std::uint64_t freed = 0;
+    for (ThreadState* t = threads.load(std::memory_order_acquire); t != nullptr; t = t->next) {
+        totals.allocations += t->allocations.load(std::memory_order_relaxed);
+        totals.frees += t->frees.load(std::memory_order_relaxed);
+        totals.bytes += t->bytes.load(std::memory_order_relaxed);
+        freed += t->freed_bytes.load(std::memory_order_relaxed);
+        totals.sampled += t->sampled.load(std::memory_order_relaxed);
+        totals.violations += t->violations.load(std::memory_order_relaxed);
+    }
+    totals.live_bytes = totals.bytes - freed;
+    return totals;
+}
+
+void printAllocReport(std::ostream& out, std::size_t top_sites) {
+    ThreadState& me = self();
+    const bool was_busy = me.busy;
+    me.busy = true; // the report's own allocations are not sampled
+
+    const AllocCounters totals = allocCounters();
+    out << "Allocations: " << totals.allocations << " (" << totals.bytes << " bytes), frees: " << totals.frees
+        << ", sampled: " << totals.sampled << " (every ~" << sampleBytes() << " bytes), no-alloc violations: "
+        << totals.violations << "\n";
+
+    std::vector<ThreadState*> all;
+    for (ThreadState* t = threads.load(std::memory_order_acquire); t != nullptr; t = t->next) all.push_back(t);
+    std::sort(all.begin(), all.end(), [](const ThreadState* a, const ThreadState* b) { return a->index < b->index; });
+    out << "Per thread:\n";
+    for (const ThreadState* t : all) {
+        out << "  thread " << t->index << ": " << t->allocations.load(std::memory_order_relaxed) << " allocations, "
+            << t->bytes.load(std::memory_order_relaxed) << " bytes\n";
+    }
+
+    out << "Per stage:\n";
+    const int stages = stage_count.load(std::memory_order_acquire);
+    for (int s = 0; s < stages; s++) {
+        std::uint64_t allocations = 0;
+        std::uint64_t bytes = 0;
+        for (const ThreadState* t : all) {
+            allocations += t->stages[s].allocations.load(std::memory_order_relaxed);
+            bytes += t->stages[s].bytes.load(std::memory_order_relaxed);
+        }
+        if (allocations > 0) out << "  " << stage_names[s] << ": " << allocations << " allocations, " << bytes << " bytes\n";
+    }
+
+    std::vector<Site> sampled = siteSnapshot();
+    std::vector<Site> violations;
+    for (const Site& site : sampled) {
+        if (site.violation != nullptr) violations.push_back(site);
+    }
+    if (!violations.empty()) {
+        out << "Allocations inside no-alloc regions:\n";
+        for (const Site& site : violations) printSite(out, site, site.estimated_bytes, "bytes");
+    }
+
+    std::sort(sampled.begin(), sampled.end(),
+              [](const Site& a, const Site& b) { return a.estimated_bytes > b.estimated_bytes; });
+    out << "Top call sites by estimated bytes:\n";
+    for (std::size_t i = 0; i < sampled.size() && i < top_sites; i++) {
+        printSite(out, sampled[i], sampled[i].estimated_bytes, "bytes (est.)");
+    }
+    printLeaks(out, totals, top_sites);
+    out.flush();
+    me.busy = was_busy;
+}
+
+void* operator new(std::size_t size) { return allocateOrThrow(size, 0); }
+void* operator new[](std::size_t size) { return allocateOrThrow(size, 0); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new(std::size_t size, std::align_val_t align) {
+    return allocateOrThrow(size, static_cast<std::size_t>(align));
+}
+void* operator new[](std::size_t size, std::align_val_t align) {
+    return allocateOrThrow(size, static_cast<std::size_t>(align));
+}
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<std::size_t>(align));
+}
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<std::size_t>(align));
+}
+
+void operator delete(void* pointer) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(pointer); }
+
+#endif
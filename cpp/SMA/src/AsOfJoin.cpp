@@ -0,0 +1,87 @@
+#include <algorithm>
+
+#include "AsOfJoin.hpp"
+
+namespace {
+
+// First k in [from, size) with !before(a[k]), for `before` true on a prefix.
+// Steps out 1, 2, 4, ... then bisects the last step, so a run of length L
+// costs O(log L) probes rather than L.
+template <typename Before>
+std::size_t gallop(const std::int64_t* a, std::size_t from, std::size_t size, Before before) {
+    std::size_t low = from; // everything before `low` is known to be before
+    std::size_t step = 1;
+    while (low + step <= size && before(a[low + step - 1])) {
+        low += step;
+        step *= 2;
+    }
+    std::size_t high = std::min(size, low + step);
+    return static_cast<std::size_t>(std::partition_point(a + low, a + high, before) - a);
+}
+
+} // namespace
+
+void AsOfCursor::join(std::span<const std::int64_t> left, std::span<std::int32_t> out) {
+    const std::int64_t* l = left.data();
+    const std::int64_t* r = right.data();
+    const std::size_t n = left.size();
+    const std::size_t m = right.size();
+    std::size_t j = next;
+
+    // Merge by runs rather than row by row: every left bar before the next
+    // right bar completes maps to the same index, so find where that run ends
+    // by galloping and fill it (a plain loop the compiler vectorises). Then
+    // gallop past every right bar complete by the next left bar. Either side
+    // can be the dense one; both scans are O(log run), the fills O(n).
+    std::size_t i = 0;
+    while (i < n) {
+        if (j < m) {
+            const std::int64_t complete_at = r[j] + lag;
+            std::size_t end = gallop(l, i, n, [complete_at](std::int64_t t) { return t < complete_at; });
+            std::fill(out.begin() + static_cast<std::ptrdiff_t>(i), out.begin() + static_cast<std::ptrdiff_t>(end),
+                      static_cast<std::int32_t>(j) - 1);
+            i = end;
+            if (i == n) break;
+            const std::int64_t now = l[i] - lag;
+            j = gallop(r, j, m, [now](std::int64_t t) { return t <= now; });
+        } else {
+            std::fill(out.begin() + static_cast<std::ptrdiff_t>(i), out.begin() + static_cast<std::ptrdiff_t>(n),
+                      static_cast<std::int32_t>(m) - 1);
+            i = n;
+        }
+    }
+    next = j;
+}
+
+std::vector<std::int32_t> asOfJoin(std::span<const std::int64_t> left, std::span<const std::int64_t> right,
+                                   std::int64_t lag) {
+    std::vector<std::int32_t> index(left.size());
+    AsOfCursor cursor(right, lag);
+    cursor.join(left, index);
+    return index;
+}
+
+std::vector<std::vector<std::int32_t>> asOfJoin(std::span<const std::int64_t> left,
+                                                std::span<const std::span<const std::int64_t>> rights,
+                                                std::span<const std::int64_t> lags) {
+    constexpr std::size_t block_rows = 4096;
+    std::vector<std::vector<std::int32_t>> index(rights.size(), std::vector<std::int32_t>(left.size()));
+    std::vector<AsOfCursor> cursors;
+    for (std::size_t k = 0; k < rights.size(); k++) cursors.emplace_back(rights[k], k < lags.size() ? lags[k] : 0);
+
+    for (std::size_t first = 0; first < left.size(); first += block_rows) {
+        const std::size_t count = std::min(block_rows, left.size() - first);
+        for (std::size_t k = 0; k < rights.size(); k++) {
+            cursors[k].join(left.subspan(first, count), std::span(index[k]).subspan(first, count));
+        }
+    }
+    return index;
+}
+
+std::vector<double> gatherAsOf(std::span<const double> column, std::span<const std::int32_t> index, double missing) {
+    std::vector<double> out(index.size());
+    for (std::size_t i = 0; i < index.size(); i++) {
+        out[i] = index[i] >= 0 ? column[static_cast<std::size_t>(index[i])] : missing;
+    }
+    return out;
+}
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <limits>
+
+#include "Backtester.hpp"
+#include "BinaryIO.hpp"
+#include "MinuteStore.hpp"
+
+Backtester::Backtester(const BacktestConfig& config)
+    : config(config), cash(config.initial_cash), last_equity(config.initial_cash), peak(config.initial_cash) {}
+
+void Backtester::onBar(double close, int target_position) {
+    const double keep = 1.0 - config.cost_bps * 1e-4;
+    if (target_position != holding) {
+        if (target_position == 1) {
+            units = cash * keep / close;
+            cash = 0.0;
+        } else {
+            cash = units * close * keep;
+            units = 0.0;
+        }
+        if (trade_log != nullptr) {
+            if (target_position == 1) {
+                trade_log->push_back(Trade{bars, -1, close, 0.0});
+            } else if (!trade_log->empty()) {
+                trade_log->back().exit_bar = bars;
+                trade_log->back().exit_price = close;
+            }
+        }
+        holding = target_position;
+        trades++;
+    }
+
+    last_equity = cash + units * close;
+    peak = std::max(peak, last_equity);
+    max_drawdown = std::max(max_drawdown, (peak - last_equity) / peak);
+    bars++;
+    bars_in_market += holding;
+}
+
+void Backtester::exitIntrabar(double price) {
+    if (holding == 0) return;
+    cash = units * price * (1.0 - config.cost_bps * 1e-4);
+    units = 0.0;
+    holding = 0;
+    trades++;
+    if (trade_log != nullptr && !trade_log->empty()) {
+        trade_log->back().exit_bar = bars;
+        trade_log->back().exit_price = price;
+    }
+}
+
+BacktestResult Backtester::result() const {
+    BacktestResult result;
+    result.final_equity = last_equity;
+    result.total_return = last_equity / config.initial_cash - 1.0;
+    result.max_drawdown = max_drawdown;
+    result.trades = trades;
+    result.bars = bars;
+    result.bars_in_market = bars_in_market;
+    return result;
+}
+
+void Backtester::save(std::ostream& out) const {
+    writeValue(out, cash);
+    writeValue(out, units);
+    writeValue(out, holding);
+    writeValue(out, last_equity);
+    writeValue(out, peak);
+    writeValue(out, max_drawdown);
+    writeValue(out, trades);
+    writeValue(out, bars);
+    writeValue(out, bars_in_market);
+}
+
+bool Backtester::load(std::istream& in) {
+    return readValue(in, cash) && readValue(in, units) && readValue(in, holding) &&
+           readValue(in, last_equity) && readValue(in, peak) && readValue(in, max_drawdown) &&
+           readValue(in, trades) && readValue(in, bars) && readValue(in, bars_in_market);
+}
+
+BacktestResult runSmaBacktest(const PriceView& prices, const SmaParams& params,
+                              const BacktestConfig& config, std::vector<Trade>* trades) {
+    std::vector<double> fast_sma = rollingMean(prices.close, params.fast);
+    std::vector<double> slow_sma = rollingMean(prices.close, params.slow);
+
+    Backtester backtester(config);
+    backtester.recordTrades(trades);
+    for (std::size_t i = 0; i < prices.size(); i++) {
+        backtester.onBar(prices.close[i], smaCrossSignal(fast_sma[i], slow_sma[i]));
+    }
+    return backtester.result();
+}
+
+BacktestResult runSignalBacktest(const PriceView& prices, std::span<const double> signal,
+                                 const BacktestConfig& config) {
+    Backtester backtester(config);
+    for (std::size_t i = 0; i < prices.size(); i++) {
+        backtester.onBar(prices.close[i], signal[i] != 0.0 ? 1 : 0);
+    }
+    return backtester.result();
+}
+
+namespace {
+
+enum class ExitHit { None, Stop, Target, Both };
+
+struct BarExit {
+    ExitHit hit = ExitHit::None;
+    double price {};
+};
+
+// What one bar's OHLC says about a resting stop and target. A gap through
+// either level fills at the open, which also decides it.
+BarExit settleBar(double open, double high, double low, double stop, double target) {
+    if (open <= stop) return {ExitHit::Stop, open};
+    if (open >= target) return {ExitHit::Target, open};
+    const bool stop_hit = low <= stop;
+    const bool target_hit = high >= target;
+    if (stop_hit && target_hit) return {ExitHit::Both, stop};
+    if (stop_hit) return {ExitHit::Stop, stop};
+    if (target_hit) return {ExitHit::Target, target};
+    return {};
+}
+
+// The first fine bar that reaches a level decides.
+BarExit settleFine(const PriceView& fine, double stop, double target, IntrabarStats& stats) {
+    for (std::size_t m = 0; m < fine.size(); m++) {
+        BarExit exit = settleBar(fine.open[m], fine.high[m], fine.low[m], stop, target);
+        if (exit.hit == ExitHit::None) continue;
+        stats.fine_rows_read += m + 1;
+        if (exit.hit == ExitHit::Both) {
+            stats.unresolved++;
+            exit.hit = ExitHit::Stop;
+        }
+        return exit;
+    }
+    stats.fine_rows_read += fine.size();
+    return {};
+}
+
+} // namespace
+
+BacktestResult runBracketBacktest(const PriceView& prices, const SmaParams& params, const BracketExits& exits,
+                                  IntrabarPolicy policy, const MinuteStore* fine, IntrabarStats* stats,
+                                  const BacktestConfig& config, std::int64_t bar_seconds) {
+    std::vector<double> fast_sma = rollingMean(prices.close, params.fast);
+    std::vector<double> slow_sma = rollingMean(prices.close, params.slow);
+    IntrabarStats local;
+    IntrabarStats& counts = stats != nullptr ? *stats : local;
+    const bool have_fine = fine != nullptr && fine->isOpen();
+
+    Backtester backtester(config);
+    bool stopped = false; // exited on the bracket; waits for the crossover to reset
+    double entry = 0.0;
+    for (std::size_t i = 0; i < prices.size(); i++) {
+        const int signal = smaCrossSignal(fast_sma[i], slow_sma[i]);
+        if (signal == 0) stopped = false;
+
+        if (backtester.position() == 1) {
+            counts.bars_checked++;
+            const double stop = exits.stop_loss > 0.0 ? entry * (1.0 - exits.stop_loss) : 0.0;
+            const double target = exits.take_profit > 0.0 ? entry * (1.0 + exits.take_profit)
+                                                          : std::numeric_limits<double>::infinity();
+            BarExit exit = settleBar(prices.open[i], prices.high[i], prices.low[i], stop, target);
+            counts.ambiguous += exit.hit == ExitHit::Both;
+            const bool scan = have_fine && (policy == IntrabarPolicy::Full ||
+                                            (policy == IntrabarPolicy::Lazy && exit.hit == ExitHit::Both));
+            PriceView minutes = scan ? fine->range(prices.time[i], prices.time[i] + bar_seconds) : PriceView {};
+            if (minutes.size() > 0) {
+                counts.fine_scans++;
+                exit = settleFine(minutes, stop, target, counts);
+            } else if (exit.hit == ExitHit::Both) {
+                counts.unresolved++;
+                exit.hit = ExitHit::Stop;
+            }
+            if (exit.hit != ExitHit::None) {
+                backtester.exitIntrabar(exit.price);
+                stopped = true;
+            }
+        }
+
+        const int target_position = stopped ? 0 : signal;
+        const bool entering = target_position == 1 && backtester.position() == 0;
+        backtester.onBar(prices.close[i], target_position);
+        if (entering) entry = prices.close[i];
+    }
+    return backtester.result();
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Covariance.hpp"
+
+namespace {
+
+constexpr int rebuild_windows = 16;
+
+double nan() { return std::numeric_limits<double>::quiet_NaN(); }
+
+} // namespace
+
+RollingCovariance::RollingCovariance(std::size_t assets, int window)
+    : asset_count(assets), stride((assets + 3) / 4 * 4), length(window > 1 ? window : 2) {
+    ring.assign(static_cast<std::size_t>(length) * stride, 0.0);
+    sums.assign(stride, 0.0);
+    arriving.assign(stride, 0.0);
+    zeros.assign(stride, 0.0);
+
+    // Block b holds rows 4b..4b+3, each from column 4b to the end.
+    row_offset.resize(stride);
+    std::size_t offset = 0;
+    for (std::size_t row = 0; row < stride; row++) {
+        row_offset[row] = offset;
+        offset += stride - row / 4 * 4;
+    }
+    cross.assign(offset, 0.0);
+}
+
+RollingCovariance::RollingCovariance(std::size_t assets, int window, std::vector<AssetPair> pairs)
+    : asset_count(assets), stride((assets + 3) / 4 * 4), length(window > 1 ? window : 2), pairs(std::move(pairs)) {
+    ring.assign(static_cast<std::size_t>(length) * stride, 0.0);
+    sums.assign(stride, 0.0);
+    squares.assign(stride, 0.0);
+    arriving.assign(stride, 0.0);
+    zeros.assign(stride, 0.0);
+    cross.assign(this->pairs.size(), 0.0);
+}
+
+void RollingCovariance::update(std::span<const double> values) {
+    if (shift.empty()) shift.assign(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(asset_count));
+    for (std::size_t i = 0; i < asset_count; i++) arriving[i] = values[i] - shift[i];
+
+    // Until the window is full the slot is still zero, so nothing leaves.
+    double* slot = ring.data() + static_cast<std::size_t>(next) * stride;
+    accumulate(arriving.data(), slot);
+    std::copy(arriving.begin(), arriving.end(), slot);
+
+    next = next + 1 == length ? 0 : next + 1;
+    if (count < length) {
+        count++;
+    } else if (++since_rebuild == rebuild_windows * length) {
+        rebuild();
+    }
+}
+
+void RollingCovariance::accumulate(const double* __restrict x, const double* __restrict y) {
+    for (std::size_t i = 0; i < stride; i++) sums[i] += x[i] - y[i];
+
+    if (!pairs.empty()) {
+        for (std::size_t i = 0; i < stride; i++) squares[i] += x[i] * x[i] - y[i] * y[i];
+        for (std::size_t k = 0; k < pairs.size(); k++) {
+            const AssetPair p = pairs[k];
+            cross[k] += x[p.a] * x[p.b] - y[p.a] * y[p.b];
+        }
+        return;
+    }
+
+    // One pass per block of four rows: x[k] and y[k] are loaded once for all four.
+    for (std::size_t first = 0; first < stride; first += 4) {
+        double* __restrict r0 = cross.data() + row_offset[first];
+        double* __restrict r1 = cross.data() + row_offset[first + 1];
+        double* __restrict r2 = cross.data() + row_offset[first + 2];
+        double* __restrict r3 = cross.data() + row_offset[first + 3];
+        const double x0 = x[first], x1 = x[first + 1], x2 = x[first + 2], x3 = x[first + 3];
+        const double y0 = y[first], y1 = y[first + 1], y2 = y[first + 2], y3 = y[first + 3];
+        const double* __restrict xs = x + first;
+        const double* __restrict ys = y + first;
+        const std::size_t columns = stride - first;
+        for (std::size_t k = 0; k < columns; k++) {
+            const double xv = xs[k];
+            const double yv = ys[k];
+            r0[k] += x0 * xv - y0 * yv;
+            r1[k] += x1 * xv - y1 * yv;
+            r2[k] += x2 * xv - y2 * yv;
+            r3[k] += x3 * xv - y3 * yv;
+        }
+    }
+}
+
+void RollingCovariance::rebuild() {
+    std::fill(sums.begin(), sums.end(), 0.0);
+    std::fill(squares.begin(), squares.end(), 0.0);
+    std::fill(cross.begin(), cross.end(), 0.0);
+    for (int slot = 0; slot < length; slot++) {
+        accumulate(ring.data() + static_cast<std::size_t>(slot) * stride, zeros.data());
+    }
+    since_rebuild = 0;
+}
+
+double RollingCovariance::fromSums(double cross_sum, double sum_i, double sum_j) const {
+    if (count < 2) return nan();
+    const double n = count;
+    return (cross_sum - sum_i * sum_j / n) / (n - 1.0);
+}
+
+double RollingCovariance::variance(std::size_t i) const {
+    const double squared = pairs.empty() ? cross[row_offset[i] + i % 4] : squares[i];
+    return fromSums(squared, sums[i], sums[i]);
+}
+
+double RollingCovariance::covariance(std::size_t i, std::size_t j) const {
+    if (!pairs.empty()) return nan();
+    if (i > j) std::swap(i, j);
+    return fromSums(cross[row_offset[i] + j - i / 4 * 4], sums[i], sums[j]);
+}
+
+double RollingCovariance::correlation(std::size_t i, std::size_t j) const {
+    const double denominator = std::sqrt(variance(i) * variance(j));
+    return denominator > 0.0 ? covariance(i, j) / denominator : nan();
+}
+
+double RollingCovariance::pairCovariance(std::size_t k) const {
+    if (pairs.empty()) return nan();
+    return fromSums(cross[k], sums[pairs[k].a], sums[pairs[k].b]);
+}
+
+double RollingCovariance::pairCorrelation(std::size_t k) const {
+    if (pairs.empty()) return nan();
+    const double denominator = std::sqrt(variance(pairs[k].a) * variance(pairs[k].b));
+    return denominator > 0.0 ? pairCovariance(k) / denominator : nan();
+}
+
+std::vector<double> RollingCovariance::covarianceMatrix() const {
+    const std::size_t n = asset_count;
+    std::vector<double> out(n * n);
+    for (std::size_t i = 0; i < n; i++) {
+        for (std::size_t j = i; j < n; j++) out[i * n + j] = out[j * n + i] = covariance(i, j);
+    }
+    return out;
+}
+
+std::vector<double> RollingCovariance::correlationMatrix() const {
+    const std::size_t n = asset_count;
+    std::vector<double> out(n * n);
+    for (std::size_t i = 0; i < n; i++) {
+        for (std::size_t j = i; j < n; j++) out[i * n + j] = out[j * n + i] = correlation(i, j);
+    }
+    return out;
+}
+
+std::vector<double> windowCovariance(std::span<const double> rows, std::size_t assets) {
+    const std::size_t bars = assets > 0 ? rows.size() / assets : 0;
+    std::vector<double> out(assets * assets, bars < 2 ? nan() : 0.0);
+    if (bars < 2) return out;
+
+    std::vector<double> mean(assets, 0.0);
+    for (std::size_t t = 0; t < bars; t++) {
+        for (std::size_t i = 0; i < assets; i++) mean[i] += rows[t * assets + i];
+    }
+    for (double& m : mean) m /= static_cast<double>(bars);
+
+    std::vector<double> centred(assets);
+    for (std::size_t t = 0; t < bars; t++) {
+        for (std::size_t i = 0; i < assets; i++) centred[i] = rows[t * assets + i] - mean[i];
+        for (std::size_t i = 0; i < assets; i++) {
+            for (std::size_t j = i; j < assets; j++) out[i * assets + j] += centred[i] * centred[j];
+        }
+    }
+    for (std::size_t i = 0; i < assets; i++) {
+        for (std::size_t j = i; j < assets; j++) {
+            out[i * assets + j] /= static_cast<double>(bars - 1);
+            out[j * assets + i] = out[i * assets + j];
+        }
+    }
+    return out;
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "CrossSection.hpp"
+
+namespace {
+
+constexpr double unranked = -std::numeric_limits<double>::infinity();
+
+// Transposes in blocks of this many symbols, so both sides stay in cache.
+constexpr std::size_t transpose_block = 16;
+
+// held[] flag of the outgoing members while a new set is chosen.
+constexpr std::uint8_t was_held = 2;
+
+double finiteOr(double score) { return std::isnan(score) ? unranked : score; }
+
+} // namespace
+
+CrossSectionScorer::CrossSectionScorer(std::vector<std::span<const double>> closes, ScoreKind kind, int lookback)
+    : closes(std::move(closes)), kind(kind), lookback(static_cast<std::size_t>(std::max(1, lookback))) {
+    bar_count = this->closes.empty() ? 0 : this->closes.front().size();
+    for (const std::span<const double>& column : this->closes) bar_count = std::min(bar_count, column.size());
+    sums.assign(this->closes.size(), 0.0);
+}
+
+void CrossSectionScorer::scores(std::size_t first, std::size_t count, std::span<double> out) {
+    const std::size_t n = closes.size();
+    count = std::min(count, bar_count - std::min(first, bar_count));
+    tile.resize(n * count);
+
+    if (kind == ScoreKind::SmaDistance && first != next_bar) {
+        // Not continuing from the last tile: rebuild the sums of [first - lookback, first).
+        for (std::size_t s = 0; s < n; s++) {
+            double sum = 0.0;
+            for (std::size_t t = first - std::min(first, lookback); t < first; t++) sum += closes[s][t];
+            sums[s] = sum;
+        }
+    }
+
+    // Symbol-major: each symbol's tile along its own column.
+    for (std::size_t s = 0; s < n; s++) {
+        const double* close = closes[s].data();
+        double* row = tile.data() + s * count;
+        if (kind == ScoreKind::Momentum) {
+            std::size_t b = 0;
+            for (; b < count && first + b < lookback; b++) row[b] = unranked;
+            for (; b < count; b++) row[b] = close[first + b] / close[first + b - lookback] - 1.0;
+        } else {
+            double sum = sums[s];
+            const double scale = 1.0 / static_cast<double>(lookback);
+            for (std::size_t b = 0; b < count; b++) {
+                const std::size_t t = first + b;
+                sum += close[t];
+                if (t >= lookback) sum -= close[t - lookback];
+                row[b] = t + 1 >= lookback ? close[t] / (sum * scale) - 1.0 : unranked;
+            }
+            sums[s] = sum;
+        }
+        for (std::size_t b = 0; b < count; b++) {
+            // A zero or negative price gives inf or a meaningless ratio.
+            const bool bad = !(close[first + b] > 0.0) || (kind == ScoreKind::Momentum && first + b >= lookback &&
+                                                           !(close[first + b - lookback] > 0.0));
+            row[b] = bad ? unranked : finiteOr(row[b]);
+        }
+    }
+    next_bar = first + count;
+
+    // Bar-major for the selection.
+    for (std::size_t s0 = 0; s0 < n; s0 += transpose_block) {
+        const std::size_t s1 = std::min(n, s0 + transpose_block);
+        for (std::size_t b = 0; b < count; b++) {
+            for (std::size_t s = s0; s < s1; s++) out[b * n + s] = tile[s * count + b];
+        }
+    }
+}
+
+TopKSelector::TopKSelector(std::size_t k, bool incremental) : k(k), incremental(incremental) {}
+
+void TopKSelector::selectFrom(std::vector<std::uint32_t>& pool, std::span<const double> scores) {
+    const std::size_t keep = std::min(k, pool.size());
+    auto better = [scores](std::uint32_t a, std::uint32_t b) {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    };
+    std::nth_element(pool.begin(), pool.begin() + static_cast<std::ptrdiff_t>(keep), pool.end(), better);
+    for (std::uint32_t s : chosen) held[s] = was_held;
+    chosen.assign(pool.begin(), pool.begin() + static_cast<std::ptrdiff_t>(keep));
+}
+
+void TopKSelector::commit() {
+    last_changed = 0;
+    for (std::uint32_t s : chosen) last_changed += held[s] != was_held;
+    for (std::uint8_t& flag : held) flag = 0;
+    for (std::uint32_t s : chosen) held[s] = 1;
+}
+
+bool TopKSelector::update(std::span<const double> scores) {
+    const std::size_t n = scores.size();
+    const std::size_t keep = std::min(k, n);
+    auto better = [scores](std::uint32_t a, std::uint32_t b) {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    };
+
+    if (held.size() != n) {
+        held.assign(n, 0);
+        chosen.clear();
+    }
+    if (!incremental || chosen.size() != keep || keep == 0) {
+        candidates.resize(n);
+        for (std::size_t s = 0; s < n; s++) candidates[s] = static_cast<std::uint32_t>(s);
+        selectFrom(candidates, scores);
+        commit();
+        full_bars++;
+        return last_changed > 0;
+    }
+
+    std::uint32_t weakest = chosen.front();
+    for (std::uint32_t s : chosen) weakest = better(weakest, s) ? s : weakest;
+
+    // Outsiders that beat the weakest member; usually none.
+    candidates.resize(n);
+    std::size_t count = 0;
+    for (std::size_t s = 0; s < n; s++) {
+        candidates[count] = static_cast<std::uint32_t>(s);
+        count += held[s] == 0 && better(static_cast<std::uint32_t>(s), weakest);
+    }
+    if (count == 0) {
+        unchanged_bars++;
+        last_changed = 0;
+        return false;
+    }
+
+    candidates.resize(count);
+    candidates.insert(candidates.end(), chosen.begin(), chosen.end());
+    selectFrom(candidates, scores);
+    commit();
+    repaired_bars++;
+    return last_changed > 0;
+}
+
+RotationResult runRotation(const std::vector<std::span<const double>>& closes, const RotationConfig& config) {
+    RotationResult result;
+    CrossSectionScorer scorer(closes, config.score, config.lookback);
+    TopKSelector selector(config.top_k, config.incremental);
+    const std::size_t n = scorer.symbols();
+    const std::size_t bars = scorer.bars();
+    const std::size_t tile_bars = std::max<std::size_t>(1, config.tile_bars);
+    const double cost = config.backtest.cost_bps * 1e-4;
+
+    std::vector<double> tile(n * tile_bars);
+    std::vector<double> flipped(n);
+    std::vector<std::uint32_t> book;      // held from the last close to this one
+    std::vector<std::uint32_t> next_book;
+    std::vector<std::uint8_t> in_book(n, 0);
+
+    double equity = config.backtest.initial_cash;
+    double peak = equity;
+    double turnover = 0.0;
+    for (std::size_t first = 0; first < bars; first += tile_bars) {
+        const std::size_t count = std::min(tile_bars, bars - first);
+        scorer.scores(first, count, tile);
+        for (std::size_t b = 0; b < count; b++) {
+            const std::size_t t = first + b;
+            std::span<const double> row(tile.data() + b * n, n);
+
+            if (t > 0 && !book.empty()) {
+                double sum = 0.0;
+                for (std::uint32_t s : book) sum += closes[s][t] / closes[s][t - 1] - 1.0;
+                equity *= 1.0 + sum / static_cast<double>(book.size());
+            }
+
+            if (config.bottom) {
+                // Lowest first, and unranked symbols stay last.
+                for (std::size_t s = 0; s < n; s++) flipped[s] = row[s] == unranked ? unranked : -row[s];
+                row = flipped;
+            }
+            selector.update(row);
+
+            next_book.clear();
+            for (std::uint32_t s : selector.members()) {
+                if (row[s] != unranked) next_book.push_back(s);
+            }
+            std::size_t bought = 0;
+            for (std::uint32_t s : next_book) bought += in_book[s] == 0;
+            const std::size_t sold = book.size() + bought - next_book.size();
+            double replaced = 0.0;
+            if (!next_book.empty()) replaced += static_cast<double>(bought) / static_cast<double>(next_book.size());
+            if (!book.empty()) replaced += static_cast<double>(sold) / static_cast<double>(book.size());
+            equity *= 1.0 - cost * replaced;
+            turnover += next_book.empty() ? 0.0 : static_cast<double>(bought) / static_cast<double>(next_book.size());
+
+            for (std::uint32_t s : book) in_book[s] = 0;
+            for (std::uint32_t s : next_book) in_book[s] = 1;
+            book.swap(next_book);
+
+            peak = std::max(peak, equity);
+            result.max_drawdown = std::max(result.max_drawdown, (peak - equity) / peak);
+        }
+    }
+
+    result.final_equity = equity;
+    result.total_return = equity / config.backtest.initial_cash - 1.0;
+    result.bars = bars;
+    result.average_turnover = bars > 0 ? turnover / static_cast<double>(bars) : 0.0;
+    result.unchanged_bars = selector.unchanged_bars;
+    result.repaired_bars = selector.repaired_bars;
+    return result;
+}
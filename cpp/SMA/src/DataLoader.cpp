@@ -3,18 +3,207 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <charconv>
+#include <cstdio>
+#include <thread>
+#include <optional>
+#include <algorithm>
+#include <cstdint>
 
+#include "DataLoader.hpp"
+#include "BoundedQueue.hpp"
+#include "Validation.hpp"
 
-struct PriceRow{
-    std::string date;
-    double open;
-    double high;
-    double low;
-    double close;
-    int volume;
+PriceView PriceView::slice(std::size_t first, std::size_t count) const {
+    return PriceView{time.subspan(first, count), open.subspan(first, count),
+                     high.subspan(first, count), low.subspan(first, count),
+                     close.subspan(first, count), volume.subspan(first, count)};
 }
 
-{std::vector<PriceRow> loadCSV(const std::string& filepath) {
+void PriceSeries::reserve(std::size_t n) {
+    time.reserve(n);
+    open.reserve(n);
+    high.reserve(n);
+    low.reserve(n);
+    close.reserve(n);
+    volume.reserve(n);
+}
+
+void PriceSeries::clear() {
+    time.clear();
+    open.clear();
+    high.clear();
+    low.clear();
+    close.clear();
+    volume.clear();
+}
+
+void PriceSeries::push(std::int64_t t, double o, double h, double l, double c, std::int64_t v) {
+    time.push_back(t);
+    open.push_back(o);
+    high.push_back(h);
+    low.push_back(l);
+    close.push_back(c);
+    volume.push_back(v);
+}
+
+PriceView PriceSeries::view() const {
+    return PriceView{time, open, high, low, close, volume};
+}
+
+namespace {
+
+// Days since 1970-01-01 for a proleptic Gregorian date.
+std::int64_t daysFromCivil(std::int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+bool readInt(std::string_view text, std::size_t pos, std::size_t len, int& out) {
+    if (pos + len > text.size()) return false;
+    auto result = std::from_chars(text.data() + pos, text.data() + pos + len, out);
+    return result.ec == std::errc() && result.ptr == text.data() + pos + len;
+}
+
+template <typename T>
+bool readNumber(std::string_view field, T& out) {
+    while (!field.empty() && (field.back() == '\r' || field.back() == ' ')) field.remove_suffix(1);
+    auto result = std::from_chars(field.data(), field.data() + field.size(), out);
+    return result.ec == std::errc() && result.ptr == field.data() + field.size();
+}
+
+// Reads the file on its own thread, a chunk at a time, into a short queue.
+class ChunkReader {
+public:
+    ChunkReader(const std::string& filepath, std::size_t chunk_bytes)
+        : file(filepath, std::ios::binary), chunks(2) {
+        if (!file.is_open()) {
+            chunks.close();
+            return;
+        }
+        reader = std::thread([this, chunk_bytes] {
+            while (true) {
+                std::string chunk(chunk_bytes, '\0');
+                file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+                chunk.resize(static_cast<std::size_t>(file.gcount()));
+                if (chunk.empty() || !chunks.push(std::move(chunk))) break;
+            }
+            chunks.close();
+        });
+    }
+
+    ~ChunkReader() {
+        chunks.close();
+        if (reader.joinable()) reader.join();
+    }
+
+    bool isOpen() const { return file.is_open(); }
+    bool next(std::string& chunk) { return chunks.pop(chunk); }
+
+private:
+    std::ifstream file;
+    BoundedQueue<std::string> chunks;
+    std::thread reader;
+};
+
+} // namespace
+
+std::int64_t parseTimestamp(std::string_view text) {
+    int year {};
+    int month {};
+    int day {};
+    if (text.size() < 10 || text[4] != '-' || text[7] != '-') return -1;
+    if (!readInt(text, 0, 4, year) || !readInt(text, 5, 2, month) || !readInt(text, 8, 2, day)) return -1;
+    if (month < 1 || month > 12 || day < 1 || day > 31) return -1;
+
+    int hour {};
+    int minute {};
+    if (text.size() >= 16 && text[13] == ':') {
+        if (!readInt(text, 11, 2, hour) || !readInt(text, 14, 2, minute)) return -1;
+    }
+    return daysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day)) * 86400 +
+           hour * 3600 + minute * 60;
+}
+
+std::string formatTimestamp(std::int64_t t) {
+    std::int64_t days = t >= 0 ? t / 86400 : (t - 86399) / 86400;
+    std::int64_t seconds = t - days * 86400;
+
+    // Inverse of daysFromCivil.
+    days += 719468;
+    const std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned day = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned month = mp < 10 ? mp + 3 : mp - 9;
+    const std::int64_t year = static_cast<std::int64_t>(yoe) + era * 400 + (month <= 2);
+
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%04lld-%02u-%02u %02lld:%02lld",
+                  static_cast<long long>(year), month, day,
+                  static_cast<long long>(seconds / 3600), static_cast<long long>(seconds % 3600 / 60));
+    return buffer;
+}
+
+bool parseBar(std::string_view line, PriceBar& bar) {
+    std::string_view fields[6];
+    std::size_t start = 0;
+    for (int i = 0; i < 6; i++) {
+        std::size_t comma = line.find(',', start);
+        if (comma == std::string_view::npos) {
+            if (i != 5) return false;
+            comma = line.size();
+        }
+        fields[i] = line.substr(start, comma - start);
+        start = comma + 1;
+    }
+    bar.time = parseTimestamp(fields[0]);
+    return bar.time >= 0 && readNumber(fields[1], bar.open) && readNumber(fields[2], bar.high) &&
+           readNumber(fields[3], bar.low) && readNumber(fields[4], bar.close) &&
+           readNumber(fields[5], bar.volume);
+}
+
+void ByteHash::add(const char* data, std::size_t size) {
+    for (std::size_t i = 0; i < size; i++) {
+        state ^= static_cast<unsigned char>(data[i]);
+        state *= 0x100000001b3ull;
+    }
+    length += size;
+}
+
+std::uint64_t ByteHash::value() const {
+    std::uint64_t mixed = state ^ (length * 0x9e3779b97f4a7c15ull);
+    mixed ^= mixed >> 31;
+    mixed *= 0xbf58476d1ce4e5b9ull;
+    mixed ^= mixed >> 29;
+    return mixed;
+}
+
+std::uint64_t fingerprintPrefix(const std::string& filepath, std::uint64_t bytes) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) return 0;
+
+    ByteHash hash;
+    std::vector<char> chunk(1 << 20);
+    while (file && hash.length < bytes) {
+        std::uint64_t want = std::min<std::uint64_t>(chunk.size(), bytes - hash.length);
+        file.read(chunk.data(), static_cast<std::streamsize>(want));
+        hash.add(chunk.data(), static_cast<std::size_t>(file.gcount()));
+    }
+    return hash.value();
+}
+
+std::uint64_t fingerprintFile(const std::string& filepath) {
+    return fingerprintPrefix(filepath, UINT64_MAX);
+}
+
+std::vector<PriceRow> loadCSV(const std::string& filepath) {
     std::vector<PriceRow> data;
     std::ifstream file(filepath);
 
@@ -24,6 +213,86 @@ struct PriceRow{
     }
 
     std::string line;
+    PriceBar bar {};
+    while (std::getline(file, line)) {
+        if (!parseBar(line, bar)) continue; // header or broken line
+        data.push_back(PriceRow{line.substr(0, line.find(',')), bar.open, bar.high, bar.low,
+                                bar.close, static_cast<int>(bar.volume)});
+    }
+    return data;
+}
+
+PriceSeries loadSeries(const std::string& filepath, const ValidationPolicy* policy, AnomalyReport* report) {
+    PriceSeries series;
+    for (PriceBlock& block : streamCSV(filepath, 4096, 1 << 20, policy, report)) {
+        const PriceSeries& bars = block.bars;
+        series.time.insert(series.time.end(), bars.time.begin(), bars.time.end());
+        series.open.insert(series.open.end(), bars.open.begin(), bars.open.end());
+        series.high.insert(series.high.end(), bars.high.begin(), bars.high.end());
+        series.low.insert(series.low.end(), bars.low.begin(), bars.low.end());
+        series.close.insert(series.close.end(), bars.close.begin(), bars.close.end());
+        series.volume.insert(series.volume.end(), bars.volume.begin(), bars.volume.end());
+    }
+    return series;
+}
+
+Generator<PriceBlock> streamCSV(std::string filepath, std::size_t block_rows, std::size_t chunk_bytes,
+                                const ValidationPolicy* policy, AnomalyReport* report) {
+    if (block_rows == 0) block_rows = 1;
+    AnomalyReport unused_report;
+    std::optional<BarValidator> validator;
+    if (policy != nullptr) validator.emplace(*policy, report != nullptr ? *report : unused_report);
+
+    ChunkReader reader(filepath, chunk_bytes == 0 ? 1 << 20 : chunk_bytes);
+    if (!reader.isOpen()) {
+        std::cerr << "Error: cannot open file: " << filepath << "\n";
+        co_return;
+    }
 
-    return 0;}
+    PriceBlock block;
+    block.bars.reserve(block_rows);
+    std::size_t rows_done = 0;
+    std::string carry; // partial line left over from the previous chunk
+    std::string chunk;
+    PriceBar bar {};
 
+    while (reader.next(chunk)) {
+        std::size_t start = 0;
+        while (start < chunk.size()) {
+            std::size_t newline = chunk.find('\n', start);
+            if (newline == std::string::npos) {
+                carry.append(chunk, start, std::string::npos);
+                break;
+            }
+
+            std::string_view line(chunk.data() + start, newline - start);
+            if (!carry.empty()) {
+                carry.append(line);
+                line = carry;
+            }
+            if (parseBar(line, bar) && (!validator || validator->add(bar, block.bars))) {
+                block.bars.push(bar.time, bar.open, bar.high, bar.low, bar.close, bar.volume);
+            }
+            carry.clear();
+            start = newline + 1;
+
+            if (block.bars.size() >= block_rows) {
+                block.first_row = rows_done;
+                rows_done += block.bars.size();
+                co_yield std::move(block);
+                block = PriceBlock {};
+                block.bars.reserve(block_rows);
+            }
+        }
+    }
+
+    // Last line without a trailing newline.
+    if (!carry.empty() && parseBar(carry, bar) && (!validator || validator->add(bar, block.bars))) {
+        block.bars.push(bar.time, bar.open, bar.high, bar.low, bar.close, bar.volume);
+    }
+    if (validator) validator->finish(block.bars);
+    if (block.bars.size() > 0) {
+        block.first_row = rows_done;
+        co_yield std::move(block);
+    }
+}
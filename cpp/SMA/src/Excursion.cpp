@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+#include "Excursion.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+
+// Bars after entry through the exit (or the last bar while open).
+bool heldRange(const Trade& trade, std::size_t bars, std::size_t& first, std::size_t& last) {
+    if (bars == 0 || trade.entry_bar < 0) return false;
+    first = static_cast<std::size_t>(trade.entry_bar) + 1;
+    last = trade.exit_bar < 0 ? bars - 1 : std::min(static_cast<std::size_t>(trade.exit_bar), bars - 1);
+    return first <= last;
+}
+
+} // namespace
+
+ExcursionIndex::ExcursionIndex(const PriceView& prices) : high(prices.high), low(prices.low) {
+    const std::size_t n = high.size();
+
+    highest_table.emplace_back(n);
+    lowest_table.emplace_back(n);
+    for (std::size_t i = 0; i < n; i++) highest_table[0][i] = lowest_table[0][i] = static_cast<std::int32_t>(i);
+    for (std::size_t span = 2; span <= n; span *= 2) {
+        const std::vector<std::int32_t>& highs = highest_table.back();
+        const std::vector<std::int32_t>& lows = lowest_table.back();
+        std::vector<std::int32_t> next_highs(n - span + 1);
+        std::vector<std::int32_t> next_lows(n - span + 1);
+        for (std::size_t i = 0; i + span <= n; i++) {
+            const std::int32_t a = highs[i], b = highs[i + span / 2];
+            next_highs[i] = high[b] > high[a] ? b : a;
+            const std::int32_t c = lows[i], d = lows[i + span / 2];
+            next_lows[i] = low[d] < low[c] ? d : c;
+        }
+        highest_table.push_back(std::move(next_highs));
+        lowest_table.push_back(std::move(next_lows));
+    }
+
+    leaves = std::bit_ceil(std::max<std::size_t>(1, n));
+    tree.assign(2 * leaves, Node{0.0, std::numeric_limits<double>::infinity(), 0.0});
+    for (std::size_t i = 0; i < n; i++) tree[leaves + i] = Node{high[i], low[i], 1.0 - low[i] / high[i]};
+    for (std::size_t i = leaves; i-- > 1;) tree[i] = combine(tree[2 * i], tree[2 * i + 1]);
+}
+
+ExcursionIndex::Node ExcursionIndex::combine(const Node& left, const Node& right) {
+    // An empty side has high 0 and low +inf, which makes the cross term -inf.
+    return Node{std::max(left.high, right.high), std::min(left.low, right.low),
+                std::max({left.fall, right.fall, 1.0 - right.low / left.high})};
+}
+
+ExcursionIndex::Node ExcursionIndex::fallOver(std::size_t first, std::size_t last) const {
+    // Bottom-up walk; the two sides are kept apart because combine is not commutative.
+    Node left{0.0, std::numeric_limits<double>::infinity(), 0.0};
+    Node right = left;
+    for (std::size_t l = first + leaves, r = last + leaves + 1; l < r; l /= 2, r /= 2) {
+        if (l & 1) left = combine(left, tree[l++]);
+        if (r & 1) right = combine(tree[--r], right);
+    }
+    return combine(left, right);
+}
+
+std::size_t ExcursionIndex::highest(std::size_t first, std::size_t last) const {
+    const std::size_t level = static_cast<std::size_t>(std::bit_width(last - first + 1)) - 1;
+    const std::int32_t a = highest_table[level][first];
+    const std::int32_t b = highest_table[level][last + 1 - (std::size_t{1} << level)];
+    return static_cast<std::size_t>(high[b] > high[a] ? b : a);
+}
+
+std::size_t ExcursionIndex::lowest(std::size_t first, std::size_t last) const {
+    const std::size_t level = static_cast<std::size_t>(std::bit_width(last - first + 1)) - 1;
+    const std::int32_t a = lowest_table[level][first];
+    const std::int32_t b = lowest_table[level][last + 1 - (std::size_t{1} << level)];
+    return static_cast<std::size_t>(low[b] < low[a] ? b : a);
+}
+
+TradeExcursion ExcursionIndex::measure(const Trade& trade) const {
+    TradeExcursion out;
+    std::size_t first = 0;
+    std::size_t last = 0;
+    if (!heldRange(trade, size(), first, last)) return out;
+
+    const std::size_t peak = highest(first, last);
+    const std::size_t trough = lowest(first, last);
+    const double entry = trade.entry_price;
+    out.favorable = high[peak] / entry - 1.0;
+    out.adverse = 1.0 - low[trough] / entry;
+    out.drawdown = std::max({0.0, out.adverse, fallOver(first, last).fall});
+    out.bars_to_peak = static_cast<int>(peak) - trade.entry_bar;
+    out.bars_to_trough = static_cast<int>(trough) - trade.entry_bar;
+    out.bars = static_cast<int>(last - first + 1);
+    return out;
+}
+
+void ExcursionIndex::measure(std::span<const Trade> trades, std::span<TradeExcursion> out, ThreadPool* pool) const {
+    constexpr std::size_t chunk = 4096;
+    auto run = [this, trades, out](std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; i++) out[i] = measure(trades[i]);
+    };
+    if (pool == nullptr) {
+        run(0, trades.size());
+        return;
+    }
+    for (std::size_t first = 0; first < trades.size(); first += chunk) {
+        const std::size_t last = std::min(trades.size(), first + chunk);
+        pool->submit([run, first, last] { run(first, last); });
+    }
+    pool->wait();
+}
+
+TradeExcursion scanExcursion(const PriceView& prices, const Trade& trade) {
+    TradeExcursion out;
+    std::size_t first = 0;
+    std::size_t last = 0;
+    if (!heldRange(trade, prices.size(), first, last)) return out;
+
+    // A bar's high is taken to come before its low, the pessimistic reading.
+    std::size_t peak = first;
+    std::size_t trough = first;
+    double running = trade.entry_price;
+    for (std::size_t i = first; i <= last; i++) {
+        if (prices.high[i] > prices.high[peak]) peak = i;
+        if (prices.low[i] < prices.low[trough]) trough = i;
+        running = std::max(running, prices.high[i]);
+        out.drawdown = std::max(out.drawdown, 1.0 - prices.low[i] / running);
+    }
+    out.favorable = prices.high[peak] / trade.entry_price - 1.0;
+    out.adverse = 1.0 - prices.low[trough] / trade.entry_price;
+    out.bars_to_peak = static_cast<int>(peak) - trade.entry_bar;
+    out.bars_to_trough = static_cast<int>(trough) - trade.entry_bar;
+    out.bars = static_cast<int>(last - first + 1);
+    return out;
+}
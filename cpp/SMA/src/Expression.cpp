@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <utility>
+
+#include "Expression.hpp"
+#include "Indicators.hpp"
+
+namespace {
+
+bool isCommutative(ExprOp op) {
+    return op == ExprOp::Add || op == ExprOp::Mul || op == ExprOp::Equal || op == ExprOp::NotEqual ||
+           op == ExprOp::And || op == ExprOp::Or;
+}
+
+double applyBinary(ExprOp op, double x, double y) {
+    switch (op) {
+    case ExprOp::Add: return x + y;
+    case ExprOp::Sub: return x - y;
+    case ExprOp::Mul: return x * y;
+    case ExprOp::Div: return x / y;
+    case ExprOp::Less: return x < y ? 1.0 : 0.0;
+    case ExprOp::LessEqual: return x <= y ? 1.0 : 0.0;
+    case ExprOp::Greater: return x > y ? 1.0 : 0.0;
+    case ExprOp::GreaterEqual: return x >= y ? 1.0 : 0.0;
+    case ExprOp::Equal: return x == y ? 1.0 : 0.0;
+    case ExprOp::NotEqual: return x != y ? 1.0 : 0.0;
+    case ExprOp::And: return (x != 0.0) & (y != 0.0) ? 1.0 : 0.0;
+    case ExprOp::Or: return (x != 0.0) | (y != 0.0) ? 1.0 : 0.0;
+    default: return 0.0;
+    }
+}
+
+// Element-wise kernels. Plain loops over restrict pointers so they vectorize.
+template <typename Fn>
+void mapUnary(double* __restrict dst, const double* __restrict x, std::size_t count, Fn fn) {
+    for (std::size_t i = 0; i < count; i++) dst[i] = fn(x[i]);
+}
+
+template <typename Fn>
+void mapBinary(double* __restrict dst, const double* __restrict x, const double* __restrict y,
+               std::size_t count, Fn fn) {
+    for (std::size_t i = 0; i < count; i++) dst[i] = fn(x[i], y[i]);
+}
+
+// Streams a block through a stateful indicator. Working on a local copy lets the
+// compiler keep the state in registers instead of reloading it after every store to dst.
+template <typename Indicator>
+void runIndicator(Indicator& state, double* dst, const double* x, std::size_t count) {
+    Indicator local = std::move(state);
+    for (std::size_t i = 0; i < count; i++) dst[i] = local.update(x[i]);
+    state = std::move(local);
+}
+
+void evaluateBinary(ExprOp op, double* dst, const double* x, const double* y, std::size_t count) {
+    switch (op) {
+    case ExprOp::Add: mapBinary(dst, x, y, count, [](double a, double b) { return a + b; }); break;
+    case ExprOp::Sub: mapBinary(dst, x, y, count, [](double a, double b) { return a - b; }); break;
+    case ExprOp::Mul: mapBinary(dst, x, y, count, [](double a, double b) { return a * b; }); break;
+    case ExprOp::Div: mapBinary(dst, x, y, count, [](double a, double b) { return a / b; }); break;
+    case ExprOp::Less: mapBinary(dst, x, y, count, [](double a, double b) { return a < b ? 1.0 : 0.0; }); break;
+    case ExprOp::LessEqual: mapBinary(dst, x, y, count, [](double a, double b) { return a <= b ? 1.0 : 0.0; }); break;
+    case ExprOp::Greater: mapBinary(dst, x, y, count, [](double a, double b) { return a > b ? 1.0 : 0.0; }); break;
+    case ExprOp::GreaterEqual: mapBinary(dst, x, y, count, [](double a, double b) { return a >= b ? 1.0 : 0.0; }); break;
+    case ExprOp::Equal: mapBinary(dst, x, y, count, [](double a, double b) { return a == b ? 1.0 : 0.0; }); break;
+    case ExprOp::NotEqual: mapBinary(dst, x, y, count, [](double a, double b) { return a != b ? 1.0 : 0.0; }); break;
+    case ExprOp::And:
+        mapBinary(dst, x, y, count, [](double a, double b) { return (a != 0.0) & (b != 0.0) ? 1.0 : 0.0; });
+        break;
+    case ExprOp::Or:
+        mapBinary(dst, x, y, count, [](double a, double b) { return (a != 0.0) | (b != 0.0) ? 1.0 : 0.0; });
+        break;
+    default: break;
+    }
+}
+
+// Recursive-descent parser. Each production returns a node index, -1 on error.
+class Parser {
+public:
+    Parser(const std::string& text, ExprProgram& program) : text(text), program(program) {}
+
+    int parse(std::string& error) {
+        int root = parseOr();
+        skipSpace();
+        if (root >= 0 && pos != text.size()) fail("unexpected '" + text.substr(pos, 1) + "'");
+        if (!message.empty()) {
+            error = message + " at position " + std::to_string(error_pos);
+            return -1;
+        }
+        return root;
+    }
+
+private:
+    void skipSpace() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+    }
+
+    int fail(const std::string& what) {
+        if (message.empty()) {
+            message = what;
+            error_pos = pos;
+        }
+        return -1;
+    }
+
+    bool accept(const std::string& token) {
+        skipSpace();
+        if (text.compare(pos, token.size(), token) != 0) return false;
+        // Keywords must not run into an identifier ("order" is not "or").
+        if (std::isalpha(static_cast<unsigned char>(token[0])) && pos + token.size() < text.size()) {
+            char next = text[pos + token.size()];
+            if (std::isalnum(static_cast<unsigned char>(next)) || next == '_') return false;
+        }
+        pos += token.size();
+        return true;
+    }
+
+    std::string identifier() {
+        skipSpace();
+        std::size_t start = pos;
+        while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '_')) pos++;
+        std::string name = text.substr(start, pos - start);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        return name;
+    }
+
+    int binary(ExprOp op, int a, int b) {
+        if (a < 0 || b < 0) return -1;
+        ExprNode node;
+        node.op = op;
+        node.a = a;
+        node.b = b;
+        return program.intern(node);
+    }
+
+    int unary(ExprOp op, int a, int window = 0) {
+        if (a < 0) return -1;
+        ExprNode node;
+        node.op = op;
+        node.a = a;
+        node.window = window;
+        return program.intern(node);
+    }
+
+    int parseOr() {
+        int left = parseAnd();
+        while (left >= 0 && accept("or")) left = binary(ExprOp::Or, left, parseAnd());
+        return left;
+    }
+
+    int parseAnd() {
+        int left = parseNot();
+        while (left >= 0 && accept("and")) left = binary(ExprOp::And, left, parseNot());
+        return left;
+    }
+
+    int parseNot() {
+        if (accept("not")) return unary(ExprOp::Not, parseNot());
+        return parseComparison();
+    }
+
+    int parseComparison() {
+        int left = parseAdditive();
+        if (left < 0) return -1;
+        // Two-character operators first so "<=" is not read as "<".
+        if (accept("<=")) return binary(ExprOp::LessEqual, left, parseAdditive());
+        if (accept(">=")) return binary(ExprOp::GreaterEqual, left, parseAdditive());
+        if (accept("==")) return binary(ExprOp::Equal, left, parseAdditive());
+        if (accept("!=")) return binary(ExprOp::NotEqual, left, parseAdditive());
+        if (accept("<")) return binary(ExprOp::Less, left, parseAdditive());
+        if (accept(">")) return binary(ExprOp::Greater, left, parseAdditive());
+        return left;
+    }
+
+    int parseAdditive() {
+        int left = parseMultiplicative();
+        while (left >= 0) {
+            if (accept("+")) left = binary(ExprOp::Add, left, parseMultiplicative());
+            else if (accept("-")) left = binary(ExprOp::Sub, left, parseMultiplicative());
+            else break;
+        }
+        return left;
+    }
+
+    int parseMultiplicative() {
+        int left = parseUnary();
+        while (left >= 0) {
+            if (accept("*")) left = binary(ExprOp::Mul, left, parseUnary());
+            else if (accept("/")) left = binary(ExprOp::Div, left, parseUnary());
+            else break;
+        }
+        return left;
+    }
+
+    int parseUnary() {
+        if (accept("-")) return unary(ExprOp::Neg, parseUnary());
+        return parsePrimary();
+    }
+
+    int parsePrimary() {
+        skipSpace();
+        if (pos >= text.size()) return fail("unexpected end of rule");
+
+        if (accept("(")) {
+            int inner = parseOr();
+            if (inner >= 0 && !accept(")")) return fail("expected ')'");
+            return inner;
+        }
+
+        char c = text[pos];
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            const char* start = text.c_str() + pos;
+            char* end = nullptr;
+            double value = std::strtod(start, &end);
+            if (end == start) return fail("bad number");
+            pos += static_cast<std::size_t>(end - start);
+            ExprNode node;
+            node.op = ExprOp::Constant;
+            node.value = value;
+            return program.intern(node);
+        }
+
+        if (!std::isalpha(static_cast<unsigned char>(c))) return fail("unexpected '" + std::string(1, c) + "'");
+        std::size_t name_pos = pos;
+        std::string name = identifier();
+
+        static const char* columns[] = {"open", "high", "low", "close", "volume"};
+        for (int i = 0; i < 5; i++) {
+            if (name == columns[i]) {
+                ExprNode node;
+                node.op = ExprOp::Column;
+                node.column = i;
+                return program.intern(node);
+            }
+        }
+
+        ExprOp op;
+        if (name == "sma") op = ExprOp::Sma;
+        else if (name == "ema") op = ExprOp::Ema;
+        else if (name == "rsi") op = ExprOp::Rsi;
+        else {
+            pos = name_pos;
+            return fail("unknown name '" + name + "'");
+        }
+
+        if (!accept("(")) return fail("expected '(' after " + name);
+        int input = parseOr();
+        if (input < 0) return -1;
+        if (!accept(",")) return fail("expected ',' in " + name + "()");
+        skipSpace();
+        const char* start = text.c_str() + pos;
+        char* end = nullptr;
+        long window = std::strtol(start, &end, 10);
+        if (end == start || window < 1) return fail(name + "() needs a positive whole window");
+        pos += static_cast<std::size_t>(end - start);
+        if (!accept(")")) return fail("expected ')'");
+        return unary(op, input, static_cast<int>(window));
+    }
+
+    const std::string& text;
+    ExprProgram& program;
+    std::size_t pos {};
+    std::string message;
+    std::size_t error_pos {};
+};
+
+} // namespace
+
+int ExprProgram::intern(const ExprNode& input) {
+    ExprNode node = input;
+    if (isCommutative(node.op) && node.a > node.b) std::swap(node.a, node.b);
+
+    // Fold operations on constants so "10 * 2" and "20" share a node.
+    auto isConstant = [&](int id) { return id >= 0 && nodes[id].op == ExprOp::Constant; };
+    if (node.b >= 0 && isConstant(node.a) && isConstant(node.b)) {
+        ExprNode folded;
+        folded.op = ExprOp::Constant;
+        folded.value = applyBinary(node.op, nodes[node.a].value, nodes[node.b].value);
+        return intern(folded);
+    }
+    if ((node.op == ExprOp::Neg || node.op == ExprOp::Not) && isConstant(node.a)) {
+        ExprNode folded;
+        folded.op = ExprOp::Constant;
+        double x = nodes[node.a].value;
+        folded.value = node.op == ExprOp::Neg ? -x : (x == 0.0 ? 1.0 : 0.0);
+        return intern(folded);
+    }
+
+    NodeKey key {static_cast<int>(node.op), node.a, node.b, node.column, node.window, node.value};
+    auto found = node_ids.find(key);
+    if (found != node_ids.end()) return found->second;
+
+    int id = static_cast<int>(nodes.size());
+    nodes.push_back(node);
+    node_ids.emplace(key, id);
+    return id;
+}
+
+int ExprProgram::addRule(const std::string& text, std::string& error) {
+    // Parse into a scratch copy so a bad rule leaves the DAG untouched.
+    ExprProgram scratch = *this;
+    Parser parser(text, scratch);
+    int root = parser.parse(error);
+    if (root < 0) return -1;
+
+    *this = std::move(scratch);
+    rules.push_back(root);
+    return static_cast<int>(rules.size()) - 1;
+}
+
+std::vector<std::vector<double>> ExprProgram::evaluate(const PriceView& prices, std::size_t block_rows) const {
+    const std::size_t bars = prices.size();
+    if (block_rows == 0) block_rows = 2048;
+
+    std::vector<std::vector<double>> results(rules.size(), std::vector<double>(bars));
+
+    // One block-sized buffer per computed node; column nodes point straight
+    // into the price data instead.
+    std::vector<std::vector<double>> buffers(nodes.size());
+    std::vector<const double*> data(nodes.size());
+    std::vector<int> state(nodes.size(), -1);
+    std::vector<RollingMean> smas;
+    std::vector<ExponentialMean> emas;
+    std::vector<RelativeStrengthIndex> rsis;
+
+    for (std::size_t k = 0; k < nodes.size(); k++) {
+        const ExprNode& node = nodes[k];
+        if (node.op == ExprOp::Column && node.column != 4) continue;
+        buffers[k].assign(block_rows, node.op == ExprOp::Constant ? node.value : 0.0);
+        data[k] = buffers[k].data();
+        if (node.op == ExprOp::Sma) {
+            state[k] = static_cast<int>(smas.size());
+            smas.emplace_back(node.window);
+        } else if (node.op == ExprOp::Ema) {
+            state[k] = static_cast<int>(emas.size());
+            emas.emplace_back(node.window);
+        } else if (node.op == ExprOp::Rsi) {
+            state[k] = static_cast<int>(rsis.size());
+            rsis.emplace_back(node.window);
+        }
+    }
+
+    const std::span<const double> columns[] = {prices.open, prices.high, prices.low, prices.close};
+
+    for (std::size_t first = 0; first < bars; first += block_rows) {
+        const std::size_t count = std::min(block_rows, bars - first);
+
+        for (std::size_t k = 0; k < nodes.size(); k++) {
+            const ExprNode& node = nodes[k];
+            double* dst = buffers[k].data();
+            const double* x = node.a >= 0 ? data[node.a] : nullptr;
+            const double* y = node.b >= 0 ? data[node.b] : nullptr;
+
+            switch (node.op) {
+            case ExprOp::Column:
+                if (node.column == 4) {
+                    for (std::size_t i = 0; i < count; i++) dst[i] = static_cast<double>(prices.volume[first + i]);
+                } else {
+                    data[k] = columns[node.column].data() + first;
+                }
+                break;
+            case ExprOp::Constant:
+                break;
+            case ExprOp::Neg:
+                mapUnary(dst, x, count, [](double a) { return -a; });
+                break;
+            case ExprOp::Not:
+                mapUnary(dst, x, count, [](double a) { return a == 0.0 ? 1.0 : 0.0; });
+                break;
+            case ExprOp::Sma:
+                smas[state[k]].update({x, count}, dst);
+                break;
+            case ExprOp::Ema:
+                runIndicator(emas[state[k]], dst, x, count);
+                break;
+            case ExprOp::Rsi:
+                runIndicator(rsis[state[k]], dst, x, count);
+                break;
+            default:
+                evaluateBinary(node.op, dst, x, y, count);
+                break;
+            }
+        }
+
+        for (std::size_t r = 0; r < rules.size(); r++) {
+            const double* src = data[rules[r]];
+            std::copy(src, src + count, results[r].begin() + static_cast<std::ptrdiff_t>(first));
+        }
+    }
+    return results;
+}
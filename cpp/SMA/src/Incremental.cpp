@@ -0,0 +1,221 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include "BinaryIO.hpp"
+#include "Incremental.hpp"
+
+namespace {
+
+constexpr std::uint64_t state_magic = 0x31434e49414d53ull; // "SMAINC1"
+
+struct RunState {
+    std::uint64_t offset {};      // bytes consumed, always just after a newline
+    std::uint64_t prefix_hash {}; // ByteHash value of bytes [0, offset)
+    ByteHash hash;                // running hash of the consumed bytes
+    std::uint64_t bars {};
+    std::int64_t last_time = -1;
+    std::vector<SmaCrossStrategy> strategies;
+    std::vector<Backtester> backtesters;
+};
+
+void freshState(RunState& state, const std::vector<SmaParams>& strategies, const BacktestConfig& config) {
+    state = RunState {};
+    for (const SmaParams& params : strategies) {
+        state.strategies.emplace_back(params);
+        state.backtesters.emplace_back(config);
+    }
+}
+
+bool loadState(const std::string& state_path, const std::vector<SmaParams>& strategies,
+               const BacktestConfig& config, RunState& state, std::string& reason) {
+    std::ifstream in(state_path, std::ios::binary);
+    if (!in.is_open()) {
+        reason = "no saved state";
+        return false;
+    }
+
+    std::uint64_t magic {};
+    int engine {};
+    BacktestConfig saved_config;
+    std::uint64_t count {};
+    if (!readValue(in, magic) || magic != state_magic || !readValue(in, engine) ||
+        !readValue(in, saved_config.initial_cash) || !readValue(in, saved_config.cost_bps) || !readValue(in, count)) {
+        reason = "unreadable state file";
+        return false;
+    }
+    if (engine != backtest_engine_version) {
+        reason = "engine version changed";
+        return false;
+    }
+    if (saved_config.initial_cash != config.initial_cash || saved_config.cost_bps != config.cost_bps ||
+        count != strategies.size()) {
+        reason = "strategies or config changed";
+        return false;
+    }
+    for (const SmaParams& params : strategies) {
+        SmaParams saved;
+        if (!readValue(in, saved.fast) || !readValue(in, saved.slow) ||
+            saved.fast != params.fast || saved.slow != params.slow) {
+            reason = "strategies or config changed";
+            return false;
+        }
+    }
+
+    freshState(state, strategies, config);
+    bool ok = readValue(in, state.offset) && readValue(in, state.prefix_hash) &&
+              readValue(in, state.bars) && readValue(in, state.last_time);
+    for (std::size_t s = 0; ok && s < strategies.size(); s++) {
+        ok = state.strategies[s].load(in) && state.backtesters[s].load(in);
+    }
+    if (!ok) reason = "unreadable state file";
+    return ok;
+}
+
+bool saveState(const std::string& state_path, const std::vector<SmaParams>& strategies,
+               const BacktestConfig& config, const RunState& state) {
+    // Write next to the old file and rename over it, so a crash never leaves half a state.
+    std::string temp_path = state_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        writeValue(out, state_magic);
+        writeValue(out, backtest_engine_version);
+        writeValue(out, config.initial_cash);
+        writeValue(out, config.cost_bps);
+        writeValue(out, static_cast<std::uint64_t>(strategies.size()));
+        for (const SmaParams& params : strategies) {
+            writeValue(out, params.fast);
+            writeValue(out, params.slow);
+        }
+        writeValue(out, state.offset);
+        writeValue(out, state.prefix_hash);
+        writeValue(out, state.bars);
+        writeValue(out, state.last_time);
+        for (std::size_t s = 0; s < strategies.size(); s++) {
+            state.strategies[s].save(out);
+            state.backtesters[s].save(out);
+        }
+        if (!out) return false;
+    }
+    return std::rename(temp_path.c_str(), state_path.c_str()) == 0;
+}
+
+// Feeds every complete line from state.offset on. A row that does not move
+// time forward (a duplicate or backdated row) is skipped and counted in
+// `rejected`, as BarValidator drops out-of-order bars. Returns false if any
+// row was skipped.
+bool consume(const std::string& filepath, RunState& state, std::size_t& new_bars, std::size_t& rejected) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) return false;
+    file.seekg(static_cast<std::streamoff>(state.offset));
+
+    std::string chunk(1 << 20, '\0');
+    std::string carry;
+    PriceBar bar {};
+    while (file) {
+        file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        std::size_t got = static_cast<std::size_t>(file.gcount());
+        std::size_t start = 0;
+        while (start < got) {
+            const char* newline = static_cast<const char*>(std::memchr(chunk.data() + start, '\n', got - start));
+            if (newline == nullptr) {
+                carry.append(chunk, start, got - start);
+                break;
+            }
+            std::size_t end = static_cast<std::size_t>(newline - chunk.data());
+            carry.append(chunk, start, end - start);
+            state.offset += carry.size() + 1;
+            state.hash.add(carry.data(), carry.size());
+            state.hash.add("\n", 1);
+            start = end + 1;
+
+            if (parseBar(carry, bar)) {
+                if (bar.time <= state.last_time) {
+                    rejected++;
+                } else {
+                    for (std::size_t s = 0; s < state.strategies.size(); s++) {
+                        state.backtesters[s].onBar(bar.close, state.strategies[s].onBar(bar.close));
+                    }
+                    state.last_time = bar.time;
+                    state.bars++;
+                    new_bars++;
+                }
+            }
+            carry.clear();
+        }
+    }
+    return rejected == 0;
+}
+
+} // namespace
+
+std::vector<BacktestResult> runIncrementalBacktest(const std::string& filepath, const std::string& state_path,
+                                                   const std::vector<SmaParams>& strategies,
+                                                   const BacktestConfig& config, IncrementalStats& stats) {
+    stats = IncrementalStats {};
+    RunState state;
+
+    std::uint64_t file_size = 0;
+    {
+        std::ifstream probe(filepath, std::ios::binary | std::ios::ate);
+        if (!probe.is_open()) {
+            std::cerr << "Error: cannot open file: " << filepath << "\n";
+            return {};
+        }
+        file_size = static_cast<std::uint64_t>(probe.tellg());
+    }
+
+    stats.resumed = loadState(state_path, strategies, config, state, stats.reason);
+    if (stats.resumed) {
+        // The file must still start with exactly the bytes already processed.
+        bool same_prefix = state.offset <= file_size;
+        if (same_prefix) {
+            std::ifstream file(filepath, std::ios::binary);
+            std::vector<char> chunk(1 << 20);
+            while (file && state.hash.length < state.offset) {
+                std::uint64_t want = std::min<std::uint64_t>(chunk.size(), state.offset - state.hash.length);
+                file.read(chunk.data(), static_cast<std::streamsize>(want));
+                if (file.gcount() == 0) break;
+                state.hash.add(chunk.data(), static_cast<std::size_t>(file.gcount()));
+            }
+            same_prefix = state.hash.length == state.offset && state.hash.value() == state.prefix_hash;
+        }
+        if (!same_prefix) {
+            stats.resumed = false;
+            stats.reason = "earlier rows changed";
+        }
+    }
+    // New rows going back in time mean the file was rewritten rather than appended.
+    if (stats.resumed && !consume(filepath, state, stats.new_bars, stats.rejected)) {
+        stats.resumed = false;
+        stats.reason = "new rows are out of order";
+    }
+
+    if (!stats.resumed) {
+        freshState(state, strategies, config);
+        stats.new_bars = 0;
+        stats.rejected = 0;
+        consume(filepath, state, stats.new_bars, stats.rejected);
+    }
+
+    // State past a skipped row would let a later run resume over it and
+    // report a different answer; keep recomputing until the file is fixed.
+    if (stats.rejected > 0) {
+        std::cerr << "Error: " << stats.rejected << " out-of-order rows skipped in " << filepath
+                  << ", state not saved\n";
+    } else {
+        state.prefix_hash = state.hash.value();
+        if (!saveState(state_path, strategies, config, state)) {
+            std::cerr << "Error: cannot save state: " << state_path << "\n";
+        }
+    }
+
+    stats.total_bars = state.bars;
+    std::vector<BacktestResult> results;
+    for (const Backtester& backtester : state.backtesters) results.push_back(backtester.result());
+    return results;
+}
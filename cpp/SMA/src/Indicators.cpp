@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+#include "BinaryIO.hpp"
+#include "Indicators.hpp"
+#include "Numerics.hpp"
+
+RollingMean::RollingMean(int window, bool reanchor)
+    : buffer(window > 0 ? window : 1), length(window > 0 ? window : 1),
+      until_reanchor(reanchor ? std::int64_t {reanchor_windows} * length
+                              : std::numeric_limits<std::int64_t>::max()) {}
+
+void RollingMean::reanchor() {
+    sum = compensatedSum(buffer);
+    until_reanchor = std::int64_t {reanchor_windows} * length;
+}
+
+void RollingMean::update(std::span<const double> values, double* out) {
+    const std::size_t n = values.size();
+    std::size_t i = 0;
+    for (; i < n && count < length; i++) out[i] = update(values[i]);
+
+    const double divisor = length;
+    double* ring = buffer.data();
+    while (i < n) {
+        const std::size_t stop = i + static_cast<std::size_t>(std::min<std::int64_t>(
+                                         until_reanchor, static_cast<std::int64_t>(n - i)));
+        until_reanchor -= static_cast<std::int64_t>(stop - i);
+        double local = sum;
+        while (i < stop) {
+            const std::size_t run = std::min(stop - i, static_cast<std::size_t>(length - next));
+            double* slot = ring + next;
+            for (std::size_t k = 0; k < run; k++) {
+                local -= slot[k];
+                slot[k] = values[i + k];
+                local += values[i + k];
+                out[i + k] = local / divisor;
+            }
+            i += run;
+            next += static_cast<int>(run);
+            if (next == length) next = 0;
+        }
+        sum = local;
+        if (until_reanchor == 0) {
+            reanchor();
+            out[i - 1] = value();
+        }
+    }
+}
+
+void RollingMean::save(std::ostream& out) const {
+    writeValue(out, length);
+    writeValue(out, next);
+    writeValue(out, count);
+    writeValue(out, until_reanchor);
+    writeValue(out, sum);
+    writeVector(out, buffer);
+}
+
+bool RollingMean::load(std::istream& in) {
+    int saved_length {};
+    if (!readValue(in, saved_length) || saved_length != length) return false;
+    return readValue(in, next) && readValue(in, count) && readValue(in, until_reanchor) && readValue(in, sum) &&
+           readVector(in, buffer, static_cast<std::uint64_t>(length)) && buffer.size() == static_cast<std::size_t>(length);
+}
+
+ExponentialMean::ExponentialMean(int window)
+    : length(window > 0 ? window : 1), alpha(2.0 / (length + 1.0)) {}
+
+double ExponentialMean::update(double value) {
+    if (count < length) {
+        // Warm-up: plain average of the first `length` values.
+        count++;
+        average += (value - average) / count;
+        if (count < length) return std::numeric_limits<double>::quiet_NaN();
+        return average;
+    }
+    average += alpha * (value - average);
+    return average;
+}
+
+RelativeStrengthIndex::RelativeStrengthIndex(int window) : length(window > 0 ? window : 1) {}
+
+double RelativeStrengthIndex::update(double close) {
+    if (count == 0) {
+        previous = close;
+        count++;
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    const double change = close - previous;
+    const double gain = change > 0.0 ? change : 0.0;
+    const double loss = change < 0.0 ? -change : 0.0;
+    previous = close;
+
+    if (count <= length) {
+        // First `length` changes: simple averages.
+        average_gain += (gain - average_gain) / count;
+        average_loss += (loss - average_loss) / count;
+        count++;
+        if (count <= length) return std::numeric_limits<double>::quiet_NaN();
+    } else {
+        average_gain = (average_gain * (length - 1) + gain) / length;
+        average_loss = (average_loss * (length - 1) + loss) / length;
+    }
+
+    if (average_loss == 0.0) return 100.0;
+    return 100.0 - 100.0 / (1.0 + average_gain / average_loss);
+}
+
+namespace {
+
+// Linear interpolation between order statistics at h = (n - 1) q, shared by
+// the streaming and the whole-column versions so they agree bit for bit.
+template <typename At>
+double interpolatedQuantile(std::size_t n, double q, At at) {
+    const double h = static_cast<double>(n - 1) * std::clamp(q, 0.0, 1.0);
+    const std::size_t below = static_cast<std::size_t>(h);
+    const double fraction = h - static_cast<double>(below);
+    const double low = at(below);
+    if (fraction == 0.0 || below + 1 >= n) return low;
+    return low + fraction * (at(below + 1) - low);
+}
+
+double percentOf(std::size_t below, std::size_t at_most, std::size_t n) {
+    return (static_cast<double>(below) + 0.5 * static_cast<double>(at_most - below)) / static_cast<double>(n) * 100.0;
+}
+
+// Counts per value rank, for the whole-column order statistics.
+class RankCounts {
+public:
+    explicit RankCounts(std::size_t ranks) : tree(ranks + 1), top(std::bit_floor(std::max<std::size_t>(1, ranks))) {}
+
+    void add(std::size_t rank, int delta) {
+        for (std::size_t i = rank + 1; i < tree.size(); i += i & (~i + 1)) tree[i] += delta;
+    }
+    // Values with rank < `rank`.
+    std::size_t countBelow(std::size_t rank) const {
+        int total = 0;
+        for (std::size_t i = rank; i > 0; i -= i & (~i + 1)) total += tree[i];
+        return static_cast<std::size_t>(total);
+    }
+    // Rank of the k-th smallest value (0-based), by descending the implicit tree.
+    std::size_t kth(std::size_t k) const {
+        std::size_t position = 0;
+        int remaining = static_cast<int>(k) + 1;
+        for (std::size_t step = top; step > 0; step /= 2) {
+            if (position + step < tree.size() && tree[position + step] < remaining) {
+                position += step;
+                remaining -= tree[position];
+            }
+        }
+        return position;
+    }
+
+private:
+    std::vector<int> tree;
+    std::size_t top;
+};
+
+// Sorted distinct values and each value's index among them. NaN is left out
+// of the keys and its rank is not used.
+void rankValues(std::span<const double> values, std::vector<double>& keys, std::vector<std::uint32_t>& ranks) {
+    keys.clear();
+    for (double v : values) {
+        if (!std::isnan(v)) keys.push_back(v);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    ranks.resize(values.size());
+    for (std::size_t i = 0; i < values.size(); i++) {
+        ranks[i] = static_cast<std::uint32_t>(std::lower_bound(keys.begin(), keys.end(), values[i]) - keys.begin());
+    }
+}
+
+} // namespace
+
+IndexableSkiplist::IndexableSkiplist(std::size_t capacity)
+    : levels(std::max(1, static_cast<int>(std::bit_width(capacity)))) {
+    values = {0.0, std::numeric_limits<double>::infinity()};
+    node_levels = {static_cast<std::uint8_t>(levels), 0};
+    links.assign(2 * static_cast<std::size_t>(levels), end);
+    widths.assign(2 * static_cast<std::size_t>(levels), 1);
+    values.reserve(capacity + 2);
+    node_levels.reserve(capacity + 2);
+    links.reserve((capacity + 2) * static_cast<std::size_t>(levels));
+    widths.reserve((capacity + 2) * static_cast<std::size_t>(levels));
+}
+
+int IndexableSkiplist::randomLevel() {
+    // xorshift64; each further level with probability 1/2
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return std::min(levels, 1 + std::countr_zero(state | (1ull << 63)));
+}
+
+void IndexableSkiplist::insert(double value) {
+    std::int32_t chain[64];
+    std::size_t steps_at[64];
+    std::int32_t node = head;
+    for (int level = levels - 1; level >= 0; level--) {
+        steps_at[level] = 0;
+        while (values[next(node, level)] <= value) {
+            steps_at[level] += width(node, level);
+            node = next(node, level);
+        }
+        chain[level] = node;
+    }
+
+    std::int32_t added;
+    if (!free_nodes.empty()) {
+        added = free_nodes.back();
+        free_nodes.pop_back();
+    } else {
+        added = static_cast<std::int32_t>(values.size());
+        values.push_back(0.0);
+        node_levels.push_back(0);
+        links.resize(links.size() + static_cast<std::size_t>(levels));
+        widths.resize(widths.size() + static_cast<std::size_t>(levels));
+    }
+    const int height = randomLevel();
+    values[added] = value;
+    node_levels[added] = static_cast<std::uint8_t>(height);
+
+    std::size_t steps = 0;
+    for (int level = 0; level < height; level++) {
+        const std::int32_t previous = chain[level];
+        next(added, level) = next(previous, level);
+        next(previous, level) = added;
+        width(added, level) = width(previous, level) - steps;
+        width(previous, level) = steps + 1;
+        steps += steps_at[level];
+    }
+    for (int level = height; level < levels; level++) width(chain[level], level)++;
+    count++;
+}
+
+bool IndexableSkiplist::erase(double value) {
+    std::int32_t chain[64];
+    std::int32_t node = head;
+    for (int level = levels - 1; level >= 0; level--) {
+        while (values[next(node, level)] < value) node = next(node, level);
+        chain[level] = node;
+    }
+    const std::int32_t removed = next(chain[0], 0);
+    if (removed == end || values[removed] != value) return false;
+
+    const int height = node_levels[removed];
+    for (int level = 0; level < height; level++) {
+        const std::int32_t previous = chain[level];
+        width(previous, level) += width(removed, level) - 1;
+        next(previous, level) = next(removed, level);
+    }
+    for (int level = height; level < levels; level++) width(chain[level], level)--;
+    free_nodes.push_back(removed);
+    count--;
+    return true;
+}
+
+double IndexableSkiplist::at(std::size_t k) const {
+    std::int32_t node = head;
+    std::size_t remaining = k + 1;
+    for (int level = levels - 1; level >= 0; level--) {
+        while (width(node, level) <= remaining) {
+            remaining -= width(node, level);
+            node = next(node, level);
+        }
+    }
+    return values[node];
+}
+
+std::size_t IndexableSkiplist::countBelow(double value) const {
+    std::int32_t node = head;
+    std::size_t position = 0;
+    for (int level = levels - 1; level >= 0; level--) {
+        while (values[next(node, level)] < value) {
+            position += width(node, level);
+            node = next(node, level);
+        }
+    }
+    return position;
+}
+
+std::size_t IndexableSkiplist::countAtMost(double value) const {
+    std::int32_t node = head;
+    std::size_t position = 0;
+    for (int level = levels - 1; level >= 0; level--) {
+        while (values[next(node, level)] <= value) {
+            position += width(node, level);
+            node = next(node, level);
+        }
+    }
+    return position;
+}
+
+RollingQuantile::RollingQuantile(int window)
+    : sorted(static_cast<std::size_t>(window > 0 ? window : 1)), buffer(window > 0 ? window : 1),
+      length(window > 0 ? window : 1) {}
+
+void RollingQuantile::update(double value) {
+    if (count == length) {
+        if (std::isnan(buffer[next])) {
+            missing--;
+        } else {
+            sorted.erase(buffer[next]);
+        }
+    } else {
+        count++;
+    }
+    buffer[next] = value;
+    if (std::isnan(value)) {
+        missing++;
+    } else {
+        sorted.insert(value);
+    }
+    next++;
+    if (next == length) next = 0;
+}
+
+double RollingQuantile::quantile(double q) const {
+    if (count < length || missing > 0) return std::numeric_limits<double>::quiet_NaN();
+    return interpolatedQuantile(sorted.size(), q, [this](std::size_t k) { return sorted.at(k); });
+}
+
+QuantileBand RollingQuantile::band(double q) const {
+    return QuantileBand{quantile(q), quantile(0.5), quantile(1.0 - q)};
+}
+
+double RollingQuantile::percentileRank(double value) const {
+    if (count < length || missing > 0) return std::numeric_limits<double>::quiet_NaN();
+    return percentOf(sorted.countBelow(value), sorted.countAtMost(value), sorted.size());
+}
+
+std::vector<std::vector<double>> rollingQuantiles(std::span<const double> values, int window,
+                                                  std::span<const double> qs) {
+    const std::size_t length = static_cast<std::size_t>(window > 0 ? window : 1);
+    std::vector<std::vector<double>> out(qs.size(),
+                                         std::vector<double>(values.size(), std::numeric_limits<double>::quiet_NaN()));
+    std::vector<double> keys;
+    std::vector<std::uint32_t> ranks;
+    rankValues(values, keys, ranks);
+
+    RankCounts window_counts(keys.size());
+    std::size_t missing = 0;
+    auto move = [&](std::size_t i, int by) {
+        if (std::isnan(values[i])) {
+            missing += static_cast<std::size_t>(by);
+        } else {
+            window_counts.add(ranks[i], by);
+        }
+    };
+    for (std::size_t i = 0; i < values.size(); i++) {
+        move(i, 1);
+        if (i >= length) move(i - length, -1);
+        if (i + 1 < length || missing > 0) continue;
+        for (std::size_t k = 0; k < qs.size(); k++) {
+            out[k][i] = interpolatedQuantile(length, qs[k],
+                                             [&](std::size_t n) { return keys[window_counts.kth(n)]; });
+        }
+    }
+    return out;
+}
+
+std::vector<double> rollingMedian(std::span<const double> values, int window) {
+    const double half[] = {0.5};
+    return std::move(rollingQuantiles(values, window, half).front());
+}
+
+std::vector<double> rollingPercentileRank(std::span<const double> values, int window) {
+    const std::size_t length = static_cast<std::size_t>(window > 0 ? window : 1);
+    std::vector<double> out(values.size(), std::numeric_limits<double>::quiet_NaN());
+    std::vector<double> keys;
+    std::vector<std::uint32_t> ranks;
+    rankValues(values, keys, ranks);
+
+    RankCounts window_counts(keys.size());
+    std::size_t missing = 0;
+    auto move = [&](std::size_t i, int by) {
+        if (std::isnan(values[i])) {
+            missing += static_cast<std::size_t>(by);
+        } else {
+            window_counts.add(ranks[i], by);
+        }
+    };
+    for (std::size_t i = 0; i < values.size(); i++) {
+        move(i, 1);
+        if (i >= length) move(i - length, -1);
+        if (i + 1 < length || missing > 0) continue;
+        out[i] = percentOf(window_counts.countBelow(ranks[i]), window_counts.countBelow(ranks[i] + 1), length);
+    }
+    return out;
+}
+
+std::vector<double> rollingMean(std::span<const double> values, int window) {
+    // RollingMean::update() step for step, bit for bit, but with the sum in
+    // a local and the reanchor between blocks instead of tested per value.
+    const std::size_t n = values.size();
+    const auto length = static_cast<std::size_t>(window > 0 ? window : 1);
+    const std::size_t period = RollingMean::reanchor_windows * length;
+    std::vector<double> out(n, std::numeric_limits<double>::quiet_NaN());
+    double sum = 0.0;
+    std::size_t i = 0;
+    for (; i < std::min(n, length); i++) sum += values[i];
+    if (i == length) out[i - 1] = sum / static_cast<double>(length);
+    std::size_t anchor = period;
+    while (i < n) {
+        const std::size_t end = std::min(n, anchor);
+        for (; i < end; i++) {
+            sum -= values[i - length];
+            sum += values[i];
+            out[i] = sum / static_cast<double>(length);
+        }
+        if (i == anchor) {
+            sum = compensatedSum(values.subspan(i - length, length));
+            out[i - 1] = sum / static_cast<double>(length);
+            anchor += period;
+        }
+    }
+    return out;
+}
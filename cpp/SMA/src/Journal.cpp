@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <span>
+
+#include "BinaryIO.hpp"
+#include "Journal.hpp"
+
+namespace {
+
+constexpr std::uint64_t journal_magic = 0x314c4e524a414d53ull; // "SMAJRNL1"
+constexpr std::uint64_t index_magic = 0x315844494a414d53ull;   // "SMAJIDX1"
+constexpr std::uint32_t journal_version = 1;
+constexpr std::uint64_t header_bytes = 32; // keeps records 32-byte aligned in the file
+
+// Index trailer: the block count and index_magic, after the index itself.
+constexpr std::uint64_t trailer_bytes = 16;
+
+// Strategies and accounts driven bar by bar. The live path and the replay
+// both go through onBar(), so they run the same decisions in the same order.
+struct Desk {
+    std::vector<SmaCrossStrategy> strategies;
+    std::vector<Backtester> books;
+
+    Desk(const std::vector<SmaParams>& params, const BacktestConfig& config) {
+        for (const SmaParams& p : params) {
+            strategies.emplace_back(p);
+            books.emplace_back(config);
+        }
+    }
+
+    // emit(kind, stream, time, value, detail) for every order and fill.
+    template <typename Emit>
+    void onBar(std::int64_t time, double close, Emit&& emit) {
+        for (std::size_t s = 0; s < strategies.size(); s++) settle(s, time, close, strategies[s].onBar(close), emit);
+    }
+
+    // The strategies only ever see closes, so a run of bars can be decided
+    // ahead of the books: targets[s * closes.size() + k] for bar k.
+    void decide(std::span<const double> closes, std::vector<double>& scratch, std::vector<int>& targets) {
+        targets.resize(strategies.size() * closes.size());
+        for (std::size_t s = 0; s < strategies.size(); s++) {
+            strategies[s].onBars(closes, scratch, targets.data() + s * closes.size());
+        }
+    }
+
+    // onBar() for a bar decided ahead; strategy s's target is targets[s * stride].
+    template <typename Emit>
+    void onBar(std::int64_t time, double close, const int* targets, std::size_t stride, Emit&& emit) {
+        for (std::size_t s = 0; s < strategies.size(); s++) settle(s, time, close, targets[s * stride], emit);
+    }
+
+    template <typename Emit>
+    void settle(std::size_t s, std::int64_t time, double close, int target, Emit& emit) {
+        const bool trade = target != books[s].position();
+        const auto stream = static_cast<std::uint16_t>(s);
+        if (trade) emit(JournalKind::Order, stream, time, static_cast<double>(target), 0);
+        books[s].onBar(close, target);
+        if (trade) emit(JournalKind::Fill, stream, time, close, books[s].position());
+    }
+
+    std::vector<BacktestResult> results() const {
+        std::vector<BacktestResult> out;
+        for (const Backtester& book : books) out.push_back(book.result());
+        return out;
+    }
+};
+
+bool sameRecord(const JournalRecord& a, JournalKind kind, std::uint16_t stream, std::int64_t time, double value,
+                std::int32_t detail) {
+    return a.kind == kind && a.stream == stream && a.time == time && a.detail == detail &&
+           std::bit_cast<std::uint64_t>(a.value) == std::bit_cast<std::uint64_t>(value);
+}
+
+} // namespace
+
+std::int64_t JournalWriter::captureNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+JournalWriter::~JournalWriter() { close(); }
+
+bool JournalWriter::open(const std::string& filepath, std::size_t block_records) {
+    close();
+    file.open(filepath, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    this->block_records = std::max<std::size_t>(1, block_records);
+    writeValue(file, journal_magic);
+    writeValue(file, journal_version);
+    writeValue(file, static_cast<std::uint32_t>(sizeof(JournalRecord)));
+    writeValue(file, static_cast<std::uint64_t>(this->block_records));
+    writeValue(file, std::uint64_t {0}); // padding up to header_bytes
+    if (!file) return false;
+
+    index.clear();
+    record_count = 0;
+    stall_count = 0;
+    stopping = false;
+    ring = std::make_unique<SpscRingBuffer<JournalRecord, ring_records>>();
+    writer = std::thread([this] { drain(); });
+    return true;
+}
+
+void JournalWriter::drain() {
+    std::vector<JournalRecord> block(block_records);
+    std::uint64_t written = 0;
+    std::size_t filled = 0;
+    auto flush = [&] {
+        JournalBlock entry {written, filled, block[0].time, block[0].time};
+        for (std::size_t i = 0; i < filled; i++) {
+            entry.first_time = std::min(entry.first_time, block[i].time);
+            entry.last_time = std::max(entry.last_time, block[i].time);
+        }
+        file.write(reinterpret_cast<const char*>(block.data()),
+                   static_cast<std::streamsize>(filled * sizeof(JournalRecord)));
+        index.push_back(entry);
+        written += filled;
+        filled = 0;
+    };
+
+    int idle = 0;
+    while (true) {
+        // Read before popping: once it is set, an empty pop means nothing more is coming.
+        const bool last = stopping.load(std::memory_order_acquire);
+        const std::size_t got = ring->tryPop(std::span<JournalRecord>(block.data() + filled, block_records - filled));
+        filled += got;
+        if (filled == block_records) flush();
+        if (got > 0) {
+            idle = 0;
+            continue;
+        }
+        if (last) break;
+        // Spin briefly for the next burst, then stop competing with the hot thread.
+        if (++idle < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    if (filled > 0) flush();
+}
+
+void JournalWriter::close() {
+    if (!writer.joinable()) return;
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    for (const JournalBlock& entry : index) writeValue(file, entry);
+    writeValue(file, static_cast<std::uint64_t>(index.size()));
+    writeValue(file, index_magic);
+    file.close();
+    ring.reset();
+}
+
+bool JournalReader::open(const std::string& filepath) {
+    index.clear();
+    file.close();
+    file.open(filepath, std::ios::binary);
+    std::uint64_t magic {};
+    std::uint32_t version {};
+    std::uint32_t record_size {};
+    std::uint64_t block_records {};
+    if (!readValue(file, magic) || !readValue(file, version) || !readValue(file, record_size) ||
+        !readValue(file, block_records) || magic != journal_magic || version != journal_version ||
+        record_size != sizeof(JournalRecord) || block_records == 0) {
+        return false;
+    }
+    data_offset = header_bytes;
+    file.seekg(0, std::ios::end);
+    const auto size = static_cast<std::uint64_t>(file.tellg());
+
+    std::uint64_t count {};
+    if (size >= data_offset + trailer_bytes) {
+        file.seekg(static_cast<std::streamoff>(size - trailer_bytes));
+        if (readValue(file, count) && readValue(file, magic) && magic == index_magic &&
+            count * sizeof(JournalBlock) <= size - data_offset - trailer_bytes) {
+            file.seekg(static_cast<std::streamoff>(size - trailer_bytes - count * sizeof(JournalBlock)));
+            index.resize(count);
+            for (JournalBlock& entry : index) {
+                if (!readValue(file, entry)) return false;
+            }
+            return true;
+        }
+    }
+
+    // No index (the writer never closed): every whole block is usable.
+    file.clear();
+    const std::uint64_t blocks = (size - std::min(size, data_offset)) / (block_records * sizeof(JournalRecord));
+    std::vector<JournalRecord> records;
+    for (std::uint64_t b = 0; b < blocks; b++) {
+        index.push_back(JournalBlock {b * block_records, block_records, 0, 0});
+        if (!readBlock(index.size() - 1, records)) return false;
+        index.back().first_time = index.back().last_time = records[0].time;
+        for (const JournalRecord& r : records) {
+            index.back().first_time = std::min(index.back().first_time, r.time);
+            index.back().last_time = std::max(index.back().last_time, r.time);
+        }
+    }
+    return true;
+}
+
+std::size_t JournalReader::findBlock(std::int64_t time) const {
+    for (std::size_t i = 0; i < index.size(); i++) {
+        if (index[i].last_time >= time) return i;
+    }
+    return index.size();
+}
+
+bool JournalReader::readBlock(std::size_t i, std::vector<JournalRecord>& out) {
+    const JournalBlock& entry = index[i];
+    out.resize(entry.count);
+    file.seekg(static_cast<std::streamoff>(data_offset + entry.first_record * sizeof(JournalRecord)));
+    file.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(entry.count * sizeof(JournalRecord)));
+    return static_cast<bool>(file);
+}
+
+std::vector<BacktestResult> runRecordedBacktest(const PriceView& prices, const std::vector<SmaParams>& strategies,
+                                                const BacktestConfig& config, JournalWriter& journal) {
+    Desk desk(strategies, config);
+    auto emit = [&journal](JournalKind kind, std::uint16_t stream, std::int64_t time, double value,
+                           std::int32_t detail) { journal.record(kind, stream, time, value, detail); };
+    for (std::size_t i = 0; i < prices.size(); i++) {
+        journal.record(JournalKind::Bar, 0, prices.time[i], prices.close[i]);
+        desk.onBar(prices.time[i], prices.close[i], emit);
+    }
+    return desk.results();
+}
+
+ReplayResult replayJournal(const std::string& filepath, const std::vector<SmaParams>& strategies,
+                           const BacktestConfig& config, const ReplayOptions& options) {
+    ReplayResult result;
+    JournalReader reader;
+    if (!reader.open(filepath)) return result;
+
+    Desk desk(strategies, config);
+    std::vector<JournalRecord> records;
+    std::size_t block = 0;
+    std::size_t next = 0;
+    auto fetch = [&] {
+        while (next == records.size()) {
+            if (block == reader.blockCount() || !reader.readBlock(block++, records)) return false;
+            next = 0;
+        }
+        return true;
+    };
+    auto mismatch = [&] {
+        if (result.mismatches++ == 0) result.first_mismatch = result.records;
+    };
+
+    // Each order or fill the strategies produce must be the next record.
+    auto emit = [&](JournalKind kind, std::uint16_t stream, std::int64_t time, double value, std::int32_t detail) {
+        result.decisions++;
+        if (fetch() && records[next].kind != JournalKind::Bar &&
+            sameRecord(records[next], kind, stream, time, value, detail)) {
+            next++;
+            result.records++;
+        } else {
+            mismatch();
+        }
+    };
+
+    // The bars from here to the end of the loaded block are decided in one go
+    // with the block SMA kernel. Orders and fills still settle bar by bar, so
+    // they come out in recorded order; emit() only loads the next block once
+    // this one is used up, so no decided bar is left behind.
+    std::vector<double> closes;
+    std::vector<double> scratch;
+    std::vector<int> targets;
+    std::size_t decided = 0;
+    auto decideAhead = [&] {
+        closes.clear();
+        for (std::size_t i = next; i < records.size(); i++) {
+            if (records[i].kind == JournalKind::Bar) closes.push_back(records[i].value);
+        }
+        desk.decide(closes, scratch, targets);
+        decided = 0;
+    };
+
+    // Paced replay sleeps only once it is a while ahead of the recording:
+    // a sleep per bar costs more than the bars are apart.
+    constexpr auto pace_slack = std::chrono::milliseconds(1);
+    const auto start = std::chrono::steady_clock::now();
+    std::int64_t first_captured = 0;
+    while (fetch()) {
+        if (decided == closes.size()) decideAhead();
+        const JournalRecord& record = records[next++];
+        result.records++;
+        if (record.kind != JournalKind::Bar) {
+            mismatch(); // recorded, but not produced by the replay
+            continue;
+        }
+        if (options.speed > 0.0) {
+            if (result.bars == 0) first_captured = record.captured_ns;
+            const auto offset = static_cast<std::int64_t>(static_cast<double>(record.captured_ns - first_captured) /
+                                                          options.speed);
+            const auto due = start + std::chrono::nanoseconds(offset);
+            if (due - std::chrono::steady_clock::now() > pace_slack) std::this_thread::sleep_until(due);
+        }
+        result.bars++;
+        desk.onBar(record.time, record.value, targets.data() + decided++, closes.size(), emit);
+    }
+    result.results = desk.results();
+    return result;
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "BinaryIO.hpp"
+#include "MinuteStore.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::uint64_t minute_magic = 0x31534554554e494dull; // "MINUTES1"
+constexpr std::uint32_t minute_format = 1;
+
+struct MinuteHeader {
+    std::uint64_t magic;
+    std::uint32_t format;
+    std::uint32_t reserved;
+    std::uint64_t rows;
+    std::uint64_t stride;
+    std::uint64_t sparse_count;
+    std::uint64_t padding[3];
+};
+static_assert(sizeof(MinuteHeader) == 64);
+
+// Bytes one column takes, padded so the next starts 64-byte aligned.
+std::size_t columnBytes(std::size_t rows) { return (rows * 8 + 63) / 64 * 64; }
+
+std::size_t storeBytes(std::size_t rows, std::size_t sparse_count) {
+    return sizeof(MinuteHeader) + 5 * columnBytes(rows) + sparse_count * 8;
+}
+
+} // namespace
+
+bool MinuteStore::write(const std::string& filepath, const PriceView& bars) {
+    std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error: cannot write minute store: " << filepath << "\n";
+        return false;
+    }
+    const std::size_t n = bars.size();
+    MinuteHeader header {minute_magic, minute_format, 0, n, index_stride, (n + index_stride - 1) / index_stride, {}};
+    writeValue(out, header);
+
+    const std::vector<char> padding(64, 0);
+    auto writeColumn = [&](const auto* values) {
+        out.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(n * 8));
+        out.write(padding.data(), static_cast<std::streamsize>(columnBytes(n) - n * 8));
+    };
+    writeColumn(bars.time.data());
+    writeColumn(bars.open.data());
+    writeColumn(bars.high.data());
+    writeColumn(bars.low.data());
+    writeColumn(bars.close.data());
+    for (std::size_t i = 0; i < n; i += index_stride) writeValue(out, bars.time[i]);
+    return static_cast<bool>(out);
+}
+
+MinuteStore::~MinuteStore() { close(); }
+
+std::size_t MinuteStore::lowerBound(std::int64_t t) const {
+    // Last sampled stride starting before t, then within that stride.
+    const std::int64_t* chunk = std::lower_bound(sparse, sparse + sparse_count, t);
+    const std::size_t stride = chunk == sparse ? 0 : static_cast<std::size_t>(chunk - sparse) - 1;
+    const std::size_t first = stride * index_stride;
+    const std::size_t last = std::min(rows, first + index_stride + 1);
+    return static_cast<std::size_t>(std::lower_bound(times + first, times + last, t) - times);
+}
+
+PriceView MinuteStore::range(std::int64_t from, std::int64_t to) const {
+    if (base == nullptr || to <= from) return {};
+    const std::size_t first = lowerBound(from);
+    const std::size_t count = lowerBound(to) - first;
+    return PriceView{{times + first, count}, {opens + first, count}, {highs + first, count},
+                     {lows + first, count},   {closes + first, count}, {}};
+}
+
+#ifndef _WIN32
+
+bool MinuteStore::open(const std::string& filepath) {
+    close();
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: cannot open minute store: " << filepath << "\n";
+        return false;
+    }
+    struct stat info {};
+    fstat(fd, &info);
+    MinuteHeader header {};
+    bool ok = pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+              header.magic == minute_magic && header.format == minute_format && header.stride == index_stride &&
+              header.sparse_count == (header.rows + index_stride - 1) / index_stride &&
+              static_cast<std::uint64_t>(info.st_size) == storeBytes(header.rows, header.sparse_count);
+    if (ok) {
+        void* mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ok = false;
+        } else {
+            base = static_cast<const unsigned char*>(mapping);
+            mapped_bytes = static_cast<std::size_t>(info.st_size);
+        }
+    }
+    ::close(fd); // the mapping stays valid
+    if (!ok) {
+        std::cerr << "Error: not a usable minute store: " << filepath << "\n";
+        return false;
+    }
+
+    rows = header.rows;
+    sparse_count = header.sparse_count;
+    const std::size_t stride_bytes = columnBytes(rows);
+    const unsigned char* columns = base + sizeof(MinuteHeader);
+    times = reinterpret_cast<const std::int64_t*>(columns);
+    opens = reinterpret_cast<const double*>(columns + stride_bytes);
+    highs = reinterpret_cast<const double*>(columns + 2 * stride_bytes);
+    lows = reinterpret_cast<const double*>(columns + 3 * stride_bytes);
+    closes = reinterpret_cast<const double*>(columns + 4 * stride_bytes);
+    sparse = reinterpret_cast<const std::int64_t*>(columns + 5 * stride_bytes);
+    return true;
+}
+
+void MinuteStore::close() {
+    if (base != nullptr) munmap(const_cast<unsigned char*>(base), mapped_bytes);
+    base = nullptr;
+    mapped_bytes = 0;
+    rows = 0;
+}
+
+#else
+
+bool MinuteStore::open(const std::string& filepath) {
+    std::cerr << "Error: minute store needs mmap, not available on this platform: " << filepath << "\n";
+    return false;
+}
+
+void MinuteStore::close() {}
+
+#endif
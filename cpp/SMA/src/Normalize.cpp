@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include "AsOfJoin.hpp"
+#include "Normalize.hpp"
+
+namespace {
+
+// Small enough that the factor and index blocks stay in L1 next to the rows.
+constexpr std::size_t block_rows = 1024;
+
+// Columns on the same clock with the same rates and scale share one factor
+// per row, so it is built once per block and applied to all of them.
+struct FactorGroup {
+    const NormalizeColumn* key;
+    std::vector<const NormalizeColumn*> columns;
+    std::size_t rows {};
+};
+
+bool sameFactors(const NormalizeColumn& a, const NormalizeColumn& b) {
+    return a.time.data() == b.time.data() && a.time.size() == b.time.size() && a.rates == b.rates &&
+           a.scale == b.scale;
+}
+
+// Rows [first, last) of every column in the group.
+void normalizeRows(std::span<const RateSeries> rates, std::span<const std::span<const double>> values,
+                   const FactorGroup& group, std::size_t first, std::size_t last) {
+    const NormalizeColumn& key = *group.key;
+    std::vector<AsOfCursor> cursors;
+    for (std::size_t r : key.rates) cursors.emplace_back(rates[r].time, rates[r].lag);
+    std::array<std::int32_t, block_rows> index;
+    std::array<double, block_rows> factor;
+    const double missing = std::numeric_limits<double>::quiet_NaN();
+
+    for (std::size_t begin = first; begin < last; begin += block_rows) {
+        const std::size_t count = std::min(block_rows, last - begin);
+        std::fill_n(factor.begin(), count, key.scale);
+        for (std::size_t k = 0; k < cursors.size(); k++) {
+            cursors[k].join(key.time.subspan(begin, count), index);
+            const double* value = values[key.rates[k]].data();
+            for (std::size_t i = 0; i < count; i++) factor[i] *= index[i] >= 0 ? value[index[i]] : missing;
+        }
+        for (const NormalizeColumn* column : group.columns) {
+            const double* in = column->in.data() + begin;
+            double* out = column->out.data() + begin;
+            for (std::size_t i = 0; i < count; i++) out[i] = in[i] * factor[i];
+        }
+    }
+}
+
+} // namespace
+
+void normalizeColumns(std::span<const RateSeries> rates, std::span<const NormalizeColumn> columns, ThreadPool* pool) {
+    // Divisors become multipliers once per rate series (short), not per row.
+    std::vector<std::vector<double>> reciprocals(rates.size());
+    std::vector<std::span<const double>> values(rates.size());
+    for (std::size_t r = 0; r < rates.size(); r++) {
+        values[r] = rates[r].value;
+        if (!rates[r].divide) continue;
+        for (double v : rates[r].value) reciprocals[r].push_back(1.0 / v);
+        values[r] = reciprocals[r];
+    }
+
+    std::vector<FactorGroup> groups;
+    for (const NormalizeColumn& column : columns) {
+        auto same = [&column](const FactorGroup& g) { return sameFactors(*g.key, column); };
+        auto group = std::find_if(groups.begin(), groups.end(), same);
+        if (group == groups.end()) group = groups.insert(groups.end(), FactorGroup {&column, {}, column.time.size()});
+        group->columns.push_back(&column);
+        group->rows = std::min({group->rows, column.in.size(), column.out.size()});
+    }
+
+    if (pool == nullptr) {
+        for (const FactorGroup& group : groups) normalizeRows(rates, values, group, 0, group.rows);
+        return;
+    }
+    // Split each group by rows too, so a few large groups still fill the pool.
+    for (const FactorGroup& group : groups) {
+        const std::size_t blocks = (group.rows + block_rows - 1) / block_rows;
+        const std::size_t per_task = std::max<std::size_t>(1, blocks / pool->size()) * block_rows;
+        for (std::size_t first = 0; first < group.rows; first += per_task) {
+            const std::size_t last = std::min(group.rows, first + per_task);
+            pool->submit([&rates, &values, &group, first, last] { normalizeRows(rates, values, group, first, last); });
+        }
+    }
+    pool->wait();
+}
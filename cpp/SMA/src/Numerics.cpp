@@ -0,0 +1,51 @@
+#include "Numerics.hpp"
+
+namespace {
+
+constexpr std::size_t compensated_lanes = 4;
+constexpr std::size_t pairwise_lanes = 8;
+constexpr std::size_t pairwise_leaf = 256;
+
+double plainLeaf(const double* values, std::size_t n) {
+    double lanes[pairwise_lanes] = {};
+    std::size_t i = 0;
+    for (; i + pairwise_lanes <= n; i += pairwise_lanes) {
+        for (std::size_t l = 0; l < pairwise_lanes; l++) lanes[l] += values[i + l];
+    }
+    for (; i < n; i++) lanes[0] += values[i];
+    return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+double pairwise(const double* values, std::size_t n) {
+    if (n <= pairwise_leaf) return plainLeaf(values, n);
+    // Split on a leaf boundary so the leaves are the same wherever the recursion starts.
+    const std::size_t half = (n / 2 + pairwise_leaf - 1) / pairwise_leaf * pairwise_leaf;
+    return pairwise(values, half) + pairwise(values + half, n - half);
+}
+
+} // namespace
+
+double compensatedSum(std::span<const double> values) {
+    double sum[compensated_lanes] = {};
+    double compensation[compensated_lanes] = {};
+    const std::size_t n = values.size();
+    std::size_t i = 0;
+    for (; i + compensated_lanes <= n; i += compensated_lanes) {
+        for (std::size_t l = 0; l < compensated_lanes; l++) {
+            const double x = values[i + l];
+            const double t = sum[l] + x;
+            const double moved = t - sum[l];
+            compensation[l] += (sum[l] - (t - moved)) + (x - moved);
+            sum[l] = t;
+        }
+    }
+    CompensatedSum total;
+    for (; i < n; i++) total.add(values[i]);
+    for (std::size_t l = 0; l < compensated_lanes; l++) {
+        total.add(sum[l]);
+        total.add(compensation[l]);
+    }
+    return total.value();
+}
+
+double pairwiseSum(std::span<const double> values) { return pairwise(values.data(), values.size()); }
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <numeric>
+#include <random>
+
+#include "Optimizer.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+
+using Matrix = std::vector<double>; // n x n, row-major
+
+// Eigen-decomposition of a small symmetric matrix by cyclic Jacobi
+// rotations: `a` becomes diagonal (the eigenvalues), `vectors` holds the
+// eigenvectors as columns.
+void jacobiEigen(Matrix& a, Matrix& vectors, std::size_t n) {
+    vectors.assign(n * n, 0.0);
+    for (std::size_t i = 0; i < n; i++) vectors[i * n + i] = 1.0;
+    for (int sweep = 0; sweep < 50; sweep++) {
+        double off = 0.0;
+        for (std::size_t p = 0; p < n; p++) {
+            for (std::size_t q = p + 1; q < n; q++) off += a[p * n + q] * a[p * n + q];
+        }
+        if (off < 1e-30) return;
+        for (std::size_t p = 0; p < n; p++) {
+            for (std::size_t q = p + 1; q < n; q++) {
+                if (a[p * n + q] == 0.0) continue;
+                const double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * a[p * n + q]);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0);
+                const double s = t * c;
+                for (std::size_t k = 0; k < n; k++) {
+                    const double akp = a[k * n + p];
+                    const double akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for (std::size_t k = 0; k < n; k++) {
+                    const double apk = a[p * n + k];
+                    const double aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                for (std::size_t k = 0; k < n; k++) {
+                    const double vkp = vectors[k * n + p];
+                    const double vkq = vectors[k * n + q];
+                    vectors[k * n + p] = c * vkp - s * vkq;
+                    vectors[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+
+struct Candidate {
+    std::vector<double> x;     // unit-box coordinates, clipped to [0, 1]
+    std::vector<double> point; // snapped to the grid
+    double score = -std::numeric_limits<double>::infinity();
+    int rung = -1;             // last rung it was scored at
+};
+
+// Search distribution state, in unit-box coordinates.
+struct CmaState {
+    std::size_t n {};
+    std::vector<double> mean;
+    double sigma {};
+    Matrix c;       // covariance
+    Matrix b;       // its eigenvectors, as columns
+    std::vector<double> d; // square roots of its eigenvalues
+    std::vector<double> pc;
+    std::vector<double> ps;
+    std::size_t generation {};
+
+    void reset(std::vector<double> start, double step) {
+        n = start.size();
+        mean = std::move(start);
+        sigma = step;
+        c.assign(n * n, 0.0);
+        b.assign(n * n, 0.0);
+        for (std::size_t i = 0; i < n; i++) c[i * n + i] = b[i * n + i] = 1.0;
+        d.assign(n, 1.0);
+        pc.assign(n, 0.0);
+        ps.assign(n, 0.0);
+        generation = 0;
+    }
+
+    void decompose() {
+        Matrix a = c;
+        jacobiEigen(a, b, n);
+        for (std::size_t i = 0; i < n; i++) d[i] = std::sqrt(std::max(a[i * n + i], 1e-20));
+    }
+};
+
+} // namespace
+
+OptimizerResult optimizeCmaEs(std::span<const SearchDimension> dimensions, const Objective& objective,
+                              const OptimizerConfig& config, ThreadPool* pool) {
+    OptimizerResult result;
+    const std::size_t n = dimensions.size();
+    if (n == 0) return result;
+    const int rungs = std::max(1, config.rungs);
+
+    // Standard CMA-ES constants (Hansen, "The CMA Evolution Strategy: A Tutorial").
+    // The batch never depends on the pool, which only spreads its calls.
+    std::size_t lambda = config.batch;
+    if (lambda == 0) lambda = 4 + static_cast<std::size_t>(3.0 * std::log(static_cast<double>(n)));
+    lambda = std::max<std::size_t>(lambda, 2);
+    const std::size_t mu = lambda / 2;
+    std::vector<double> weights(mu);
+    for (std::size_t i = 0; i < mu; i++) {
+        weights[i] = std::log(static_cast<double>(mu) + 0.5) - std::log(static_cast<double>(i) + 1.0);
+    }
+    const double weight_sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+    double square_sum = 0.0;
+    for (double& w : weights) {
+        w /= weight_sum;
+        square_sum += w * w;
+    }
+    const double nd = static_cast<double>(n);
+    const double mueff = 1.0 / square_sum;
+    const double cc = (4.0 + mueff / nd) / (nd + 4.0 + 2.0 * mueff / nd);
+    const double cs = (mueff + 2.0) / (nd + mueff + 5.0);
+    const double c1 = 2.0 / ((nd + 1.3) * (nd + 1.3) + mueff);
+    const double cmu = std::min(1.0 - c1, 2.0 * (mueff - 2.0 + 1.0 / mueff) / ((nd + 2.0) * (nd + 2.0) + mueff));
+    const double damps = 1.0 + 2.0 * std::max(0.0, std::sqrt((mueff - 1.0) / (nd + 1.0)) - 1.0) + cs;
+    const double chi_n = std::sqrt(nd) * (1.0 - 1.0 / (4.0 * nd) + 1.0 / (21.0 * nd * nd));
+
+    // Below this, in unit-box terms, every sample lands on the same grid point.
+    double finest = 1.0;
+    for (const SearchDimension& dim : dimensions) {
+        const double range = dim.max - dim.min;
+        if (range > 0.0 && dim.step > 0.0) finest = std::min(finest, dim.step / range);
+    }
+
+    std::mt19937_64 random(config.seed);
+    std::normal_distribution<double> normal;
+    std::uniform_real_distribution<double> uniform;
+    auto randomMean = [&] {
+        std::vector<double> start(n);
+        for (double& v : start) v = uniform(random);
+        return start;
+    };
+    auto snap = [&](const std::vector<double>& x) {
+        std::vector<double> point(n);
+        for (std::size_t i = 0; i < n; i++) {
+            const SearchDimension& dim = dimensions[i];
+            const double steps = dim.step > 0.0 ? std::round(x[i] * (dim.max - dim.min) / dim.step) : 0.0;
+            point[i] = std::min(dim.max, dim.min + steps * dim.step);
+        }
+        return point;
+    };
+
+    CmaState state;
+    state.reset(randomMean(), config.sigma);
+
+    std::vector<std::map<std::vector<double>, double>> scored(static_cast<std::size_t>(rungs));
+    std::vector<Candidate> batch(lambda);
+    std::vector<std::size_t> alive;
+    std::vector<std::size_t> pending;
+    std::vector<double> fresh;
+    std::vector<double> z(n);
+    int idle_generations = 0;
+
+    while (result.evaluations < config.budget && result.best_score < config.target) {
+        for (Candidate& candidate : batch) {
+            for (double& v : z) v = normal(random);
+            candidate.x.assign(n, 0.0);
+            for (std::size_t i = 0; i < n; i++) {
+                double y = 0.0;
+                for (std::size_t j = 0; j < n; j++) y += state.b[i * n + j] * state.d[j] * z[j];
+                candidate.x[i] = std::clamp(state.mean[i] + state.sigma * y, 0.0, 1.0);
+            }
+            candidate.point = snap(candidate.x);
+            candidate.rung = -1;
+        }
+
+        const double spent_before = result.evaluations;
+        alive.resize(lambda);
+        std::iota(alive.begin(), alive.end(), 0);
+        for (int rung = 0; rung < rungs; rung++) {
+            const double fraction = std::ldexp(1.0, rung - (rungs - 1));
+            std::map<std::vector<double>, double>& memo = scored[static_cast<std::size_t>(rung)];
+
+            // One call per distinct point not already scored at this rung.
+            pending.clear();
+            for (std::size_t i : alive) {
+                if (memo.contains(batch[i].point)) continue;
+                const bool repeat = std::any_of(pending.begin(), pending.end(),
+                                                [&](std::size_t p) { return batch[p].point == batch[i].point; });
+                if (!repeat) pending.push_back(i);
+            }
+            fresh.assign(pending.size(), 0.0);
+            auto evaluate = [&](std::size_t k) { fresh[k] = objective(batch[pending[k]].point, fraction); };
+            if (pool == nullptr) {
+                for (std::size_t k = 0; k < pending.size(); k++) evaluate(k);
+            } else {
+                for (std::size_t k = 0; k < pending.size(); k++) pool->submit([&evaluate, k] { evaluate(k); });
+                pool->wait();
+            }
+            for (std::size_t k = 0; k < pending.size(); k++) {
+                const double score = std::isnan(fresh[k]) ? -std::numeric_limits<double>::infinity() : fresh[k];
+                memo.emplace(batch[pending[k]].point, score);
+            }
+            result.backtests += pending.size();
+            result.evaluations += fraction * static_cast<double>(pending.size());
+
+            for (std::size_t i : alive) {
+                batch[i].score = memo[batch[i].point];
+                batch[i].rung = rung;
+            }
+            if (rung + 1 == rungs) {
+                for (std::size_t i : alive) {
+                    if (batch[i].score > result.best_score) {
+                        result.best_score = batch[i].score;
+                        result.best = batch[i].point;
+                        result.progress.push_back(OptimizerStep{result.evaluations, result.best_score});
+                    }
+                }
+                break;
+            }
+            std::stable_sort(alive.begin(), alive.end(),
+                             [&](std::size_t a, std::size_t b) { return batch[a].score > batch[b].score; });
+            alive.resize((alive.size() + 1) / 2);
+        }
+        result.generations++;
+
+        // Rank: further rungs first, then score at the rung reached.
+        std::vector<std::size_t> order(lambda);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            if (batch[a].rung != batch[b].rung) return batch[a].rung > batch[b].rung;
+            return batch[a].score > batch[b].score;
+        });
+
+        const std::vector<double> old_mean = state.mean;
+        for (std::size_t i = 0; i < n; i++) {
+            double m = 0.0;
+            for (std::size_t r = 0; r < mu; r++) m += weights[r] * batch[order[r]].x[i];
+            state.mean[i] = m;
+        }
+        std::vector<double> step(n);
+        for (std::size_t i = 0; i < n; i++) step[i] = (state.mean[i] - old_mean[i]) / state.sigma;
+
+        // ps += C^-1/2 * step = B D^-1 B' step
+        std::vector<double> rotated(n, 0.0);
+        for (std::size_t j = 0; j < n; j++) {
+            double v = 0.0;
+            for (std::size_t i = 0; i < n; i++) v += state.b[i * n + j] * step[i];
+            rotated[j] = v / state.d[j];
+        }
+        const double ps_scale = std::sqrt(cs * (2.0 - cs) * mueff);
+        double ps_norm = 0.0;
+        for (std::size_t i = 0; i < n; i++) {
+            double v = 0.0;
+            for (std::size_t j = 0; j < n; j++) v += state.b[i * n + j] * rotated[j];
+            state.ps[i] = (1.0 - cs) * state.ps[i] + ps_scale * v;
+            ps_norm += state.ps[i] * state.ps[i];
+        }
+        ps_norm = std::sqrt(ps_norm);
+        state.generation++;
+        const double decay = 1.0 - std::pow(1.0 - cs, 2.0 * static_cast<double>(state.generation));
+        const bool hsig = ps_norm / std::sqrt(decay) / chi_n < 1.4 + 2.0 / (nd + 1.0);
+        const double pc_scale = hsig ? std::sqrt(cc * (2.0 - cc) * mueff) : 0.0;
+        for (std::size_t i = 0; i < n; i++) state.pc[i] = (1.0 - cc) * state.pc[i] + pc_scale * step[i];
+
+        const double keep = 1.0 - c1 - cmu + (hsig ? 0.0 : c1 * cc * (2.0 - cc));
+        for (std::size_t i = 0; i < n; i++) {
+            for (std::size_t j = 0; j <= i; j++) {
+                double rank_mu = 0.0;
+                for (std::size_t r = 0; r < mu; r++) {
+                    const std::vector<double>& x = batch[order[r]].x;
+                    rank_mu += weights[r] * (x[i] - old_mean[i]) * (x[j] - old_mean[j]);
+                }
+                const double v = keep * state.c[i * n + j] + c1 * state.pc[i] * state.pc[j] +
+                                 cmu * rank_mu / (state.sigma * state.sigma);
+                state.c[i * n + j] = state.c[j * n + i] = v;
+            }
+        }
+        state.sigma *= std::exp((cs / damps) * (ps_norm / chi_n - 1.0));
+        state.decompose();
+
+        // Restart once samples can only land on the points already tried;
+        // give up when restarts stop finding new ones (the box is used up).
+        idle_generations = result.evaluations > spent_before ? 0 : idle_generations + 1;
+        if (idle_generations >= 100) break;
+        const double spread = state.sigma * *std::max_element(state.d.begin(), state.d.end());
+        if (spread < 0.25 * finest || (idle_generations > 0 && idle_generations % 3 == 0)) {
+            state.reset(randomMean(), config.sigma);
+            result.restarts++;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,121 @@
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+
+#include "AllocProfiler.hpp"
+#include "Pipeline.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+
+using SharedBlock = std::shared_ptr<const PriceBlock>;
+
+// Runs one strategy's blocks in order on the pool without tying up a worker
+// between blocks: a drain task is only scheduled while blocks are waiting.
+class Strand {
+public:
+    Strand(ThreadPool& pool, const SmaParams& params, const BacktestConfig& config,
+           std::function<void(const Backtester&, const PriceBlock&)> on_block)
+        : pool(pool), strategy(params), backtester(config), on_block(std::move(on_block)) {}
+
+    void post(SharedBlock block) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(std::move(block));
+            if (running) return;
+            running = true;
+        }
+        pool.submit([this] { drain(); });
+    }
+
+    const Backtester& result() const { return backtester; }
+
+private:
+    void drain() {
+        AllocStage stage("backtest");
+        while (true) {
+            SharedBlock block;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (pending.empty()) {
+                    running = false;
+                    return;
+                }
+                block = std::move(pending.front());
+                pending.pop_front();
+            }
+
+            const std::vector<double>& close = block->bars.close;
+            {
+                NoAllocScope no_alloc("pipeline bar loop");
+                for (std::size_t i = 0; i < close.size(); i++) {
+                    backtester.onBar(close[i], strategy.onBar(close[i]));
+                }
+            }
+            if (on_block) on_block(backtester, *block);
+        }
+    }
+
+    ThreadPool& pool;
+    SmaCrossStrategy strategy;
+    Backtester backtester;
+    std::function<void(const Backtester&, const PriceBlock&)> on_block;
+    std::deque<SharedBlock> pending;
+    bool running {};
+    std::mutex mutex;
+};
+
+} // namespace
+
+std::vector<BacktestResult> runStreamingBacktest(
+    const std::string& filepath, const std::vector<SmaParams>& strategies,
+    const PipelineConfig& config,
+    const std::function<void(const PipelineProgress&)>& on_progress) {
+    ThreadPool pool(config.threads);
+    std::mutex progress_mutex;
+
+    std::vector<std::unique_ptr<Strand>> strands;
+    for (std::size_t s = 0; s < strategies.size(); s++) {
+        auto report = [s, &on_progress, &progress_mutex](const Backtester& backtester, const PriceBlock& block) {
+            if (!on_progress) return;
+            PipelineProgress progress;
+            progress.strategy = s;
+            progress.rows_done = block.first_row + block.bars.size();
+            progress.last_time = block.bars.time.back();
+            progress.equity = backtester.equity();
+            progress.position = backtester.position();
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            on_progress(progress);
+        };
+        strands.push_back(std::make_unique<Strand>(pool, strategies[s], config.backtest, report));
+    }
+
+    // A slot is taken before each block is parsed and handed back when the
+    // last strategy drops it, so at most max_blocks_in_flight blocks, counting
+    // the one being parsed, are alive however big the file is.
+    const std::ptrdiff_t max_blocks = static_cast<std::ptrdiff_t>(
+        config.max_blocks_in_flight == 0 ? 1 : config.max_blocks_in_flight);
+    std::counting_semaphore<> slots(max_blocks);
+
+    AllocStage stage("parse");
+    Generator<PriceBlock> blocks = streamCSV(filepath, config.block_rows);
+    while (true) {
+        slots.acquire();
+        PriceBlock* block = blocks.next();
+        if (block == nullptr) {
+            slots.release();
+            break;
+        }
+        SharedBlock shared(new PriceBlock(std::move(*block)), [&slots](const PriceBlock* done) {
+            delete done;
+            slots.release();
+        });
+        for (std::unique_ptr<Strand>& strand : strands) strand->post(shared);
+    }
+    pool.wait();
+
+    std::vector<BacktestResult> results;
+    for (const std::unique_ptr<Strand>& strand : strands) results.push_back(strand->result().result());
+    return results;
+}
@@ -0,0 +1,326 @@
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "ResultCache.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::uint64_t cache_magic = 0x3145484341434d53ull; // "SMCACHE1"
+constexpr std::uint32_t cache_format = 1;
+constexpr std::size_t ways = 8;
+constexpr std::size_t payload_words = 6;
+
+// Words of one slot: key hi, key lo, last used, then the result.
+// A zero key marks an empty slot.
+constexpr std::size_t slot_words = 3 + payload_words;
+
+struct CacheHeader {
+    std::uint64_t magic;
+    std::uint32_t format;
+    std::uint32_t ways;
+    std::uint64_t bucket_count;
+    std::uint64_t reserved[5];
+};
+static_assert(sizeof(CacheHeader) == 64);
+
+// seq word + slots, padded to whole cache lines.
+constexpr std::size_t bucket_bytes = ((1 + ways * slot_words) * 8 + 63) / 64 * 64;
+
+// In the padding after the slots: the odd sequence value last seen held, and
+// since when. Zero in a fresh file, like everything else.
+constexpr std::size_t held_word = 1 + ways * slot_words;
+static_assert((held_word + 2) * 8 <= bucket_bytes);
+
+// A writer holds a bucket for well under a microsecond.
+constexpr std::chrono::seconds stuck_after {1};
+
+std::uint64_t mix(std::uint64_t x) {
+    // splitmix64 finaliser
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+std::uint64_t nowTicks() {
+    // steady_clock is system-wide on Linux, so ticks from different processes compare.
+    auto ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+    return static_cast<std::uint64_t>(ticks) | 1;
+}
+
+void encode(const BacktestResult& result, std::uint64_t* words) {
+    words[0] = std::bit_cast<std::uint64_t>(result.final_equity);
+    words[1] = std::bit_cast<std::uint64_t>(result.total_return);
+    words[2] = std::bit_cast<std::uint64_t>(result.max_drawdown);
+    words[3] = static_cast<std::uint64_t>(result.trades);
+    words[4] = static_cast<std::uint64_t>(result.bars);
+    words[5] = static_cast<std::uint64_t>(result.bars_in_market);
+}
+
+BacktestResult decode(const std::uint64_t* words) {
+    BacktestResult result;
+    result.final_equity = std::bit_cast<double>(words[0]);
+    result.total_return = std::bit_cast<double>(words[1]);
+    result.max_drawdown = std::bit_cast<double>(words[2]);
+    result.trades = static_cast<int>(words[3]);
+    result.bars = static_cast<int>(words[4]);
+    result.bars_in_market = static_cast<int>(words[5]);
+    return result;
+}
+
+// All access to the shared mapping goes through atomics; plain loads and
+// stores racing with another process would be undefined behaviour.
+std::uint64_t loadWord(std::uint64_t& word, std::memory_order order = std::memory_order_relaxed) {
+    return std::atomic_ref<std::uint64_t>(word).load(order);
+}
+
+void storeWord(std::uint64_t& word, std::uint64_t value, std::memory_order order = std::memory_order_relaxed) {
+    std::atomic_ref<std::uint64_t>(word).store(value, order);
+}
+
+// Notes that the bucket's sequence went odd at `ticks`.
+void markHeld(std::uint64_t* bucket, std::uint64_t odd, std::uint64_t ticks) {
+    storeWord(bucket[held_word + 1], ticks);
+    storeWord(bucket[held_word], odd, std::memory_order_release);
+}
+
+// Called by whoever finds the sequence odd. Starts the clock on that value if
+// nobody has, and once it has stayed odd past stuck_after takes the bucket,
+// empties it (the dead writer may have left a slot half written) and frees
+// it. Returns true if it did.
+bool reclaimIfStuck(std::uint64_t* bucket, std::uint64_t odd) {
+    const std::uint64_t now = nowTicks();
+    if (loadWord(bucket[held_word], std::memory_order_acquire) != odd) {
+        markHeld(bucket, odd, now);
+        return false;
+    }
+    const std::chrono::steady_clock::duration held(static_cast<std::int64_t>(now - loadWord(bucket[held_word + 1])));
+    if (held < stuck_after) return false;
+
+    std::uint64_t expected = odd;
+    std::atomic_ref<std::uint64_t> seq(bucket[0]);
+    if (!seq.compare_exchange_strong(expected, odd + 2, std::memory_order_acquire)) return false;
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 1; i < held_word; i++) storeWord(bucket[i], 0);
+    seq.store(odd + 3, std::memory_order_release);
+    return true;
+}
+
+} // namespace
+
+CacheKey makeCacheKey(std::uint64_t dataset, std::string_view strategy, std::span<const double> params) {
+    std::uint64_t hi = 0x243f6a8885a308d3ull;
+    std::uint64_t lo = 0x13198a2e03707344ull;
+    auto add = [&](std::uint64_t word) {
+        hi = mix(hi ^ word);
+        lo = mix(lo + word * 0x9e3779b97f4a7c15ull);
+    };
+
+    add(dataset);
+    add(static_cast<std::uint64_t>(backtest_engine_version));
+    add(strategy.size());
+    for (char c : strategy) add(static_cast<unsigned char>(c));
+    add(params.size());
+    for (double p : params) add(std::bit_cast<std::uint64_t>(p));
+
+    return CacheKey{hi, lo | 1}; // never the all-zero "empty" key
+}
+
+ResultCache::~ResultCache() {
+    close();
+}
+
+std::size_t ResultCache::capacity() const {
+    return bucket_count * ways;
+}
+
+CacheStats ResultCache::stats() const {
+    return CacheStats{counters.hits.load(std::memory_order_relaxed), counters.misses.load(std::memory_order_relaxed),
+                      counters.stores.load(std::memory_order_relaxed),
+                      counters.evictions.load(std::memory_order_relaxed)};
+}
+
+#ifndef _WIN32
+
+bool ResultCache::open(const std::string& filepath, std::size_t capacity) {
+    close();
+
+    int fd = ::open(filepath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: cannot open result cache: " << filepath << "\n";
+        return false;
+    }
+    // Serialise creation between processes opening the file at the same time.
+    flock(fd, LOCK_EX);
+
+    struct stat info {};
+    fstat(fd, &info);
+    CacheHeader header {};
+    bool ok = true;
+
+    if (info.st_size == 0) {
+        header.magic = cache_magic;
+        header.format = cache_format;
+        header.ways = ways;
+        header.bucket_count = (capacity + ways - 1) / ways;
+        if (header.bucket_count == 0) header.bucket_count = 1;
+        ok = ftruncate(fd, static_cast<off_t>(sizeof(CacheHeader) + header.bucket_count * bucket_bytes)) == 0 &&
+             pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+    } else {
+        ok = pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+             header.magic == cache_magic && header.format == cache_format && header.ways == ways &&
+             static_cast<std::uint64_t>(info.st_size) == sizeof(CacheHeader) + header.bucket_count * bucket_bytes;
+    }
+
+    if (ok) {
+        mapped_bytes = sizeof(CacheHeader) + header.bucket_count * bucket_bytes;
+        void* mapping = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ok = false;
+        } else {
+            base = static_cast<unsigned char*>(mapping);
+            bucket_count = header.bucket_count;
+        }
+    }
+
+    flock(fd, LOCK_UN);
+    ::close(fd); // the mapping stays valid
+    if (!ok) {
+        std::cerr << "Error: not a usable result cache: " << filepath << "\n";
+        mapped_bytes = 0;
+    }
+    return ok;
+}
+
+void ResultCache::close() {
+    if (base != nullptr) munmap(base, mapped_bytes);
+    base = nullptr;
+    mapped_bytes = 0;
+    bucket_count = 0;
+}
+
+#else
+
+bool ResultCache::open(const std::string& filepath, std::size_t) {
+    std::cerr << "Error: result cache needs mmap, not available on this platform: " << filepath << "\n";
+    return false;
+}
+
+void ResultCache::close() {}
+
+#endif
+
+bool ResultCache::lookup(const CacheKey& key, BacktestResult& out) {
+    if (base == nullptr) return false;
+
+    auto* bucket = reinterpret_cast<std::uint64_t*>(base + sizeof(CacheHeader) + (key.hi % bucket_count) * bucket_bytes);
+    std::uint64_t& seq = bucket[0];
+    std::uint64_t* slots = bucket + 1;
+
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        std::uint64_t before = loadWord(seq, std::memory_order_acquire);
+        if (before & 1) {
+            // A writer is in the bucket, or died there.
+            if (!reclaimIfStuck(bucket, before)) std::this_thread::yield();
+            continue;
+        }
+
+        int found = -1;
+        std::uint64_t words[payload_words];
+        for (std::size_t w = 0; w < ways && found < 0; w++) {
+            std::uint64_t* slot = slots + w * slot_words;
+            if (loadWord(slot[0]) == key.hi && loadWord(slot[1]) == key.lo) {
+                for (std::size_t i = 0; i < payload_words; i++) words[i] = loadWord(slot[3 + i]);
+                found = static_cast<int>(w);
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (loadWord(seq) != before) continue; // torn read, try again
+
+        if (found < 0) break;
+        storeWord(slots[found * slot_words + 2], nowTicks());
+        out = decode(words);
+        counters.hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    counters.misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool ResultCache::store(const CacheKey& key, const BacktestResult& result) {
+    if (base == nullptr) return false;
+
+    auto* bucket = reinterpret_cast<std::uint64_t*>(base + sizeof(CacheHeader) + (key.hi % bucket_count) * bucket_bytes);
+    std::atomic_ref<std::uint64_t> seq(bucket[0]);
+    std::uint64_t* slots = bucket + 1;
+
+    // Take the bucket by moving its sequence from even to odd.
+    std::uint64_t before = 0;
+    bool locked = false;
+    for (int attempt = 0; attempt < 1000 && !locked; attempt++) {
+        before = seq.load(std::memory_order_relaxed);
+        if ((before & 1) == 0) {
+            locked = seq.compare_exchange_weak(before, before + 1, std::memory_order_acquire);
+        } else if (reclaimIfStuck(bucket, before)) {
+            continue;
+        }
+        if (!locked) std::this_thread::yield();
+    }
+    if (!locked) return false;
+    // The odd sequence must be visible before any slot word changes, or a
+    // reader could see new words under the old even sequence and accept them.
+    std::atomic_thread_fence(std::memory_order_release);
+    const std::uint64_t now = nowTicks();
+    markHeld(bucket, before + 1, now);
+
+    // Same key, else an empty way, else the least recently used one.
+    std::size_t target = ways;
+    std::size_t oldest = 0;
+    for (std::size_t w = 0; w < ways; w++) {
+        std::uint64_t* slot = slots + w * slot_words;
+        std::uint64_t hi = loadWord(slot[0]);
+        std::uint64_t lo = loadWord(slot[1]);
+        if (hi == key.hi && lo == key.lo) {
+            target = w;
+            break;
+        }
+        if (target == ways && hi == 0 && lo == 0) target = w;
+        if (loadWord(slot[2]) < loadWord(slots[oldest * slot_words + 2])) oldest = w;
+    }
+    if (target == ways) {
+        target = oldest;
+        counters.evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t* slot = slots + target * slot_words;
+    std::uint64_t words[payload_words];
+    encode(result, words);
+    storeWord(slot[0], key.hi);
+    storeWord(slot[1], key.lo);
+    storeWord(slot[2], now);
+    for (std::size_t i = 0; i < payload_words; i++) storeWord(slot[3 + i], words[i]);
+
+    // Only fails if this writer was stalled past stuck_after and the bucket
+    // reclaimed under it; the bucket is no longer ours to release then.
+    std::uint64_t held = before + 1;
+    if (!seq.compare_exchange_strong(held, before + 2, std::memory_order_release, std::memory_order_relaxed)) {
+        return false;
+    }
+    counters.stores.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
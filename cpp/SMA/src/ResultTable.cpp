@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "BinaryIO.hpp"
+#include "ResultTable.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::uint64_t table_magic = 0x31544c5352414d53ull; // "SMARSLT1"
+constexpr std::uint32_t table_format = 1;
+constexpr std::size_t min_chunk_rows = 1 << 16;
+
+struct TableHeader {
+    std::uint64_t magic;
+    std::uint32_t format;
+    std::uint32_t name_bytes;
+    std::uint64_t rows;
+    std::uint64_t columns;
+    std::uint64_t padding[4];
+};
+static_assert(sizeof(TableHeader) == 64);
+
+std::size_t alignedBytes(std::size_t bytes) { return (bytes + 63) / 64 * 64; }
+
+std::size_t tableBytes(std::size_t rows, std::size_t columns) {
+    return sizeof(TableHeader) + alignedBytes(columns * ResultTable::name_bytes) + columns * alignedBytes(rows * 8);
+}
+
+std::size_t maxChunks(ThreadPool* pool) { return pool == nullptr ? 1 : pool->size() * 4; }
+
+// Splits [0, count) into at most maxChunks(pool) chunks and runs
+// fn(chunk, first, last) for each, on `pool` when there is one. Returns the
+// number of chunks.
+template <typename Fn>
+std::size_t forChunks(ThreadPool* pool, std::size_t count, Fn fn) {
+    const std::size_t wanted = maxChunks(pool);
+    const std::size_t rows = std::max(min_chunk_rows, (count + wanted - 1) / std::max<std::size_t>(1, wanted));
+    const std::size_t chunks = std::max<std::size_t>(1, (count + rows - 1) / rows);
+    if (pool == nullptr || chunks == 1) {
+        for (std::size_t c = 0; c < chunks; c++) fn(c, c * rows, std::min(count, (c + 1) * rows));
+        return chunks;
+    }
+    for (std::size_t c = 0; c < chunks; c++) {
+        pool->submit([&fn, c, rows, count] { fn(c, c * rows, std::min(count, (c + 1) * rows)); });
+    }
+    pool->wait();
+    return chunks;
+}
+
+std::vector<std::uint32_t> concat(std::vector<std::vector<std::uint32_t>>& parts) {
+    std::size_t total = 0;
+    for (const auto& part : parts) total += part.size();
+    std::vector<std::uint32_t> out;
+    out.reserve(total);
+    for (const auto& part : parts) out.insert(out.end(), part.begin(), part.end());
+    return out;
+}
+
+// Block-nested-loop skyline over `ids`: a window of rows nothing has beaten
+// yet, each candidate checked against it. Values are flipped so larger is
+// better on every axis. The window stays in row order.
+class FrontWindow {
+public:
+    FrontWindow(std::span<const std::span<const double>> axes, std::span<const double> signs)
+        : axes(axes), signs(signs), point(axes.size()) {}
+
+    void offer(std::uint32_t id) {
+        const std::size_t d = axes.size();
+        for (std::size_t a = 0; a < d; a++) {
+            point[a] = signs[a] * axes[a][id];
+            if (std::isnan(point[a])) return;
+        }
+        // The point that beat the last candidate is the likeliest to beat this one.
+        if (last < ids.size() && dominates(&values[last * d], point.data())) return;
+        std::size_t kept = 0;
+        for (std::size_t w = 0; w < ids.size(); w++) {
+            const double* other = &values[w * d];
+            // Anything this point beats would be beaten by `other` too, so
+            // nothing has been removed yet and w still indexes the window.
+            if (dominates(other, point.data())) {
+                last = w;
+                return;
+            }
+            if (dominates(point.data(), other)) continue;
+            if (kept != w) {
+                ids[kept] = ids[w];
+                std::copy_n(other, d, &values[kept * d]);
+            }
+            kept++;
+        }
+        ids.resize(kept);
+        values.resize(kept * d);
+        ids.push_back(id);
+        values.insert(values.end(), point.begin(), point.end());
+    }
+
+    std::vector<std::uint32_t> take() { return std::move(ids); }
+
+private:
+    bool dominates(const double* a, const double* b) const {
+        bool better = false;
+        for (std::size_t j = 0; j < axes.size(); j++) {
+            if (a[j] < b[j]) return false;
+            better = better || a[j] > b[j];
+        }
+        return better;
+    }
+
+    std::span<const std::span<const double>> axes;
+    std::span<const double> signs;
+    std::vector<double> point;
+    std::vector<std::uint32_t> ids;
+    std::vector<double> values;
+    std::size_t last {};
+};
+
+} // namespace
+
+ResultTable::ResultTable(std::vector<std::string> names) : names(std::move(names)) {
+    owned.resize(this->names.size());
+    refresh();
+}
+
+ResultTable::~ResultTable() { close(); }
+
+std::vector<std::string> ResultTable::sweepColumns() {
+    return {"fast", "slow", "path", "total_return", "max_drawdown", "trades", "turnover", "exposure", "final_equity"};
+}
+
+void ResultTable::appendSweep(const std::vector<SmaParams>& pairs, const std::vector<BacktestResult>& results,
+                              double path) {
+    if (names != sweepColumns()) {
+        std::cerr << "Error: result table does not have the sweep columns\n";
+        return;
+    }
+    const std::size_t n = std::min(pairs.size(), results.size());
+    reserve(row_count + n);
+    for (std::size_t i = 0; i < n; i++) {
+        const BacktestResult& r = results[i];
+        const double bars = std::max(1, r.bars);
+        const double row[] = {static_cast<double>(pairs[i].fast), static_cast<double>(pairs[i].slow), path,
+                              r.total_return, r.max_drawdown, static_cast<double>(r.trades),
+                              r.trades * 252.0 / bars, r.bars_in_market / bars, r.final_equity};
+        appendRow(row);
+    }
+}
+
+void ResultTable::appendRow(std::span<const double> row) {
+    if (isMapped() || row.size() != names.size()) {
+        std::cerr << "Error: cannot append a row of " << row.size() << " values to this result table\n";
+        return;
+    }
+    for (std::size_t c = 0; c < owned.size(); c++) owned[c].push_back(row[c]);
+    row_count++;
+    refresh();
+}
+
+void ResultTable::reserve(std::size_t rows) {
+    for (std::vector<double>& values : owned) values.reserve(rows);
+    refresh();
+}
+
+void ResultTable::refresh() {
+    data.resize(owned.size());
+    for (std::size_t c = 0; c < owned.size(); c++) data[c] = owned[c].data();
+}
+
+std::size_t ResultTable::find(const std::string& name) const {
+    return static_cast<std::size_t>(std::find(names.begin(), names.end(), name) - names.begin());
+}
+
+bool ResultTable::save(const std::string& filepath) const {
+    std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error: cannot write result table: " << filepath << "\n";
+        return false;
+    }
+    const TableHeader header {table_magic, table_format, name_bytes, row_count, names.size(), {}};
+    writeValue(out, header);
+    std::vector<char> block(alignedBytes(names.size() * name_bytes), 0);
+    for (std::size_t c = 0; c < names.size(); c++) {
+        std::memcpy(&block[c * name_bytes], names[c].data(), std::min(names[c].size(), name_bytes - 1));
+    }
+    out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    const std::vector<char> padding(64, 0);
+    for (std::size_t c = 0; c < names.size(); c++) {
+        out.write(reinterpret_cast<const char*>(data[c]), static_cast<std::streamsize>(row_count * 8));
+        out.write(padding.data(), static_cast<std::streamsize>(alignedBytes(row_count * 8) - row_count * 8));
+    }
+    return static_cast<bool>(out);
+}
+
+#ifndef _WIN32
+
+bool ResultTable::open(const std::string& filepath) {
+    close();
+    names.clear();
+    owned.clear();
+    data.clear();
+    row_count = 0;
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: cannot open result table: " << filepath << "\n";
+        return false;
+    }
+    struct stat info {};
+    fstat(fd, &info);
+    TableHeader header {};
+    bool ok = pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+              header.magic == table_magic && header.format == table_format && header.name_bytes == name_bytes &&
+              static_cast<std::uint64_t>(info.st_size) == tableBytes(header.rows, header.columns);
+    if (ok) {
+        void* mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ok = false;
+        } else {
+            base = static_cast<const unsigned char*>(mapping);
+            mapped_bytes = static_cast<std::size_t>(info.st_size);
+        }
+    }
+    ::close(fd); // the mapping stays valid
+    if (!ok) {
+        std::cerr << "Error: not a usable result table: " << filepath << "\n";
+        return false;
+    }
+
+    row_count = header.rows;
+    const unsigned char* name_block = base + sizeof(TableHeader);
+    const unsigned char* columns = name_block + alignedBytes(header.columns * name_bytes);
+    for (std::size_t c = 0; c < header.columns; c++) {
+        const char* name = reinterpret_cast<const char*>(name_block + c * name_bytes);
+        names.emplace_back(name, strnlen(name, name_bytes));
+        data.push_back(reinterpret_cast<const double*>(columns + c * alignedBytes(row_count * 8)));
+    }
+    return true;
+}
+
+void ResultTable::close() {
+    if (base == nullptr) return; // built in memory: nothing to unmap
+    munmap(const_cast<unsigned char*>(base), mapped_bytes);
+    base = nullptr;
+    mapped_bytes = 0;
+    names.clear();
+    data.clear();
+    row_count = 0;
+}
+
+#else
+
+bool ResultTable::open(const std::string& filepath) {
+    std::cerr << "Error: result table needs mmap, not available on this platform: " << filepath << "\n";
+    return false;
+}
+
+void ResultTable::close() {}
+
+#endif
+
+std::vector<std::uint32_t> filterRows(const ResultTable& table, std::span<const RowFilter> filters,
+                                      const std::vector<std::uint32_t>* rows, ThreadPool* pool) {
+    const std::size_t count = rows == nullptr ? table.rows() : rows->size();
+    std::vector<std::vector<std::uint32_t>> parts(maxChunks(pool));
+    const std::size_t chunks = forChunks(pool, count, [&](std::size_t c, std::size_t first, std::size_t last) {
+        // Each filter narrows the ids left, writing every id and advancing
+        // only past kept ones: no branch.
+        std::vector<std::uint32_t> ids(last - first);
+        std::size_t kept = last - first;
+        if (rows == nullptr) {
+            for (std::size_t i = 0; i < kept; i++) ids[i] = static_cast<std::uint32_t>(first + i);
+        } else {
+            std::copy(rows->begin() + static_cast<std::ptrdiff_t>(first),
+                      rows->begin() + static_cast<std::ptrdiff_t>(last), ids.begin());
+        }
+        for (const RowFilter& f : filters) {
+            const double* values = table.column(f.column).data();
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < kept; i++) {
+                const double v = values[ids[i]];
+                ids[n] = ids[i];
+                n += (v >= f.min) & (v < f.max);
+            }
+            kept = n;
+        }
+        ids.resize(kept);
+        parts[c] = std::move(ids);
+    });
+    parts.resize(chunks);
+    return concat(parts);
+}
+
+std::vector<std::uint32_t> topK(const ResultTable& table, std::size_t column, std::size_t k, bool largest,
+                                const std::vector<std::uint32_t>* rows, ThreadPool* pool) {
+    using Entry = std::pair<double, std::uint32_t>;
+    auto better = [largest](const Entry& a, const Entry& b) {
+        if (a.first != b.first) return largest ? a.first > b.first : a.first < b.first;
+        return a.second < b.second;
+    };
+    const double* values = table.column(column).data();
+    const std::size_t count = rows == nullptr ? table.rows() : rows->size();
+    if (k == 0) return {};
+
+    // Each chunk keeps its k best in a heap with the worst on top, so most
+    // rows cost one comparison against it.
+    std::vector<std::vector<Entry>> parts(maxChunks(pool));
+    const std::size_t chunks = forChunks(pool, count, [&](std::size_t c, std::size_t first, std::size_t last) {
+        std::vector<Entry> heap;
+        heap.reserve(k + 1);
+        for (std::size_t i = first; i < last; i++) {
+            const std::uint32_t id = rows == nullptr ? static_cast<std::uint32_t>(i) : (*rows)[i];
+            const Entry entry {values[id], id};
+            if (std::isnan(entry.first)) continue;
+            if (heap.size() == k) {
+                if (!better(entry, heap.front())) continue;
+                std::pop_heap(heap.begin(), heap.end(), better);
+                heap.back() = entry;
+            } else {
+                heap.push_back(entry);
+            }
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+        parts[c] = std::move(heap);
+    });
+
+    std::vector<Entry> candidates;
+    for (std::size_t c = 0; c < chunks; c++) candidates.insert(candidates.end(), parts[c].begin(), parts[c].end());
+    const std::size_t keep = std::min(k, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(keep), candidates.end(),
+                      better);
+    std::vector<std::uint32_t> out(keep);
+    for (std::size_t i = 0; i < keep; i++) out[i] = candidates[i].second;
+    return out;
+}
+
+std::vector<std::uint32_t> paretoFront(const ResultTable& table, std::span<const ParetoAxis> axes,
+                                       const std::vector<std::uint32_t>* rows, ThreadPool* pool) {
+    std::vector<std::span<const double>> columns;
+    std::vector<double> signs;
+    for (const ParetoAxis& axis : axes) {
+        columns.push_back(table.column(axis.column));
+        signs.push_back(axis.maximize ? 1.0 : -1.0);
+    }
+    const std::size_t count = rows == nullptr ? table.rows() : rows->size();
+
+    std::vector<std::vector<std::uint32_t>> parts(maxChunks(pool));
+    const std::size_t chunks = forChunks(pool, count, [&](std::size_t c, std::size_t first, std::size_t last) {
+        FrontWindow window(columns, signs);
+        for (std::size_t i = first; i < last; i++) {
+            window.offer(rows == nullptr ? static_cast<std::uint32_t>(i) : (*rows)[i]);
+        }
+        parts[c] = window.take();
+    });
+    parts.resize(chunks);
+    if (chunks == 1) return std::move(parts[0]);
+
+    // A row beaten inside its chunk is beaten overall, so only chunk fronts
+    // need merging; chunks are in row order, and so is each front.
+    FrontWindow merged(columns, signs);
+    for (std::uint32_t id : concat(parts)) merged.offer(id);
+    return merged.take();
+}
@@ -0,0 +1,508 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include "Server.hpp"
+#include "Sweep.hpp"
+#include "ThreadPool.hpp"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+void LatencyHistogram::record(double seconds) {
+    const auto us = static_cast<std::uint64_t>(std::max(0.0, seconds * 1e6));
+    buckets[std::min<std::size_t>(bucket_count - 1, std::bit_width(us))]++;
+}
+
+std::uint64_t LatencyHistogram::count() const {
+    std::uint64_t total = 0;
+    for (std::uint64_t n : buckets) total += n;
+    return total;
+}
+
+double LatencyHistogram::percentile(double p) const {
+    const std::uint64_t total = count();
+    if (total == 0) return 0.0;
+    const auto wanted = static_cast<std::uint64_t>(p / 100.0 * static_cast<double>(total - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < bucket_count; b++) {
+        seen += buckets[b];
+        if (seen >= wanted) return static_cast<double>(std::uint64_t(1) << b);
+    }
+    return static_cast<double>(std::uint64_t(1) << (bucket_count - 1));
+}
+
+void LatencyHistogram::print(std::ostream& out) const {
+    out << "Requests: " << count() << "  p50 < " << percentile(50) << " us  p99 < " << percentile(99)
+        << " us  p99.9 < " << percentile(99.9) << " us\n";
+    for (std::size_t b = 0; b < bucket_count; b++) {
+        if (buckets[b] == 0) continue;
+        out << "  < " << (std::uint64_t(1) << b) << " us: " << buckets[b] << "\n";
+    }
+}
+
+#ifndef _WIN32
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Dataset {
+    PriceSeries series;
+    std::unique_ptr<SmaColumnCache> columns;
+};
+
+struct Connection {
+    int fd = -1;
+    std::vector<unsigned char> in;
+    std::vector<unsigned char> out;
+    bool eof {}; // the peer has sent everything; close once `out` is flushed
+    bool closed {};
+};
+
+struct Request {
+    std::size_t connection {};
+    WireHeader header;
+    std::vector<unsigned char> payload;
+    Clock::time_point arrived;
+    WireStatus status = WireStatus::Ok;
+    std::vector<BacktestResult> results;
+    std::vector<WireStatus> pair_status; // per pair, for pairs refused on their own
+};
+
+// Pairs from every request in a batch that share a dataset and config,
+// run as one sweep so small requests still fill the kernel's lanes.
+struct Group {
+    std::vector<SmaParams> pairs;
+    std::vector<std::pair<std::size_t, std::size_t>> owners; // (request, index in its results)
+    std::vector<BacktestResult> results;
+};
+
+void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+void appendBytes(std::vector<unsigned char>& buffer, const void* data, std::size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+// Reads what the socket has, up to a couple of the largest messages per
+// round, and queues every complete request, including those that arrived
+// just before end of stream. False if the socket failed or the stream is bad.
+bool readRequests(Connection& connection, std::size_t index, std::vector<Request>& batch) {
+    constexpr std::size_t read_limit = 2 * (sizeof(WireHeader) + max_wire_payload);
+    unsigned char chunk[64 * 1024];
+    while (connection.in.size() < read_limit) {
+        ssize_t n = ::read(connection.fd, chunk, sizeof(chunk));
+        if (n > 0) {
+            connection.in.insert(connection.in.end(), chunk, chunk + n);
+            continue;
+        }
+        if (n == 0) {
+            connection.eof = true;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return false;
+    }
+
+    const Clock::time_point now = Clock::now();
+    std::size_t used = 0;
+    while (connection.in.size() - used >= sizeof(WireHeader)) {
+        WireHeader header;
+        std::memcpy(&header, connection.in.data() + used, sizeof(header));
+        if (header.size > max_wire_payload) return false;
+        if (connection.in.size() - used - sizeof(header) < header.size) break;
+
+        const unsigned char* payload = connection.in.data() + used + sizeof(header);
+        batch.push_back(Request{index, header, {payload, payload + header.size}, now, WireStatus::Ok, {}, {}});
+        used += sizeof(header) + header.size;
+    }
+    connection.in.erase(connection.in.begin(), connection.in.begin() + static_cast<std::ptrdiff_t>(used));
+    return true;
+}
+
+bool flush(Connection& connection) {
+    std::size_t done = 0;
+    while (done < connection.out.size()) {
+        ssize_t n = ::send(connection.fd, connection.out.data() + done, connection.out.size() - done, MSG_NOSIGNAL);
+        if (n > 0) {
+            done += static_cast<std::size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return false;
+    }
+    connection.out.erase(connection.out.begin(), connection.out.begin() + static_cast<std::ptrdiff_t>(done));
+    return true;
+}
+
+// Decodes every Backtest request, runs them grouped on the pool, and fills
+// in each request's results or error status.
+void runBatch(std::vector<Request>& batch, std::vector<std::unique_ptr<Dataset>>& datasets,
+              ThreadPool& pool, std::size_t pairs_per_task, std::size_t column_cache_bytes) {
+    std::map<std::tuple<std::uint16_t, double, double>, Group> groups;
+
+    for (std::size_t r = 0; r < batch.size(); r++) {
+        Request& request = batch[r];
+        if (static_cast<WireOp>(request.header.op) != WireOp::Backtest) continue;
+
+        WireBacktest head;
+        if (request.payload.size() < sizeof(head)) {
+            request.status = WireStatus::BadRequest;
+            continue;
+        }
+        std::memcpy(&head, request.payload.data(), sizeof(head));
+        if (request.payload.size() != sizeof(head) + std::size_t(head.count) * sizeof(WirePair)) {
+            request.status = WireStatus::BadRequest;
+            continue;
+        }
+        if (request.header.dataset >= datasets.size()) {
+            request.status = WireStatus::UnknownDataset;
+            continue;
+        }
+
+        std::vector<SmaParams> pairs(head.count);
+        for (std::size_t i = 0; i < head.count; i++) {
+            WirePair pair;
+            std::memcpy(&pair, request.payload.data() + sizeof(head) + i * sizeof(pair), sizeof(pair));
+            if (pair.fast < 1 || pair.slow < 1) {
+                request.status = WireStatus::BadRequest;
+                break;
+            }
+            pairs[i] = SmaParams{pair.fast, pair.slow};
+        }
+        if (request.status != WireStatus::Ok) continue;
+
+        request.results.resize(pairs.size());
+        request.pair_status.assign(pairs.size(), WireStatus::Ok);
+        // A window longer than the data would only allocate a column of NaN.
+        const auto bars = static_cast<int>(datasets[request.header.dataset]->series.size());
+        Group& group = groups[{request.header.dataset, head.initial_cash, head.cost_bps}];
+        for (std::size_t i = 0; i < pairs.size(); i++) {
+            if (pairs[i].fast > bars || pairs[i].slow > bars) {
+                request.pair_status[i] = WireStatus::WindowTooLong;
+                continue;
+            }
+            group.pairs.push_back(pairs[i]);
+            group.owners.emplace_back(r, i);
+        }
+    }
+
+    for (auto& [key, group] : groups) {
+        Dataset& dataset = *datasets[std::get<0>(key)];
+        // New windows are computed in parallel up front and stay cached.
+        dataset.columns->prepare(group.pairs, &pool);
+        group.results.resize(group.pairs.size());
+
+        const BacktestConfig config{std::get<1>(key), std::get<2>(key)};
+        for (std::size_t first = 0; first < group.pairs.size(); first += pairs_per_task) {
+            const std::size_t last = std::min(group.pairs.size(), first + pairs_per_task);
+            pool.submit([&dataset, &group, config, first, last] {
+                std::vector<SmaParams> pairs(group.pairs.begin() + static_cast<std::ptrdiff_t>(first),
+                                             group.pairs.begin() + static_cast<std::ptrdiff_t>(last));
+                std::vector<BacktestResult> results =
+                    runSmaSweepBatched(dataset.series.view(), pairs, *dataset.columns, config);
+                std::copy(results.begin(), results.end(), group.results.begin() + static_cast<std::ptrdiff_t>(first));
+            });
+        }
+    }
+    pool.wait();
+
+    for (auto& [key, group] : groups) {
+        for (std::size_t i = 0; i < group.owners.size(); i++) {
+            batch[group.owners[i].first].results[group.owners[i].second] = group.results[i];
+        }
+    }
+    // Nothing holds a column between batches, so this is where the caches shrink.
+    for (auto& [key, group] : groups) datasets[std::get<0>(key)]->columns->trim(column_cache_bytes);
+}
+
+void appendReply(const Request& request, const LatencyHistogram& histogram, std::vector<unsigned char>& out) {
+    WireHeader header;
+    header.id = request.header.id;
+    header.dataset = request.header.dataset;
+    header.op = static_cast<std::uint16_t>(request.status);
+
+    if (request.status != WireStatus::Ok) {
+        appendBytes(out, &header, sizeof(header));
+    } else if (static_cast<WireOp>(request.header.op) == WireOp::Stats) {
+        header.size = sizeof(histogram.buckets);
+        appendBytes(out, &header, sizeof(header));
+        appendBytes(out, histogram.buckets.data(), sizeof(histogram.buckets));
+    } else {
+        header.size = static_cast<std::uint32_t>(request.results.size() * sizeof(WireResult));
+        appendBytes(out, &header, sizeof(header));
+        for (std::size_t i = 0; i < request.results.size(); i++) {
+            const BacktestResult& result = request.results[i];
+            const auto status = static_cast<std::int32_t>(request.pair_status[i]);
+            WireResult wire{result.final_equity, result.total_return, result.max_drawdown,
+                            result.trades, result.bars, result.bars_in_market, status};
+            appendBytes(out, &wire, sizeof(wire));
+        }
+    }
+}
+
+} // namespace
+
+int serveBacktests(const ServerConfig& config, const volatile std::sig_atomic_t& stop) {
+    std::vector<std::unique_ptr<Dataset>> datasets;
+    for (const std::string& path : config.datasets) {
+        auto dataset = std::make_unique<Dataset>();
+        dataset->series = loadSeries(path);
+        if (dataset->series.size() == 0) return 1;
+        dataset->columns = std::make_unique<SmaColumnCache>(dataset->series.view());
+        std::cout << "Dataset " << datasets.size() << ": " << path << " (" << dataset->series.size() << " bars)" << std::endl;
+        datasets.push_back(std::move(dataset));
+    }
+
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (config.socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: socket path too long: " << config.socket_path << "\n";
+        return 1;
+    }
+    std::strcpy(address.sun_path, config.socket_path.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(config.socket_path.c_str());
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, 128) != 0) {
+        std::cerr << "Error: cannot listen on " << config.socket_path << "\n";
+        if (listener >= 0) ::close(listener);
+        return 1;
+    }
+    setNonBlocking(listener);
+
+    ThreadPool pool(config.threads);
+    const std::size_t pairs_per_task = std::max<std::size_t>(1, config.pairs_per_task);
+    std::vector<Connection> connections;
+    std::vector<pollfd> polled;
+    std::vector<Request> batch;
+    LatencyHistogram histogram;
+    std::cout << "Listening on " << config.socket_path << " with " << pool.size() << " threads" << std::endl;
+
+    while (stop == 0) {
+        polled.clear();
+        polled.push_back(pollfd{listener, POLLIN, 0});
+        auto readable = [&](const Connection& connection) {
+            return !connection.eof && connection.out.size() < config.max_pending_reply_bytes;
+        };
+        for (const Connection& connection : connections) {
+            short events = readable(connection) ? POLLIN : 0;
+            if (!connection.out.empty()) events |= POLLOUT;
+            polled.push_back(pollfd{connection.fd, events, 0});
+        }
+        if (poll(polled.data(), polled.size(), 200) <= 0) continue;
+
+        for (std::size_t i = 0; i < connections.size(); i++) {
+            const short events = polled[i + 1].revents;
+            if (!readable(connections[i])) continue;
+            if ((events & (POLLIN | POLLHUP | POLLERR)) && !readRequests(connections[i], i, batch)) {
+                connections[i].closed = true;
+            }
+        }
+
+        if (!batch.empty()) {
+            runBatch(batch, datasets, pool, pairs_per_task, config.column_cache_bytes);
+            const Clock::time_point done = Clock::now();
+            for (Request& request : batch) {
+                if (static_cast<WireOp>(request.header.op) == WireOp::Backtest) {
+                    histogram.record(std::chrono::duration<double>(done - request.arrived).count());
+                } else if (static_cast<WireOp>(request.header.op) != WireOp::Stats) {
+                    request.status = WireStatus::BadRequest;
+                }
+                appendReply(request, histogram, connections[request.connection].out);
+            }
+            batch.clear();
+        }
+
+        for (Connection& connection : connections) {
+            if (!connection.closed && !connection.out.empty() && !flush(connection)) connection.closed = true;
+            if (connection.eof && connection.out.empty()) connection.closed = true;
+        }
+
+        // New connections last, so the indices in this round's batch stayed valid.
+        if (polled[0].revents & POLLIN) {
+            int fd = -1;
+            while ((fd = accept(listener, nullptr, nullptr)) >= 0) {
+                setNonBlocking(fd);
+                connections.push_back(Connection{fd, {}, {}, false});
+            }
+        }
+        for (Connection& connection : connections) {
+            if (connection.closed) ::close(connection.fd);
+        }
+        std::erase_if(connections, [](const Connection& connection) { return connection.closed; });
+    }
+
+    for (Connection& connection : connections) ::close(connection.fd);
+    ::close(listener);
+    ::unlink(config.socket_path.c_str());
+    std::cout << "Stopped." << std::endl;
+    histogram.print(std::cout);
+    return 0;
+}
+
+bool writeAll(int fd, const void* data, std::size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    while (size > 0) {
+        ssize_t n = ::send(fd, bytes, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        bytes += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool readAll(int fd, void* data, std::size_t size) {
+    auto* bytes = static_cast<unsigned char*>(data);
+    while (size > 0) {
+        ssize_t n = ::read(fd, bytes, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        bytes += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool BacktestClient::connect(const std::string& socket_path) {
+    close();
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) return false;
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Error: cannot connect to " << socket_path << "\n";
+        close();
+        return false;
+    }
+    return true;
+}
+
+void BacktestClient::close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+bool BacktestClient::send(std::uint16_t dataset, const std::vector<SmaParams>& pairs, const BacktestConfig& config) {
+    WireBacktest head{config.initial_cash, config.cost_bps, static_cast<std::uint32_t>(pairs.size()), 0};
+    WireHeader header{static_cast<std::uint32_t>(sizeof(head) + pairs.size() * sizeof(WirePair)),
+                      static_cast<std::uint16_t>(WireOp::Backtest), dataset, next_id++};
+    if (header.size > max_wire_payload) return false;
+
+    std::vector<unsigned char> message;
+    message.reserve(sizeof(header) + header.size);
+    appendBytes(message, &header, sizeof(header));
+    appendBytes(message, &head, sizeof(head));
+    for (const SmaParams& p : pairs) {
+        WirePair pair{p.fast, p.slow};
+        appendBytes(message, &pair, sizeof(pair));
+    }
+    return writeAll(fd, message.data(), message.size());
+}
+
+bool BacktestClient::readReply(WireHeader& header, std::vector<unsigned char>& payload) {
+    if (!readAll(fd, &header, sizeof(header)) || header.size > max_wire_payload) return false;
+    payload.resize(header.size);
+    return readAll(fd, payload.data(), payload.size());
+}
+
+bool BacktestClient::receive(std::vector<BacktestResult>& results, std::vector<WireStatus>* statuses) {
+    WireHeader header;
+    std::vector<unsigned char> payload;
+    if (!readReply(header, payload)) return false;
+    if (static_cast<WireStatus>(header.op) != WireStatus::Ok) {
+        std::cerr << "Error: request " << header.id << " failed with status " << header.op << "\n";
+        return false;
+    }
+
+    results.resize(payload.size() / sizeof(WireResult));
+    if (statuses != nullptr) statuses->assign(results.size(), WireStatus::Ok);
+    std::size_t refused = 0;
+    for (std::size_t i = 0; i < results.size(); i++) {
+        WireResult wire;
+        std::memcpy(&wire, payload.data() + i * sizeof(wire), sizeof(wire));
+        results[i] = BacktestResult{wire.final_equity, wire.total_return, wire.max_drawdown,
+                                    wire.trades, wire.bars, wire.bars_in_market};
+        if (wire.status == 0) continue;
+        refused++;
+        if (statuses != nullptr) (*statuses)[i] = static_cast<WireStatus>(wire.status);
+    }
+    if (refused > 0 && statuses == nullptr) {
+        std::cerr << "Error: request " << header.id << " had " << refused << " pairs refused\n";
+        return false;
+    }
+    return true;
+}
+
+bool BacktestClient::stats(LatencyHistogram& histogram) {
+    WireHeader header{0, static_cast<std::uint16_t>(WireOp::Stats), 0, next_id++};
+    std::vector<unsigned char> payload;
+    if (!writeAll(fd, &header, sizeof(header)) || !readReply(header, payload)) return false;
+    if (payload.size() != sizeof(histogram.buckets)) return false;
+    std::memcpy(histogram.buckets.data(), payload.data(), payload.size());
+    return true;
+}
+
+#else
+
+int serveBacktests(const ServerConfig& config, const volatile std::sig_atomic_t&) {
+    std::cerr << "Error: server mode needs Unix sockets, not available on this platform: " << config.socket_path << "\n";
+    return 1;
+}
+
+bool BacktestClient::connect(const std::string& socket_path) {
+    std::cerr << "Error: server mode needs Unix sockets, not available on this platform: " << socket_path << "\n";
+    return false;
+}
+
+void BacktestClient::close() {}
+
+bool writeAll(int, const void*, std::size_t) {
+    return false;
+}
+
+bool readAll(int, void*, std::size_t) {
+    return false;
+}
+
+bool BacktestClient::send(std::uint16_t, const std::vector<SmaParams>&, const BacktestConfig&) {
+    return false;
+}
+
+bool BacktestClient::readReply(WireHeader&, std::vector<unsigned char>&) {
+    return false;
+}
+
+bool BacktestClient::receive(std::vector<BacktestResult>&, std::vector<WireStatus>*) {
+    return false;
+}
+
+bool BacktestClient::stats(LatencyHistogram&) {
+    return false;
+}
+
+#endif
+
+BacktestClient::~BacktestClient() {
+    close();
+}
@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <thread>
+
+#include "Server.hpp"
+#include "ShardedSweep.hpp"
+#include "Sweep.hpp"
+
+#ifndef _WIN32
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Coordinator -> worker, followed by `count` WirePair.
+struct ShardRequest {
+    std::uint32_t shard {};
+    std::uint32_t attempt {};
+    std::uint32_t count {};
+    std::uint32_t reserved {};
+    double initial_cash {};
+    double cost_bps {};
+};
+
+// Worker -> coordinator, followed by `count` WireResult.
+struct ShardReply {
+    std::uint32_t shard {};
+    std::uint32_t count {};
+};
+
+struct Shard {
+    std::size_t first {};
+    std::size_t count {};
+    int attempts {};  // runs lost to crashes
+    int running {};   // workers on it right now
+    bool done {};
+};
+
+struct Worker {
+    pid_t pid = -1;
+    int fd = -1;
+    int shard = -1;   // -1 when idle
+    Clock::time_point started;
+    std::size_t completed {};
+};
+
+// Runs shards until the coordinator closes the socket.
+[[noreturn]] void workerMain(int fd, std::size_t index, const PriceView& prices, const ShardConfig& shard) {
+    SmaColumnCache columns(prices); // stays warm across this worker's shards
+    ShardRequest request;
+    std::vector<SmaParams> pairs;
+    std::vector<WireResult> records;
+
+    while (readAll(fd, &request, sizeof(request))) {
+        pairs.resize(request.count);
+        bool ok = true;
+        for (SmaParams& p : pairs) {
+            WirePair pair;
+            ok = ok && readAll(fd, &pair, sizeof(pair));
+            p = SmaParams{pair.fast, pair.slow};
+        }
+        if (!ok) break;
+
+        if (static_cast<int>(request.shard) == shard.crash_shard && request.attempt == 0) _exit(3);
+        if (static_cast<int>(index) == shard.slow_worker) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(shard.slow_ms));
+        }
+
+        const BacktestConfig config{request.initial_cash, request.cost_bps};
+        std::vector<BacktestResult> results = runSmaSweepBatched(prices, pairs, columns, config, shard.lanes);
+        records.clear();
+        for (const BacktestResult& r : results) {
+            records.push_back(WireResult{r.final_equity, r.total_return, r.max_drawdown,
+                                         r.trades, r.bars, r.bars_in_market, 0});
+        }
+        ShardReply reply{request.shard, static_cast<std::uint32_t>(records.size())};
+        if (!writeAll(fd, &reply, sizeof(reply)) ||
+            !writeAll(fd, records.data(), records.size() * sizeof(WireResult))) {
+            break;
+        }
+    }
+    _exit(0); // no atexit handlers or stream flushes from the parent's state
+}
+
+bool spawn(std::vector<Worker>& workers, std::size_t index, const PriceView& prices, const ShardConfig& shard) {
+    Worker& worker = workers[index];
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return false;
+    std::cout.flush(); // or the child would inherit and repeat buffered output
+    pid_t pid = fork();
+    if (pid < 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        // Drop the copies of the other workers' sockets, or they would never
+        // see the end of stream when the coordinator closes its side.
+        for (const Worker& other : workers) {
+            if (other.fd >= 0) ::close(other.fd);
+        }
+        ::close(fds[0]);
+        workerMain(fds[1], index, prices, shard);
+    }
+    ::close(fds[1]);
+    worker.pid = pid;
+    worker.fd = fds[0];
+    worker.shard = -1;
+    return true;
+}
+
+void stop(Worker& worker, bool kill_it) {
+    if (worker.fd < 0) return;
+    ::close(worker.fd); // an idle worker sees the end of stream and exits
+    if (kill_it) ::kill(worker.pid, SIGKILL);
+    waitpid(worker.pid, nullptr, 0);
+    worker.fd = -1;
+}
+
+bool sendShard(Worker& worker, int id, const Shard& shard, const std::vector<SmaParams>& pairs,
+               const BacktestConfig& config) {
+    ShardRequest request{static_cast<std::uint32_t>(id), static_cast<std::uint32_t>(shard.attempts),
+                         static_cast<std::uint32_t>(shard.count), 0, config.initial_cash, config.cost_bps};
+    std::vector<WirePair> wire(shard.count);
+    for (std::size_t i = 0; i < shard.count; i++) {
+        wire[i] = WirePair{pairs[shard.first + i].fast, pairs[shard.first + i].slow};
+    }
+    worker.shard = id;
+    worker.started = Clock::now();
+    return writeAll(worker.fd, &request, sizeof(request)) &&
+           writeAll(worker.fd, wire.data(), wire.size() * sizeof(WirePair));
+}
+
+double median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2), values.end());
+    return values[values.size() / 2];
+}
+
+} // namespace
+
+std::vector<BacktestResult> runSmaSweepSharded(const PriceView& prices, const std::vector<SmaParams>& pairs,
+                                               const BacktestConfig& config, const ShardConfig& shard_config,
+                                               ShardStats* stats) {
+    ShardStats local_stats;
+    ShardStats& counters = stats != nullptr ? *stats : local_stats;
+    counters = ShardStats {};
+
+    std::vector<BacktestResult> results(pairs.size());
+    const std::size_t per_shard = std::max<std::size_t>(1, shard_config.shard_pairs);
+    std::vector<Shard> shards;
+    for (std::size_t first = 0; first < pairs.size(); first += per_shard) {
+        shards.push_back(Shard{first, std::min(per_shard, pairs.size() - first)});
+    }
+    counters.shards = shards.size();
+    if (shards.empty()) return results;
+
+    std::deque<int> queue;
+    for (std::size_t s = 0; s < shards.size(); s++) queue.push_back(static_cast<int>(s));
+
+    std::vector<Worker> workers(std::max<std::size_t>(1, shard_config.workers));
+    for (std::size_t w = 0; w < workers.size(); w++) {
+        if (!spawn(workers, w, prices, shard_config)) {
+            std::cerr << "Error: cannot start sweep worker\n";
+            for (Worker& worker : workers) stop(worker, true);
+            return {};
+        }
+    }
+
+    std::vector<double> durations;
+    std::vector<WireResult> records;
+    std::vector<pollfd> polled(workers.size());
+    std::size_t remaining = shards.size();
+    bool failed = false;
+
+    // Requeues the shard of a worker that died, then replaces the worker.
+    auto lost = [&](std::size_t w) {
+        Worker& worker = workers[w];
+        stop(worker, true);
+        counters.crashes++;
+        if (worker.shard >= 0) {
+            Shard& shard = shards[worker.shard];
+            shard.running--;
+            if (!shard.done && shard.running == 0) {
+                shard.attempts++;
+                if (shard.attempts >= shard_config.max_attempts) {
+                    std::cerr << "Error: shard " << worker.shard << " failed " << shard.attempts << " times\n";
+                    failed = true;
+                }
+                queue.push_front(worker.shard);
+                counters.retried++;
+            }
+        }
+        if (failed) return;
+        if (spawn(workers, w, prices, shard_config)) {
+            counters.respawned++;
+        } else {
+            failed = true;
+        }
+    };
+
+    while (remaining > 0 && !failed) {
+        // Hand work to idle workers: queued shards first, then copies of stragglers.
+        for (std::size_t w = 0; w < workers.size() && !failed; w++) {
+            Worker& worker = workers[w];
+            if (worker.shard >= 0) continue;
+            while (!queue.empty() && shards[queue.front()].done) queue.pop_front();
+
+            int next = -1;
+            if (!queue.empty()) {
+                next = queue.front();
+                queue.pop_front();
+            } else if (!durations.empty()) {
+                const double limit = shard_config.straggler_factor * median(durations);
+                for (const Worker& other : workers) {
+                    if (other.shard < 0 || shards[other.shard].done || shards[other.shard].running > 1) continue;
+                    if (std::chrono::duration<double>(Clock::now() - other.started).count() > limit) {
+                        next = other.shard;
+                        counters.reissued++;
+                        break;
+                    }
+                }
+            }
+            if (next < 0) continue;
+
+            shards[next].running++;
+            if (!sendShard(worker, next, shards[next], pairs, config)) lost(w);
+        }
+
+        for (std::size_t w = 0; w < workers.size(); w++) polled[w] = pollfd{workers[w].fd, POLLIN, 0};
+        if (poll(polled.data(), polled.size(), 20) <= 0) continue;
+
+        for (std::size_t w = 0; w < workers.size() && !failed; w++) {
+            if ((polled[w].revents & (POLLIN | POLLHUP | POLLERR)) == 0) continue;
+            Worker& worker = workers[w];
+
+            ShardReply reply;
+            bool ok = readAll(worker.fd, &reply, sizeof(reply)) && static_cast<int>(reply.shard) == worker.shard &&
+                      reply.count == shards[worker.shard].count;
+            if (ok) {
+                records.resize(reply.count);
+                ok = readAll(worker.fd, records.data(), records.size() * sizeof(WireResult));
+            }
+            if (!ok) {
+                lost(w);
+                continue;
+            }
+
+            Shard& shard = shards[worker.shard];
+            shard.running--;
+            if (shard.done) {
+                counters.duplicates++;
+            } else {
+                for (std::size_t i = 0; i < records.size(); i++) {
+                    const WireResult& r = records[i];
+                    results[shard.first + i] = BacktestResult{r.final_equity, r.total_return, r.max_drawdown,
+                                                              r.trades, r.bars, r.bars_in_market};
+                }
+                shard.done = true;
+                remaining--;
+                durations.push_back(std::chrono::duration<double>(Clock::now() - worker.started).count());
+                worker.completed++;
+            }
+            worker.shard = -1;
+        }
+    }
+
+    // Workers still on a straggler copy are not waited for.
+    for (Worker& worker : workers) {
+        counters.shards_per_worker.push_back(worker.completed);
+        stop(worker, worker.shard >= 0);
+    }
+    if (failed) return {};
+    return results;
+}
+
+#else
+
+std::vector<BacktestResult> runSmaSweepSharded(const PriceView&, const std::vector<SmaParams>&,
+                                               const BacktestConfig&, const ShardConfig&, ShardStats*) {
+    std::cerr << "Error: sharded sweeps need fork, not available on this platform\n";
+    return {};
+}
+
+#endif
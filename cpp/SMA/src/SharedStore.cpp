@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "SharedStore.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::uint64_t store_magic = 0x3145524f54534d53ull; // "SMSTORE1"
+constexpr std::uint32_t store_format = 1;
+constexpr std::size_t columns = 6;
+// A generation held odd this long belongs to a publisher that died mid-update.
+constexpr auto stall_limit = std::chrono::seconds(1);
+
+struct StoreHeader {
+    std::uint64_t magic;      // written last, so a half-made segment is never attached
+    std::uint32_t format;
+    std::uint32_t retired;    // set when the publisher moves to a bigger segment
+    std::uint64_t generation; // odd while the columns are being rewritten
+    std::uint64_t rows;
+    std::uint64_t capacity;
+    std::uint64_t reserved[3];
+};
+static_assert(sizeof(StoreHeader) == 64);
+
+std::size_t segmentBytes(std::size_t capacity) {
+    return sizeof(StoreHeader) + columns * capacity * 8;
+}
+
+// Column c of a segment: time, open, high, low, close, volume.
+template <typename T>
+T* column(unsigned char* base, std::size_t capacity, std::size_t c) {
+    return reinterpret_cast<T*>(base + sizeof(StoreHeader) + c * capacity * 8);
+}
+
+// Header fields are shared between processes, so every access is atomic.
+// Readers only load, which is safe on their read-only mapping.
+std::uint64_t loadWord(const std::uint64_t& word, std::memory_order order = std::memory_order_relaxed) {
+    return std::atomic_ref<std::uint64_t>(const_cast<std::uint64_t&>(word)).load(order);
+}
+
+void storeWord(std::uint64_t& word, std::uint64_t value, std::memory_order order = std::memory_order_relaxed) {
+    std::atomic_ref<std::uint64_t>(word).store(value, order);
+}
+
+bool validSymbol(const std::string& symbol) {
+    if (symbol.empty() || symbol.size() > 200) return false;
+    return std::all_of(symbol.begin(), symbol.end(), [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+               c == '_' || c == '-' || c == '.';
+    });
+}
+
+std::string segmentName(const std::string& symbol) {
+    return "/sma." + symbol;
+}
+
+} // namespace
+
+SeriesPublisher::~SeriesPublisher() {
+    close();
+}
+
+SharedSeries::~SharedSeries() {
+    detach();
+}
+
+#ifndef _WIN32
+
+bool SeriesPublisher::create(std::size_t rows) {
+    // Room to grow, in whole cache lines per column.
+    std::size_t new_capacity = std::max<std::size_t>(4096, rows + rows / 2);
+    new_capacity = (new_capacity + 7) / 8 * 8;
+    std::uint64_t next_generation = published_generation + 2;
+
+    if (base != nullptr) {
+        auto* header = reinterpret_cast<StoreHeader*>(base);
+        std::atomic_ref<std::uint32_t>(header->retired).store(1, std::memory_order_release);
+        munmap(base, mapped_bytes);
+        base = nullptr;
+        shm_unlink(name.c_str());
+    }
+
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        // Left behind by a publisher that did not shut down cleanly.
+        shm_unlink(name.c_str());
+        fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    }
+    if (fd < 0) {
+        std::cerr << "Error: cannot create shared segment: " << name << "\n";
+        return false;
+    }
+
+    std::size_t bytes = segmentBytes(new_capacity);
+    void* mapping = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+        mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd); // the mapping stays valid
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Error: cannot map shared segment: " << name << "\n";
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    base = static_cast<unsigned char*>(mapping);
+    mapped_bytes = bytes;
+    capacity = new_capacity;
+
+    // The magic is left zero until publish() has filled the columns.
+    auto* header = reinterpret_cast<StoreHeader*>(base);
+    header->format = store_format;
+    header->capacity = capacity;
+    storeWord(header->generation, next_generation);
+    published_generation = next_generation;
+    return true;
+}
+
+bool SeriesPublisher::publish(const std::string& symbol, const PriceView& prices) {
+    if (!validSymbol(symbol)) {
+        std::cerr << "Error: bad symbol name: " << symbol << "\n";
+        return false;
+    }
+    if (base != nullptr && segmentName(symbol) != name) close();
+    name = segmentName(symbol);
+    if ((base == nullptr || prices.size() > capacity) && !create(prices.size())) return false;
+
+    auto* header = reinterpret_cast<StoreHeader*>(base);
+    const std::uint64_t odd = published_generation + 1;
+    storeWord(header->generation, odd);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // Readers racing with these copies see an odd or newer generation and retry.
+    const std::size_t bytes = prices.size() * 8;
+    std::memcpy(column<std::int64_t>(base, capacity, 0), prices.time.data(), bytes);
+    std::memcpy(column<double>(base, capacity, 1), prices.open.data(), bytes);
+    std::memcpy(column<double>(base, capacity, 2), prices.high.data(), bytes);
+    std::memcpy(column<double>(base, capacity, 3), prices.low.data(), bytes);
+    std::memcpy(column<double>(base, capacity, 4), prices.close.data(), bytes);
+    std::memcpy(column<std::int64_t>(base, capacity, 5), prices.volume.data(), bytes);
+    storeWord(header->rows, prices.size());
+
+    published_generation = odd + 1;
+    storeWord(header->generation, published_generation, std::memory_order_release);
+    if (loadWord(header->magic) != store_magic) storeWord(header->magic, store_magic, std::memory_order_release);
+    return true;
+}
+
+void SeriesPublisher::close() {
+    if (base != nullptr) {
+        auto* header = reinterpret_cast<StoreHeader*>(base);
+        std::atomic_ref<std::uint32_t>(header->retired).store(1, std::memory_order_release);
+        munmap(base, mapped_bytes);
+        shm_unlink(name.c_str());
+    }
+    base = nullptr;
+    mapped_bytes = 0;
+    capacity = 0;
+}
+
+bool SharedSeries::attach(const std::string& symbol) {
+    detach();
+    if (!validSymbol(symbol)) {
+        std::cerr << "Error: bad symbol name: " << symbol << "\n";
+        return false;
+    }
+
+    const std::string name = segmentName(symbol);
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        std::cerr << "Error: nothing published as " << symbol << "\n";
+        return false;
+    }
+    struct stat info {};
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) >= sizeof(StoreHeader)) {
+        mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Error: cannot map shared segment: " << name << "\n";
+        return false;
+    }
+
+    const auto* header = static_cast<const StoreHeader*>(mapping);
+    const std::size_t bytes = static_cast<std::size_t>(info.st_size);
+    if (loadWord(header->magic, std::memory_order_acquire) != store_magic || header->format != store_format ||
+        segmentBytes(header->capacity) != bytes) {
+        std::cerr << "Error: not a usable price segment: " << name << "\n";
+        munmap(mapping, bytes);
+        return false;
+    }
+
+    base = static_cast<const unsigned char*>(mapping);
+    mapped_bytes = bytes;
+    capacity = header->capacity;
+    return true;
+}
+
+void SharedSeries::detach() {
+    if (base != nullptr) munmap(const_cast<unsigned char*>(base), mapped_bytes);
+    base = nullptr;
+    mapped_bytes = 0;
+    capacity = 0;
+}
+
+#else
+
+bool SeriesPublisher::create(std::size_t) {
+    return false;
+}
+
+bool SeriesPublisher::publish(const std::string& symbol, const PriceView&) {
+    std::cerr << "Error: shared price segments need POSIX shm, not available on this platform: " << symbol << "\n";
+    return false;
+}
+
+void SeriesPublisher::close() {}
+
+bool SharedSeries::attach(const std::string& symbol) {
+    std::cerr << "Error: shared price segments need POSIX shm, not available on this platform: " << symbol << "\n";
+    return false;
+}
+
+void SharedSeries::detach() {}
+
+#endif
+
+PriceView SharedSeries::view(std::uint64_t* generation) const {
+    if (base == nullptr) return PriceView {};
+    const auto* header = reinterpret_cast<const StoreHeader*>(base);
+
+    std::uint64_t before = 0;
+    std::size_t rows = 0;
+    std::chrono::steady_clock::time_point deadline {};
+    while (true) {
+        before = loadWord(header->generation, std::memory_order_acquire);
+        if ((before & 1) == 0) {
+            rows = static_cast<std::size_t>(loadWord(header->rows));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (loadWord(header->generation) == before) break;
+        }
+        // The publisher is rewriting the columns; wait, but not for a dead one.
+        const auto now = std::chrono::steady_clock::now();
+        if (deadline == std::chrono::steady_clock::time_point {}) deadline = now + stall_limit;
+        if (now > deadline) {
+            std::cerr << "Error: shared segment stuck mid-update at generation " << before
+                      << ", its publisher may have died\n";
+            return PriceView {};
+        }
+        std::this_thread::yield();
+    }
+    if (generation != nullptr) *generation = before;
+
+    auto* data = const_cast<unsigned char*>(base);
+    rows = std::min(rows, capacity);
+    return PriceView{{column<const std::int64_t>(data, capacity, 0), rows},
+                     {column<const double>(data, capacity, 1), rows},
+                     {column<const double>(data, capacity, 2), rows},
+                     {column<const double>(data, capacity, 3), rows},
+                     {column<const double>(data, capacity, 4), rows},
+                     {column<const std::int64_t>(data, capacity, 5), rows}};
+}
+
+bool SharedSeries::unchanged(std::uint64_t generation) const {
+    if (base == nullptr) return false;
+    const auto* header = reinterpret_cast<const StoreHeader*>(base);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return loadWord(header->generation) == generation;
+}
+
+bool SharedSeries::retired() const {
+    if (base == nullptr) return true;
+    const auto* header = reinterpret_cast<const StoreHeader*>(base);
+    return std::atomic_ref<std::uint32_t>(const_cast<std::uint32_t&>(header->retired)).load(std::memory_order_acquire) != 0;
+}
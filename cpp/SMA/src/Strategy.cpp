@@ -0,0 +1,27 @@
+#include "Strategy.hpp"
+
+SmaCrossStrategy::SmaCrossStrategy(const SmaParams& params)
+    : config(params), fast_mean(params.fast), slow_mean(params.slow) {}
+
+int SmaCrossStrategy::onBar(double close) {
+    double fast_sma = fast_mean.update(close);
+    double slow_sma = slow_mean.update(close);
+    return smaCrossSignal(fast_sma, slow_sma);
+}
+
+void SmaCrossStrategy::onBars(std::span<const double> closes, std::vector<double>& scratch, int* targets) {
+    const std::size_t n = closes.size();
+    scratch.resize(2 * n);
+    fast_mean.update(closes, scratch.data());
+    slow_mean.update(closes, scratch.data() + n);
+    for (std::size_t i = 0; i < n; i++) targets[i] = smaCrossSignal(scratch[i], scratch[n + i]);
+}
+
+void SmaCrossStrategy::save(std::ostream& out) const {
+    fast_mean.save(out);
+    slow_mean.save(out);
+}
+
+bool SmaCrossStrategy::load(std::istream& in) {
+    return fast_mean.load(in) && slow_mean.load(in);
+}
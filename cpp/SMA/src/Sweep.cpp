@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <type_traits>
+
+#include "AllocProfiler.hpp"
+#include "ResultCache.hpp"
+#include "Sweep.hpp"
+#include "ThreadPool.hpp"
+
+std::vector<SmaParams> makeSmaGrid(int fast_min, int fast_max, int fast_step,
+                                   int slow_min, int slow_max, int slow_step) {
+    std::vector<SmaParams> grid;
+    if (fast_step < 1 || slow_step < 1) return grid;
+    for (int fast = fast_min; fast <= fast_max; fast += fast_step) {
+        for (int slow = slow_min; slow <= slow_max; slow += slow_step) {
+            if (fast < slow) grid.push_back(SmaParams{fast, slow});
+        }
+    }
+    return grid;
+}
+
+namespace {
+
+// Splits [0, count) into chunks and runs them on the pool, or inline without one.
+template <typename Fn>
+void forEachChunk(ThreadPool* pool, std::size_t count, std::size_t chunk, Fn fn) {
+    if (pool == nullptr) {
+        for (std::size_t first = 0; first < count; first += chunk) fn(first, std::min(count, first + chunk));
+        return;
+    }
+    for (std::size_t first = 0; first < count; first += chunk) {
+        std::size_t last = std::min(count, first + chunk);
+        pool->submit([fn, first, last] { fn(first, last); });
+    }
+    pool->wait();
+}
+
+// Advances Lanes strategies over all bars. Mirrors Backtester::onBar
+// operation for operation, so the lane results match the scalar ones exactly.
+template <int Lanes>
+void runBatch(const PriceView& prices, const double* const* fast_cols, const double* const* slow_cols,
+              const BacktestConfig& config, BacktestResult* out, int active) {
+    NoAllocScope no_alloc("batched sweep kernel");
+    const double keep = 1.0 - config.cost_bps * 1e-4;
+
+    alignas(64) double cash[Lanes];
+    alignas(64) double units[Lanes];
+    alignas(64) double holding[Lanes];
+    alignas(64) double equity[Lanes];
+    alignas(64) double peak[Lanes];
+    alignas(64) double drawdown[Lanes];
+    alignas(64) double trades[Lanes];
+    alignas(64) double in_market[Lanes];
+    alignas(64) double fast[Lanes];
+    alignas(64) double slow[Lanes];
+
+    for (int l = 0; l < Lanes; l++) {
+        cash[l] = config.initial_cash;
+        units[l] = 0.0;
+        holding[l] = 0.0;
+        equity[l] = config.initial_cash;
+        peak[l] = config.initial_cash;
+        drawdown[l] = 0.0;
+        trades[l] = 0.0;
+        in_market[l] = 0.0;
+    }
+
+    auto advance = [&](double close, auto blend) {
+        for (int l = 0; l < Lanes; l++) {
+            // Exactly one of enter/leave/stay is 1.0. Blending with them keeps
+            // the loop free of branches; x * 1.0 + y * 0.0 == x for finite values,
+            // so the chosen value comes through bit for bit.
+            const double target = fast[l] > slow[l] ? 1.0 : 0.0;
+            const double enter = target * (1.0 - holding[l]);
+            const double leave = holding[l] * (1.0 - target);
+            const double stay = 1.0 - enter - leave;
+            const double bought = cash[l] * keep / close;
+            const double sold = units[l] * close * keep;
+
+            if constexpr (decltype(blend)::value) {
+                units[l] = enter * bought + stay * units[l];
+                cash[l] = leave * sold + stay * cash[l];
+            } else {
+                units[l] = enter != 0.0 ? bought : (leave != 0.0 ? 0.0 : units[l]);
+                cash[l] = leave != 0.0 ? sold : (enter != 0.0 ? 0.0 : cash[l]);
+            }
+            trades[l] += enter + leave;
+            holding[l] = target;
+
+            equity[l] = cash[l] + units[l] * close;
+            peak[l] = peak[l] < equity[l] ? equity[l] : peak[l];
+            const double dd = (peak[l] - equity[l]) / peak[l];
+            drawdown[l] = drawdown[l] < dd ? dd : drawdown[l];
+            in_market[l] += holding[l];
+        }
+    };
+
+    // A close of 0 (or not finite) can make bought or sold inf, and weighting
+    // an unused inf by 0.0 gives NaN. From such a bar on, the values may stay
+    // inf, so the rest of the run picks them with selects, which the compiler
+    // vectorizes less well but which match the scalar backtester there too.
+    bool finite = true;
+    const std::size_t bars = prices.size();
+    for (std::size_t t = 0; t < bars; t++) {
+        const double close = prices.close[t];
+        for (int l = 0; l < Lanes; l++) {
+            fast[l] = fast_cols[l][t];
+            slow[l] = slow_cols[l][t];
+        }
+        finite = finite && close != 0.0 && std::isfinite(close);
+        if (finite) {
+            advance(close, std::true_type {});
+        } else {
+            advance(close, std::false_type {});
+        }
+    }
+
+    for (int l = 0; l < active; l++) {
+        out[l].final_equity = equity[l];
+        out[l].total_return = equity[l] / config.initial_cash - 1.0;
+        out[l].max_drawdown = drawdown[l];
+        out[l].trades = static_cast<int>(trades[l]);
+        out[l].bars = static_cast<int>(bars);
+        out[l].bars_in_market = static_cast<int>(in_market[l]);
+    }
+}
+
+// forEachChunk with chunk k aimed at NUMA node k % nodes.
+template <typename Fn>
+void forEachChunkOnNodes(ThreadPool* pool, std::size_t count, std::size_t chunk, std::size_t nodes, Fn fn) {
+    if (pool == nullptr || nodes < 2) {
+        forEachChunk(pool, count, chunk, [&fn](std::size_t first, std::size_t last) { fn(first, last, 0); });
+        return;
+    }
+    for (std::size_t first = 0, k = 0; first < count; first += chunk, k++) {
+        std::size_t last = std::min(count, first + chunk);
+        std::size_t node = k % nodes;
+        pool->submit([fn, first, last, node] { fn(first, last, node); }, node);
+    }
+    pool->wait();
+}
+
+// prices[n] and sma[n] are the copies on node n (one entry when not replicated).
+// One pair on the scalar backtester, signals read from the cached columns:
+// the baseline the lanes are measured against, with the SMA work shared the same way.
+void runColumns(const PriceView& prices, const double* fast, const double* slow, const BacktestConfig& config,
+                BacktestResult* out) {
+    Backtester backtester(config);
+    for (std::size_t t = 0; t < prices.size(); t++) backtester.onBar(prices.close[t], smaCrossSignal(fast[t], slow[t]));
+    *out = backtester.result();
+}
+
+template <int Lanes>
+void runBatches(const std::vector<PriceView>& node_prices, const std::vector<SmaColumnCache*>& node_sma,
+                const std::vector<SmaParams>& pairs, const BacktestConfig& config,
+                std::vector<BacktestResult>& results, ThreadPool* pool) {
+    const std::size_t batches = (pairs.size() + Lanes - 1) / Lanes;
+    const std::size_t per_task = pool == nullptr ? batches : std::max<std::size_t>(1, batches / (pool->size() * 4));
+
+    forEachChunkOnNodes(pool, batches, per_task, node_sma.size(), [&](std::size_t first, std::size_t last, std::size_t node) {
+        AllocStage stage("sweep");
+        const PriceView& prices = node_prices[node];
+        SmaColumnCache& sma = *node_sma[node];
+        for (std::size_t b = first; b < last; b++) {
+            const double* fast_cols[Lanes];
+            const double* slow_cols[Lanes];
+            const std::size_t base = b * Lanes;
+            const int active = static_cast<int>(std::min<std::size_t>(Lanes, pairs.size() - base));
+            for (int l = 0; l < Lanes; l++) {
+                // Spare lanes in the last batch repeat the final pair and are discarded.
+                const SmaParams& p = pairs[base + std::min(l, active - 1)];
+                fast_cols[l] = sma.column(p.fast).data();
+                slow_cols[l] = sma.column(p.slow).data();
+            }
+            if constexpr (Lanes == 1) {
+                runColumns(prices, fast_cols[0], slow_cols[0], config, &results[base]);
+            } else {
+                runBatch<Lanes>(prices, fast_cols, slow_cols, config, &results[base], active);
+            }
+        }
+    });
+}
+
+} // namespace
+
+void SmaColumnCache::prepare(const std::vector<SmaParams>& pairs, ThreadPool* pool) {
+    std::vector<int> missing;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uses++;
+        for (const SmaParams& p : pairs) {
+            for (int window : {p.fast, p.slow}) {
+                auto found = columns.find(window);
+                if (found == columns.end()) {
+                    missing.push_back(window);
+                } else {
+                    found->second.used = uses;
+                }
+            }
+        }
+    }
+    std::sort(missing.begin(), missing.end());
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+    if (missing.empty()) return;
+
+    // Computed outside the lock; if another thread got there first its column is kept.
+    std::vector<std::vector<double>> fresh(missing.size());
+    auto compute = [&](std::size_t first, std::size_t last) {
+        AllocStage stage("sma columns");
+        for (std::size_t i = first; i < last; i++) fresh[i] = rollingMean(prices.close, missing[i]);
+    };
+    forEachChunk(pool, missing.size(), 1, compute);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::size_t i = 0; i < missing.size(); i++) columns.emplace(missing[i], Column{std::move(fresh[i]), uses});
+}
+
+const std::vector<double>& SmaColumnCache::column(int window) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = columns.find(window);
+    if (found == columns.end()) found = columns.emplace(window, Column{rollingMean(prices.close, window), 0}).first;
+    found->second.used = ++uses;
+    return found->second.values;
+}
+
+void SmaColumnCache::trim(std::size_t max_bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t total = 0;
+    std::vector<std::pair<std::uint64_t, int>> by_use;
+    for (const auto& [window, column] : columns) {
+        total += column.values.size() * sizeof(double);
+        by_use.emplace_back(column.used, window);
+    }
+    std::sort(by_use.begin(), by_use.end());
+    for (std::size_t i = 0; i < by_use.size() && total > max_bytes; i++) {
+        auto found = columns.find(by_use[i].second);
+        total -= found->second.values.size() * sizeof(double);
+        columns.erase(found);
+    }
+}
+
+std::size_t SmaColumnCache::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return columns.size();
+}
+
+std::size_t SmaColumnCache::bytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t total = 0;
+    for (const auto& [window, column] : columns) total += column.values.size() * sizeof(double);
+    return total;
+}
+
+BacktestResult runFilteredSmaBacktest(const PriceView& prices, const FilteredSmaParams& params,
+                                      SmaColumnCache& columns, const BacktestConfig& config) {
+    const std::vector<double>& fast = columns.column(params.fast);
+    const std::vector<double>& slow = columns.column(params.slow);
+    const std::vector<double>* filter = params.filter > 0 ? &columns.column(params.filter) : nullptr;
+
+    Backtester backtester(config);
+    bool stopped = false; // stopped out; waits for the crossover to reset
+    double high = 0.0;
+    for (std::size_t i = 0; i < prices.size(); i++) {
+        const double close = prices.close[i];
+        int target = smaCrossSignal(fast[i], slow[i]);
+        if (target == 0) stopped = false;
+        if (filter != nullptr && !(close > (*filter)[i])) target = 0;
+        if (target == 1 && backtester.position() == 1) {
+            high = std::max(high, close);
+            if (params.stop > 0.0 && close < high * (1.0 - params.stop)) stopped = true;
+        } else {
+            high = close;
+        }
+        backtester.onBar(close, stopped ? 0 : target);
+    }
+    return backtester.result();
+}
+
+std::vector<BacktestResult> runSmaSweep(const PriceView& prices, const std::vector<SmaParams>& pairs,
+                                        const BacktestConfig& config, ThreadPool* pool) {
+    std::vector<BacktestResult> results(pairs.size());
+    const std::size_t per_task = pool == nullptr ? pairs.size() : std::max<std::size_t>(1, pairs.size() / (pool->size() * 4));
+    forEachChunk(pool, pairs.size(), per_task, [&](std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; i++) results[i] = runSmaBacktest(prices, pairs[i], config);
+    });
+    return results;
+}
+
+namespace {
+
+std::vector<BacktestResult> runLanes(const std::vector<PriceView>& node_prices, const std::vector<SmaColumnCache*>& node_sma,
+                                     const std::vector<SmaParams>& pairs, const BacktestConfig& config,
+                                     int lanes, ThreadPool* pool) {
+    std::vector<BacktestResult> results(pairs.size());
+    if (lanes >= 16) {
+        runBatches<16>(node_prices, node_sma, pairs, config, results, pool);
+    } else if (lanes >= 8) {
+        runBatches<8>(node_prices, node_sma, pairs, config, results, pool);
+    } else if (lanes >= 4) {
+        runBatches<4>(node_prices, node_sma, pairs, config, results, pool);
+    } else {
+        runBatches<1>(node_prices, node_sma, pairs, config, results, pool);
+    }
+    return results;
+}
+
+} // namespace
+
+std::vector<BacktestResult> runSmaSweepBatched(const PriceView& prices, const std::vector<SmaParams>& pairs,
+                                               const BacktestConfig& config, int lanes, ThreadPool* pool) {
+    if (pool == nullptr || pool->nodeCount() < 2 || pairs.empty()) {
+        SmaColumnCache columns(prices);
+        return runSmaSweepBatched(prices, pairs, columns, config, lanes, pool);
+    }
+
+    // One copy of close and of the SMA columns per NUMA node, built by a
+    // worker on that node so first touch places the pages there. Batches then
+    // run on the node whose copy they read, and the columns never cross sockets.
+    const std::size_t nodes = pool->nodeCount();
+    std::vector<std::vector<double>> closes(nodes);
+    std::vector<PriceView> node_prices(nodes, prices);
+    std::vector<std::unique_ptr<SmaColumnCache>> replicas(nodes);
+    pool->onEachNode([&](std::size_t node) {
+        closes[node].assign(prices.close.begin(), prices.close.end());
+        node_prices[node].close = closes[node];
+        replicas[node] = std::make_unique<SmaColumnCache>(node_prices[node]);
+        replicas[node]->prepare(pairs);
+    });
+
+    std::vector<SmaColumnCache*> node_sma;
+    for (auto& replica : replicas) node_sma.push_back(replica.get());
+    return runLanes(node_prices, node_sma, pairs, config, lanes, pool);
+}
+
+std::vector<BacktestResult> runSmaSweepBatched(const PriceView& prices, const std::vector<SmaParams>& pairs,
+                                               SmaColumnCache& columns, const BacktestConfig& config,
+                                               int lanes, ThreadPool* pool) {
+    if (pairs.empty()) return {};
+
+    // One column per distinct window, shared by every pair that uses it.
+    columns.prepare(pairs, pool);
+    return runLanes({prices}, {&columns}, pairs, config, lanes, pool);
+}
+
+std::vector<BacktestResult> runSmaSweepCached(const PriceView& prices, const std::vector<SmaParams>& pairs,
+                                              ResultCache& cache, std::uint64_t dataset,
+                                              const BacktestConfig& config, int lanes,
+                                              ThreadPool* pool, std::size_t* computed) {
+    std::vector<BacktestResult> results(pairs.size());
+    std::vector<CacheKey> keys(pairs.size());
+    std::vector<SmaParams> missing;
+    std::vector<std::size_t> missing_index;
+
+    for (std::size_t i = 0; i < pairs.size(); i++) {
+        const double params[] = {static_cast<double>(pairs[i].fast), static_cast<double>(pairs[i].slow),
+                                 config.initial_cash, config.cost_bps};
+        keys[i] = makeCacheKey(dataset, "sma_cross", params);
+        if (!cache.lookup(keys[i], results[i])) {
+            missing.push_back(pairs[i]);
+            missing_index.push_back(i);
+        }
+    }
+
+    std::vector<BacktestResult> fresh = runSmaSweepBatched(prices, missing, config, lanes, pool);
+    for (std::size_t m = 0; m < missing.size(); m++) {
+        results[missing_index[m]] = fresh[m];
+        cache.store(keys[missing_index[m]], fresh[m]);
+    }
+    if (computed != nullptr) *computed = missing.size();
+    return results;
+}
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "ThreadPool.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// The pool and worker index of the calling thread, if it is a pool worker.
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local std::size_t current_worker = 0;
+
+// "0-3,8,10-11" -> {0,1,2,3,8,10,11}
+std::vector<int> parseCpuList(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream list(text);
+    std::string range;
+    while (std::getline(list, range, ',')) {
+        int first = -1;
+        int last = -1;
+        char dash = 0;
+        std::stringstream parts(range);
+        if (!(parts >> first)) continue;
+        last = (parts >> dash >> last) ? last : first;
+        for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+void pinCurrentThread(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu; // no pinning on this platform
+#endif
+}
+
+} // namespace
+
+CpuTopology CpuTopology::detect() {
+    CpuTopology topology;
+    std::vector<int> allowed;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) allowed.push_back(cpu);
+        }
+    }
+
+    // node0, node1, ... (numbering can have holes)
+    std::vector<std::pair<int, std::vector<int>>> found;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        const std::string name = entry.path().filename().string();
+        if (name.size() < 5 || name.compare(0, 4, "node") != 0 ||
+            !std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+        std::ifstream file(entry.path() / "cpulist");
+        std::string text;
+        std::getline(file, text);
+        std::vector<int> cpus;
+        for (int cpu : parseCpuList(text)) {
+            if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) cpus.push_back(cpu);
+        }
+        if (!cpus.empty()) found.emplace_back(std::stoi(name.substr(4)), std::move(cpus));
+    }
+    std::sort(found.begin(), found.end());
+    for (auto& [node, cpus] : found) topology.nodes.push_back(std::move(cpus));
+#endif
+
+    if (topology.nodes.empty()) {
+        if (allowed.empty()) {
+            unsigned count = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned cpu = 0; cpu < count; cpu++) allowed.push_back(static_cast<int>(cpu));
+        }
+        topology.nodes.push_back(allowed);
+    }
+    return topology;
+}
+
+std::size_t CpuTopology::cpuCount() const {
+    std::size_t count = 0;
+    for (const std::vector<int>& cpus : nodes) count += cpus.size();
+    return count;
+}
+
+ThreadPool::ThreadPool(std::size_t threads, PoolPinning pinning, const CpuTopology* topology) {
+    const CpuTopology detected = topology != nullptr ? CpuTopology {} : CpuTopology::detect();
+    const CpuTopology& layout = topology != nullptr ? *topology : detected;
+    const std::size_t nodes = std::max<std::size_t>(1, layout.nodes.size());
+
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    node_workers.resize(nodes);
+    node_queued.assign(nodes, 0);
+    node_wake.resize(nodes);
+    workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; i++) {
+        // Spread workers over the nodes; within a node, one CPU each.
+        auto worker = std::make_unique<Worker>();
+        worker->node = i % nodes;
+        if (pinning == PoolPinning::Cores && !layout.nodes.empty() && !layout.nodes[worker->node].empty()) {
+            const std::vector<int>& cpus = layout.nodes[worker->node];
+            worker->cpu = cpus[(i / nodes) % cpus.size()];
+        }
+        node_workers[worker->node].push_back(i);
+        workers.push_back(std::move(worker));
+    }
+
+    stats_since = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < threads; i++) {
+        workers[i]->thread = std::thread([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    for (std::condition_variable& wake : node_wake) wake.notify_all();
+    for (auto& worker : workers) worker->thread.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    std::size_t worker = current_pool == this ? current_worker
+                                              : next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    push(worker, Task{std::move(task), true});
+}
+
+void ThreadPool::submit(std::function<void()> task, std::size_t node) {
+    const std::vector<std::size_t>& candidates = node_workers[node % node_workers.size()];
+    if (candidates.empty()) {
+        submit(std::move(task));
+        return;
+    }
+    std::size_t worker = candidates[next_worker.fetch_add(1, std::memory_order_relaxed) % candidates.size()];
+    push(worker, Task{std::move(task), true});
+}
+
+void ThreadPool::onEachNode(const std::function<void(std::size_t node)>& fn) {
+    wait(); // so the workers these are pinned to pick them up straight away
+    for (std::size_t node = 0; node < node_workers.size(); node++) {
+        if (node_workers[node].empty()) continue;
+        push(node_workers[node].front(), Task{[&fn, node] { fn(node); }, false});
+    }
+    wait();
+}
+
+void ThreadPool::push(std::size_t index, Task task) {
+    Worker& worker = *workers[index];
+    const bool stealable = task.stealable;
+    bool backlog = false;
+    {
+        // Counted before the task is visible, so a worker can never finish
+        // it before it is counted.
+        std::lock_guard<std::mutex> lock(mutex);
+        queued++;
+        unfinished++;
+        backlog = ++node_queued[worker.node] > node_workers[worker.node].size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    if (stealable) {
+        node_wake[worker.node].notify_one();
+    } else {
+        node_wake[worker.node].notify_all(); // only its owner may run it, so make sure the owner wakes
+    }
+    if (backlog) {
+        // More than this node can start right away: let idle nodes help.
+        for (std::size_t node = 0; node < node_wake.size(); node++) {
+            if (node != worker.node) node_wake[node].notify_one();
+        }
+    }
+}
+
+bool ThreadPool::take(std::size_t self, bool remote, Task& task) {
+    const std::size_t home = workers[self]->node;
+    auto tryQueue = [&](std::size_t index, bool steal) {
+        Worker& victim = *workers[index];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty()) return false;
+        if (!steal) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        } else {
+            if (!victim.tasks.back().stealable) return false;
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+        }
+        return true;
+    };
+
+    std::size_t from = self;
+    bool found = tryQueue(self, false);
+    for (std::size_t i = 0; !found && i < node_workers[home].size(); i++) {
+        from = node_workers[home][i];
+        found = from != self && tryQueue(from, true);
+    }
+    for (std::size_t node = 0; remote && !found && node < node_workers.size(); node++) {
+        if (node == home) continue;
+        for (std::size_t i = 0; !found && i < node_workers[node].size(); i++) {
+            from = node_workers[node][i];
+            found = tryQueue(from, true);
+        }
+    }
+    if (!found) return false;
+
+    Worker& me = *workers[self];
+    if (from != self) {
+        if (workers[from]->node == home) {
+            me.stolen_local.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            me.stolen_remote.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    queued--;
+    node_queued[workers[from]->node]--;
+    return true;
+}
+
+bool ThreadPool::remoteBacklog(std::size_t node) const {
+    for (std::size_t other = 0; other < node_queued.size(); other++) {
+        if (other != node && node_queued[other] > node_workers[other].size()) return true;
+    }
+    return false;
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&] { return unfinished == 0; });
+}
+
+void ThreadPool::workerLoop(std::size_t self) {
+    Worker& me = *workers[self];
+    current_pool = this;
+    current_worker = self;
+    if (me.cpu >= 0) pinCurrentThread(me.cpu);
+
+    Task task;
+    while (true) {
+        if (!take(self, false, task)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            node_wake[me.node].wait(lock, [&] {
+                return stopping || node_queued[me.node] > 0 || remoteBacklog(me.node);
+            });
+            if (stopping && queued == 0) return;
+            const bool remote = node_queued[me.node] == 0;
+            lock.unlock();
+            // Another node only when this one has nothing queued.
+            if (!remote || !take(self, true, task)) {
+                std::this_thread::yield(); // what is queued here is not ours to take yet
+                continue;
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        task.run();
+        auto busy = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        task.run = nullptr;
+        me.tasks_run.fetch_add(1, std::memory_order_relaxed);
+        me.busy_ns.fetch_add(static_cast<std::uint64_t>(busy.count()), std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--unfinished == 0) idle.notify_all();
+    }
+}
+
+std::vector<WorkerStats> ThreadPool::stats() const {
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - stats_since).count();
+    std::vector<WorkerStats> out;
+    for (const auto& worker : workers) {
+        WorkerStats s;
+        s.node = static_cast<int>(worker->node);
+        s.cpu = worker->cpu;
+        s.tasks = worker->tasks_run.load(std::memory_order_relaxed);
+        s.stolen_local = worker->stolen_local.load(std::memory_order_relaxed);
+        s.stolen_remote = worker->stolen_remote.load(std::memory_order_relaxed);
+        s.busy_seconds = static_cast<double>(worker->busy_ns.load(std::memory_order_relaxed)) * 1e-9;
+        s.utilization = elapsed > 0.0 ? s.busy_seconds / elapsed : 0.0;
+        out.push_back(s);
+    }
+    return out;
+}
+
+void ThreadPool::resetStats() {
+    for (auto& worker : workers) {
+        worker->tasks_run = 0;
+        worker->stolen_local = 0;
+        worker->stolen_remote = 0;
+        worker->busy_ns = 0;
+    }
+    stats_since = std::chrono::steady_clock::now();
+}
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <ostream>
+
+#include "Validation.hpp"
+
+namespace {
+
+const char* kind_names[anomaly_kinds] = {"partial session", "gap", "OHLC inconsistent", "outlier", "out of order"};
+
+// 0 = Sunday ... 6 = Saturday. 1970-01-01 was a Thursday.
+int weekday(std::int64_t time) {
+    std::int64_t days = time >= 0 ? time / 86400 : (time - 86399) / 86400;
+    int day = static_cast<int>((days + 4) % 7);
+    return day < 0 ? day + 7 : day;
+}
+
+bool onDays(std::uint8_t days, std::int64_t time) {
+    return (days >> weekday(time)) & 1;
+}
+
+} // namespace
+
+void AnomalyReport::print(std::ostream& out) const {
+    out << "Rows in: " << rows_in << "  out: " << rows_out << "  dropped: " << dropped
+        << "  merged: " << merged << "  filled: " << filled << "  repaired: " << repaired << "\n";
+    for (std::size_t k = 0; k < anomaly_kinds; k++) {
+        out << "  " << kind_names[k] << ": " << counts[k] << "\n";
+    }
+    for (const Anomaly& anomaly : samples) {
+        out << "  row " << anomaly.row << "  " << formatTimestamp(anomaly.time) << "  "
+            << kind_names[static_cast<int>(anomaly.kind)] << "\n";
+    }
+}
+
+BarValidator::BarValidator(const ValidationPolicy& policy, AnomalyReport& report)
+    : policy(policy), report(report) {
+    const std::size_t lookback = policy.lookback > 1 ? static_cast<std::size_t>(policy.lookback) : 2;
+    check_volumes = policy.partial_volume_ratio > 0.0;
+    check_outliers = policy.outlier_sigma > 0.0;
+    check_gaps = policy.bar_seconds > 0;
+    window = static_cast<double>(lookback);
+    sigma_squared = policy.outlier_sigma * policy.outlier_sigma;
+    volumes.values.assign(lookback, 0.0);
+    changes.values.assign(lookback, 0.0);
+}
+
+void BarValidator::flag(AnomalyKind kind, std::int64_t time) {
+    report.counts[static_cast<int>(kind)]++;
+    if (report.samples.size() < report.max_samples) {
+        report.samples.push_back(Anomaly{kind, time, report.rows_in - 1});
+    }
+}
+
+bool BarValidator::add(PriceBar& bar, PriceSeries& out) {
+    report.rows_in++;
+
+    if (has_previous && bar.time <= previous_time) {
+        flag(AnomalyKind::OutOfOrder, bar.time);
+        report.dropped++;
+        return false;
+    }
+
+    if (bar.high < std::max(bar.open, bar.close) || bar.low > std::min(bar.open, bar.close)) {
+        flag(AnomalyKind::OhlcInconsistent, bar.time);
+        if (policy.repair_ohlc) {
+            bar.high = std::max(bar.high, std::max(bar.open, bar.close));
+            bar.low = std::min(bar.low, std::min(bar.open, bar.close));
+            report.repaired++;
+        }
+    }
+
+    // Compare against the statistics of the bars before this one. Until a
+    // window is full there is nothing to compare against, only fill it.
+    bool partial = !onDays(policy.session_days, bar.time);
+    if (check_volumes && !partial && !onDays(policy.short_days, bar.time)) {
+        const double volume = static_cast<double>(bar.volume);
+        if (!volumes.full()) {
+            volumes.fill(volume);
+        } else if (volume * window < policy.partial_volume_ratio * volumes.sum) {
+            partial = true;
+        } else {
+            volumes.slide(volume);
+        }
+    }
+
+    if (check_outliers && has_previous) {
+        // Close-to-close change, tested as (n*x - sum)^2 > sigma^2 * (n*sum_sq - sum^2),
+        // i.e. |x - mean| > sigma * stddev with the divisions multiplied out.
+        const double change = bar.close - previous_close;
+        if (!changes.full()) {
+            changes.fill(change);
+        } else {
+            const double deviation = window * change - changes.sum;
+            const double spread = window * changes.sum_squares - changes.sum * changes.sum;
+            if (spread > 0.0 && deviation * deviation > sigma_squared * spread) flag(AnomalyKind::Outlier, bar.time);
+            changes.slide(change);
+        }
+    }
+
+    // Session days missing since the last bar, checked before a partial bar can be
+    // dropped or held back. A merged bar keeps the later time, so fills stay in order.
+    if (check_gaps && has_previous && bar.time - previous_time > policy.bar_seconds) {
+        for (std::int64_t t = previous_time + policy.bar_seconds; t < bar.time; t += policy.bar_seconds) {
+            if (!onDays(policy.session_days, t)) continue;
+            flag(AnomalyKind::Gap, t);
+            if (policy.fill_gaps && has_emitted) {
+                out.push(t, last_close, last_close, last_close, last_close, 0);
+                report.filled++;
+                report.rows_out++;
+            }
+        }
+    }
+
+    if (partial) {
+        flag(AnomalyKind::PartialSession, bar.time);
+        if (policy.partial_sessions == PartialSessionPolicy::Drop) {
+            report.dropped++;
+            previous_time = bar.time;
+            previous_close = bar.close;
+            has_previous = true;
+            return false;
+        }
+        if (policy.partial_sessions == PartialSessionPolicy::MergeIntoNext) {
+            if (has_pending) {
+                // Two partials in a row: fold the older one in first.
+                bar.open = pending.open;
+                bar.high = std::max(bar.high, pending.high);
+                bar.low = std::min(bar.low, pending.low);
+                bar.volume += pending.volume;
+                report.merged++;
+            }
+            pending = bar;
+            has_pending = true;
+            previous_time = bar.time;
+            previous_close = bar.close;
+            has_previous = true;
+            return false;
+        }
+    }
+
+    if (has_pending) {
+        bar.open = pending.open;
+        bar.high = std::max(bar.high, pending.high);
+        bar.low = std::min(bar.low, pending.low);
+        bar.volume += pending.volume;
+        has_pending = false;
+        report.merged++;
+    }
+
+    report.rows_out++;
+    last_close = bar.close;
+    has_emitted = true;
+    previous_time = bar.time;
+    previous_close = bar.close;
+    has_previous = true;
+    return true;
+}
+
+void BarValidator::finish(PriceSeries& out) {
+    if (has_pending) {
+        out.push(pending.time, pending.open, pending.high, pending.low, pending.close, pending.volume);
+        report.rows_out++;
+        has_pending = false;
+    }
+}
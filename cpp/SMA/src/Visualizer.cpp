@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "Visualizer.hpp"
+
+namespace {
+
+constexpr int cell_pixels = 8;
+constexpr int margin = 60;
+
+// Distinct values of a parameter column, ascending. A grid has tens to
+// hundreds of them, so a binary search beats hashing every row.
+struct Axis {
+    std::vector<double> values;
+
+    std::size_t add(double v) {
+        auto it = std::lower_bound(values.begin(), values.end(), v);
+        if (it == values.end() || *it != v) it = values.insert(it, v);
+        return static_cast<std::size_t>(it - values.begin());
+    }
+    std::size_t position(double v) const {
+        return static_cast<std::size_t>(std::lower_bound(values.begin(), values.end(), v) - values.begin());
+    }
+};
+
+std::string colour(double value, double low, double high) {
+    double red = 1.0;
+    double green = 1.0;
+    double blue = 1.0;
+    if (low < 0.0 && high > 0.0) {
+        // White at zero, darker the further out on either side.
+        const double t = value < 0.0 ? value / low : value / high;
+        if (value < 0.0) {
+            green = blue = 1.0 - 0.8 * t;
+        } else {
+            red = green = 1.0 - 0.8 * t;
+        }
+    } else {
+        const double t = high > low ? (value - low) / (high - low) : 0.5;
+        red = 0.95 - 0.85 * t;
+        green = 0.95 - 0.6 * t;
+        blue = 1.0 - 0.3 * t;
+    }
+    auto byte = [](double v) { return static_cast<int>(std::lround(std::clamp(v, 0.0, 1.0) * 255.0)); };
+    return "rgb(" + std::to_string(byte(red)) + "," + std::to_string(byte(green)) + "," + std::to_string(byte(blue)) +
+           ")";
+}
+
+// Title and column names come from the caller; escape them as element text.
+std::string escaped(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+        case '&': out += "&amp;"; break;
+        case '<': out += "&lt;"; break;
+        case '>': out += "&gt;"; break;
+        default: out += c;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+bool writeHeatmap(const ResultTable& table, const HeatmapSpec& spec, const std::string& filepath,
+                  const std::vector<std::uint32_t>* rows) {
+    const double* xs = table.column(spec.x).data();
+    const double* ys = table.column(spec.y).data();
+    const double* values = table.column(spec.value).data();
+    const std::size_t count = rows == nullptr ? table.rows() : rows->size();
+    auto row = [rows](std::size_t i) { return rows == nullptr ? i : (*rows)[i]; };
+
+    // Parameters come in runs of repeated values, so only look up on a change.
+    Axis x_axis;
+    Axis y_axis;
+    double last_x = std::nan("");
+    double last_y = std::nan("");
+    for (std::size_t i = 0; i < count; i++) {
+        const std::size_t r = row(i);
+        if (std::isnan(xs[r]) || std::isnan(ys[r])) continue;
+        if (xs[r] != last_x) x_axis.add(last_x = xs[r]);
+        if (ys[r] != last_y) y_axis.add(last_y = ys[r]);
+    }
+    const std::size_t width = x_axis.values.size();
+    const std::size_t height = y_axis.values.size();
+    if (width == 0 || height == 0) {
+        std::cerr << "Error: nothing to draw in the heatmap\n";
+        return false;
+    }
+
+    std::vector<double> sums(width * height, 0.0);
+    std::vector<std::uint32_t> counts(width * height, 0);
+    std::size_t cx = 0;
+    std::size_t cy = 0;
+    last_x = last_y = std::nan("");
+    for (std::size_t i = 0; i < count; i++) {
+        const std::size_t r = row(i);
+        if (std::isnan(xs[r]) || std::isnan(ys[r]) || std::isnan(values[r])) continue;
+        if (xs[r] != last_x) cx = x_axis.position(last_x = xs[r]);
+        if (ys[r] != last_y) cy = y_axis.position(last_y = ys[r]);
+        sums[cy * width + cx] += values[r];
+        counts[cy * width + cx]++;
+    }
+    double low = std::numeric_limits<double>::infinity();
+    double high = -low;
+    for (std::size_t c = 0; c < sums.size(); c++) {
+        if (counts[c] == 0) continue;
+        sums[c] /= counts[c];
+        low = std::min(low, sums[c]);
+        high = std::max(high, sums[c]);
+    }
+
+    std::ofstream out(filepath, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error: cannot write heatmap: " << filepath << "\n";
+        return false;
+    }
+    const int plot_w = static_cast<int>(width) * cell_pixels;
+    const int plot_h = static_cast<int>(height) * cell_pixels;
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << plot_w + 2 * margin << "\" height=\""
+        << plot_h + 2 * margin << "\" font-family=\"sans-serif\" font-size=\"10\">\n";
+    out << "<text x=\"" << margin << "\" y=\"20\" font-size=\"14\">" << escaped(spec.title) << "  ("
+        << escaped(table.name(spec.value)) << " " << low << " .. " << high << ")</text>\n";
+    // y grows upwards, as on a chart.
+    for (std::size_t j = 0; j < height; j++) {
+        const int top = margin + plot_h - static_cast<int>(j + 1) * cell_pixels;
+        for (std::size_t i = 0; i < width; i++) {
+            const std::size_t c = j * width + i;
+            out << "<rect x=\"" << margin + static_cast<int>(i) * cell_pixels << "\" y=\"" << top << "\" width=\""
+                << cell_pixels << "\" height=\"" << cell_pixels << "\" fill=\""
+                << (counts[c] == 0 ? std::string("rgb(200,200,200)") : colour(sums[c], low, high)) << "\"><title>"
+                << x_axis.values[i] << ", " << y_axis.values[j] << ": ";
+            if (counts[c] == 0) {
+                out << "no rows";
+            } else {
+                out << sums[c];
+            }
+            out << "</title></rect>\n";
+        }
+    }
+    // About ten tick labels per axis.
+    const std::size_t x_every = std::max<std::size_t>(1, width / 10);
+    const std::size_t y_every = std::max<std::size_t>(1, height / 10);
+    for (std::size_t i = 0; i < width; i += x_every) {
+        out << "<text x=\"" << margin + static_cast<int>(i) * cell_pixels << "\" y=\"" << margin + plot_h + 14
+            << "\">" << x_axis.values[i] << "</text>\n";
+    }
+    for (std::size_t j = 0; j < height; j += y_every) {
+        out << "<text x=\"" << margin - 6 << "\" y=\"" << margin + plot_h - static_cast<int>(j) * cell_pixels
+            << "\" text-anchor=\"end\">" << y_axis.values[j] << "</text>\n";
+    }
+    out << "<text x=\"" << margin + plot_w / 2 << "\" y=\"" << margin + plot_h + 34 << "\" text-anchor=\"middle\">"
+        << escaped(table.name(spec.x)) << "</text>\n";
+    out << "<text x=\"14\" y=\"" << margin + plot_h / 2 << "\" transform=\"rotate(-90 14 " << margin + plot_h / 2
+        << ")\" text-anchor=\"middle\">" << escaped(table.name(spec.y))
+        << "</text>\n";
+    out << "</svg>\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,2182 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <deque>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <atomic>
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <set>
+#include <thread>
+
+#include "AllocProfiler.hpp"
+#include "AsOfJoin.hpp"
+#include "Covariance.hpp"
+#include "CrossSection.hpp"
+#include "Excursion.hpp"
+#include "Expression.hpp"
+#include "BoundedQueue.hpp"
+#include "Incremental.hpp"
+#include "Journal.hpp"
+#include "MinuteStore.hpp"
+#include "Normalize.hpp"
+#include "Numerics.hpp"
+#include "Optimizer.hpp"
+#include "Pipeline.hpp"
+#include "ResultCache.hpp"
+#include "ResultTable.hpp"
+#include "RingBuffer.hpp"
+#include "Server.hpp"
+#include "ShardedSweep.hpp"
+#include "SharedStore.hpp"
+#include "Validation.hpp"
+#include "Sweep.hpp"
+#include "ThreadPool.hpp"
+#include "Visualizer.hpp"
+
+namespace {
+
+const char* default_data = "data/data.csv";
+
+void printResult(const SmaParams& params, const BacktestResult& result) {
+    std::cout << "SMA " << params.fast << "/" << params.slow
+              << "  return: " << result.total_return * 100.0 << "%"
+              << "  max drawdown: " << result.max_drawdown * 100.0 << "%"
+              << "  trades: " << result.trades
+              << "  bars: " << result.bars << std::endl;
+}
+
+// Reads "fast slow" pairs from argv[first..]; falls back to 10/50.
+std::vector<SmaParams> readPairs(int argc, char** argv, int first) {
+    std::vector<SmaParams> pairs;
+    for (int i = first; i + 1 < argc; i += 2) {
+        pairs.push_back(SmaParams{std::atoi(argv[i]), std::atoi(argv[i + 1])});
+    }
+    if (pairs.empty()) pairs.push_back(SmaParams{10, 50});
+    return pairs;
+}
+
+// sma run [csv] [fast slow]...
+int runStreaming(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    std::vector<SmaParams> pairs = readPairs(argc, argv, 3);
+
+    PipelineConfig config;
+    config.block_rows = 1024;
+    std::vector<BacktestResult> results = runStreamingBacktest(path, pairs, config,
+        [&pairs](const PipelineProgress& progress) {
+            std::cout << "[" << pairs[progress.strategy].fast << "/" << pairs[progress.strategy].slow << "] "
+                      << formatTimestamp(progress.last_time) << "  rows: " << progress.rows_done
+                      << "  equity: " << progress.equity << "  position: " << progress.position << std::endl;
+        });
+
+    std::cout << "----------------------------------" << std::endl;
+    for (std::size_t i = 0; i < pairs.size(); i++) printResult(pairs[i], results[i]);
+    return 0;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool sameResult(const BacktestResult& a, const BacktestResult& b) {
+    return a.final_equity == b.final_equity && a.total_return == b.total_return &&
+           a.max_drawdown == b.max_drawdown && a.trades == b.trades && a.bars == b.bars &&
+           a.bars_in_market == b.bars_in_market;
+}
+
+// sma sweep [csv] [lanes] [threads]
+// Runs the SMA grid with the scalar backtester and the batched kernel and compares them.
+int runSweep(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    int lanes = argc > 3 ? std::atoi(argv[3]) : 8;
+    std::size_t threads = argc > 4 ? static_cast<std::size_t>(std::atoi(argv[4])) : 1;
+
+    PriceSeries series = loadSeries(path);
+    std::vector<SmaParams> grid = makeSmaGrid(2, 50, 1, 10, 200, 5);
+    std::cout << "Bars: " << series.size() << "  combinations: " << grid.size() << std::endl;
+
+    ThreadPool pool(threads);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BacktestResult> scalar = runSmaSweep(series.view(), grid, {}, &pool);
+    double scalar_seconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<BacktestResult> batched = runSmaSweepBatched(series.view(), grid, {}, lanes, &pool);
+    double batched_seconds = secondsSince(start);
+
+    // The lanes on their own: scalar and lanes both reading columns computed
+    // beforehand, best of three each.
+    SmaColumnCache columns(series.view());
+    columns.prepare(grid, &pool);
+    double column_seconds = 1e30;
+    double lane_seconds = 1e30;
+    std::vector<BacktestResult> by_column;
+    for (int round = 0; round < 3; round++) {
+        start = std::chrono::steady_clock::now();
+        by_column = runSmaSweepBatched(series.view(), grid, columns, {}, 1, &pool);
+        column_seconds = std::min(column_seconds, secondsSince(start));
+        start = std::chrono::steady_clock::now();
+        runSmaSweepBatched(series.view(), grid, columns, {}, lanes, &pool);
+        lane_seconds = std::min(lane_seconds, secondsSince(start));
+    }
+
+    std::size_t mismatches = 0;
+    std::size_t best = 0;
+    for (std::size_t i = 0; i < grid.size(); i++) {
+        if (!sameResult(scalar[i], batched[i]) || !sameResult(scalar[i], by_column[i])) mismatches++;
+        if (batched[i].total_return > batched[best].total_return) best = i;
+    }
+
+    // A close of 0 makes the entry size inf; lanes that are not entering must not turn it into NaN.
+    PriceSeries zeroed = series;
+    zeroed.close[series.size() / 2] = 0.0;
+    const std::vector<SmaParams> few(grid.begin(), grid.begin() + std::min<std::size_t>(grid.size(), 64));
+    const std::vector<BacktestResult> zero_scalar = runSmaSweep(zeroed.view(), few);
+    const std::vector<BacktestResult> zero_lanes = runSmaSweepBatched(zeroed.view(), few, {}, lanes);
+    auto same = [](double a, double b) { return a == b || (std::isnan(a) && std::isnan(b)); };
+    std::size_t zero_mismatches = 0;
+    for (std::size_t i = 0; i < few.size(); i++) {
+        const BacktestResult& a = zero_scalar[i];
+        const BacktestResult& b = zero_lanes[i];
+        if (!same(a.final_equity, b.final_equity) || !same(a.max_drawdown, b.max_drawdown) ||
+            a.trades != b.trades || a.bars_in_market != b.bars_in_market) {
+            zero_mismatches++;
+        }
+    }
+    mismatches += zero_mismatches;
+
+    std::cout << "Scalar:  " << scalar_seconds * 1000.0 << " ms" << std::endl;
+    std::cout << "Batched: " << batched_seconds * 1000.0 << " ms (" << lanes << " lanes, "
+              << scalar_seconds / batched_seconds << "x)" << std::endl;
+    std::cout << "Columns ready: scalar " << column_seconds * 1000.0 << " ms, " << lanes << " lanes "
+              << lane_seconds * 1000.0 << " ms (" << column_seconds / lane_seconds << "x from the lanes)" << std::endl;
+    std::cout << "Close of 0, mismatches: " << zero_mismatches << std::endl;
+    std::cout << "Mismatches: " << mismatches << std::endl;
+    std::cout << "Best: ";
+    printResult(grid[best], batched[best]);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// sma expr [csv] [rule]...
+// Backtests the first rule. With no rules, times the built-in SMA crossover
+// written as an expression against the hand-written C++.
+int runExpression(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    PriceSeries series = loadSeries(path);
+    PriceView prices = series.view();
+
+    ExprProgram program;
+    std::string error;
+    for (int i = 3; i < argc; i++) {
+        if (program.addRule(argv[i], error) < 0) {
+            std::cerr << "Error in rule " << i - 2 << ": " << error << std::endl;
+            return 1;
+        }
+    }
+
+    if (program.ruleCount() > 0) {
+        std::vector<std::vector<double>> signals = program.evaluate(prices);
+        std::cout << "Rules: " << program.ruleCount() << "  DAG nodes: " << program.nodeCount() << std::endl;
+        BacktestResult result = runSignalBacktest(prices, signals[0], {});
+        std::cout << "Rule 1  return: " << result.total_return * 100.0 << "%"
+                  << "  max drawdown: " << result.max_drawdown * 100.0 << "%"
+                  << "  trades: " << result.trades << std::endl;
+        return 0;
+    }
+
+    program.addRule("sma(close,10) > sma(close,50)", error);
+    const int repeats = 200;
+    std::vector<std::vector<double>> signals;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) signals = program.evaluate(prices);
+    double expr_seconds = secondsSince(start);
+
+    std::vector<double> hand(prices.size());
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        std::vector<double> fast = rollingMean(prices.close, 10);
+        std::vector<double> slow = rollingMean(prices.close, 50);
+        for (std::size_t i = 0; i < prices.size(); i++) hand[i] = smaCrossSignal(fast[i], slow[i]);
+    }
+    double hand_seconds = secondsSince(start);
+
+    bool same = signals[0] == hand;
+    std::cout << "Expression:  " << expr_seconds * 1000.0 / repeats << " ms per pass" << std::endl;
+    std::cout << "Hand-written: " << hand_seconds * 1000.0 / repeats << " ms per pass" << std::endl;
+    std::cout << "Ratio: " << expr_seconds / hand_seconds << "x  signals match: " << (same ? "yes" : "no") << std::endl;
+    return same ? 0 : 1;
+}
+
+// sma cached-sweep [csv] [cache file] [fast_max] [slow_max]
+// Sweeps through the on-disk result cache; run it twice, or with a wider
+// grid, to see only the missing combinations being computed.
+int runCachedSweep(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    std::string cache_path = argc > 3 ? argv[3] : "sweep.cache";
+    int fast_max = argc > 4 ? std::atoi(argv[4]) : 50;
+    int slow_max = argc > 5 ? std::atoi(argv[5]) : 200;
+
+    ResultCache cache;
+    if (!cache.open(cache_path)) return 1;
+
+    PriceSeries series = loadSeries(path);
+    std::uint64_t dataset = fingerprintFile(path);
+    std::vector<SmaParams> grid = makeSmaGrid(2, fast_max, 1, 10, slow_max, 5);
+
+    std::size_t computed = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BacktestResult> results = runSmaSweepCached(series.view(), grid, cache, dataset, {}, 8, nullptr, &computed);
+    double seconds = secondsSince(start);
+
+    std::vector<BacktestResult> reference = runSmaSweepBatched(series.view(), grid);
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < grid.size(); i++) {
+        if (!sameResult(results[i], reference[i])) mismatches++;
+    }
+
+    CacheStats stats = cache.stats();
+    std::cout << "Combinations: " << grid.size() << "  computed: " << computed
+              << "  from cache: " << grid.size() - computed << std::endl;
+    std::cout << "Lookups: " << stats.hits << " hits, " << stats.misses << " misses, "
+              << stats.evictions << " evictions (capacity " << cache.capacity() << ")" << std::endl;
+    std::cout << "Time: " << seconds * 1000.0 << " ms  mismatches: " << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// sma update [csv] [state file] [fast slow]...
+// Incremental run: only the bars appended since the last update are processed.
+int runUpdate(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    std::string state_path = argc > 3 ? argv[3] : "sma.state";
+    std::vector<SmaParams> pairs = readPairs(argc, argv, 4);
+
+    IncrementalStats stats;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BacktestResult> results = runIncrementalBacktest(path, state_path, pairs, {}, stats);
+    double seconds = secondsSince(start);
+    if (results.empty()) return 1;
+
+    if (stats.resumed) {
+        std::cout << "Resumed: " << stats.new_bars << " new bars";
+    } else {
+        std::cout << "Full recompute (" << stats.reason << "): " << stats.new_bars << " bars";
+    }
+    std::cout << ", " << stats.total_bars << " in total, " << seconds * 1000.0 << " ms" << std::endl;
+    for (std::size_t i = 0; i < pairs.size(); i++) printResult(pairs[i], results[i]);
+    return stats.rejected == 0 ? 0 : 1;
+}
+
+// Weekdays as digits, 0 = Sunday: "12345" for an exchange calendar.
+bool parseWeekdays(std::string_view digits, std::uint8_t& days) {
+    days = 0;
+    for (char c : digits) {
+        if (c < '0' || c > '6') return false;
+        days |= static_cast<std::uint8_t>(1u << (c - '0'));
+    }
+    return true;
+}
+
+// sma validate [csv] [keep|drop|merge] [fill] [repair] [days=012345] [short=0] [copies]
+// Loads with validation fused into the parser, prints the anomaly report and
+// what the checks cost against a plain load.
+int runValidate(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    ValidationPolicy policy;
+    int copies = 40;
+    for (int i = 3; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "drop") policy.partial_sessions = PartialSessionPolicy::Drop;
+        else if (option == "merge") policy.partial_sessions = PartialSessionPolicy::MergeIntoNext;
+        else if (option == "fill") policy.fill_gaps = true;
+        else if (option == "repair") policy.repair_ohlc = true;
+        else if ((option.starts_with("days=") && !parseWeekdays(option.substr(5), policy.session_days)) ||
+                 (option.starts_with("short=") && !parseWeekdays(option.substr(6), policy.short_days))) {
+            std::cerr << "Error: bad weekdays: " << option << "\n";
+            return 1;
+        } else if (std::atoi(option.c_str()) > 0) copies = std::atoi(option.c_str());
+    }
+
+    AnomalyReport report;
+    PriceSeries series = loadSeries(path, &policy, &report);
+    report.print(std::cout);
+    std::cout << "Bars after validation: " << series.size() << std::endl;
+    if (series.size() == 0) return 1;
+
+    // One file parses in a millisecond or two, too short to time a few percent
+    // on. Time the file repeated instead, each copy moved on by whole weeks so
+    // weekends, gaps and partial sessions land as in the original.
+    const std::string timing_path = (std::filesystem::temp_directory_path() /
+                                     ("sma.validate." + std::to_string(std::random_device {}()) + ".csv")).string();
+    {
+        std::ifstream in(path);
+        std::ofstream out(timing_path, std::ios::trunc);
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(in, line)) lines.push_back(line);
+        const std::int64_t week = 7 * 86400;
+        const std::int64_t shift = ((series.time.back() - series.time.front()) / week + 1) * week;
+        out << lines.front() << "\n";
+        for (int c = 0; c < copies; c++) {
+            for (std::size_t i = 1; i < lines.size(); i++) {
+                const std::size_t comma = lines[i].find(',');
+                const std::int64_t time = parseTimestamp(std::string_view(lines[i]).substr(0, comma));
+                if (time < 0 || comma == std::string::npos) continue;
+                out << formatTimestamp(time + c * shift) << std::string_view(lines[i]).substr(comma) << "\n";
+            }
+        }
+        if (!out) {
+            std::cerr << "Error: cannot write " << timing_path << "\n";
+            std::filesystem::remove(timing_path);
+            return 1;
+        }
+    }
+
+    // Back-to-back pairs, taking turns at going first, and the median of their
+    // ratios: drift on a busy machine hits both halves of a pair alike and one
+    // slow round moves nothing.
+    const int rounds = 21;
+    std::vector<double> ratios(rounds);
+    double plain_seconds = 1e30;
+    std::size_t rows = 0;
+    for (int r = 0; r < rounds; r++) {
+        double plain = 0.0;
+        double checked = 0.0;
+        for (int side = 0; side < 2; side++) {
+            AnomalyReport scratch;
+            auto start = std::chrono::steady_clock::now();
+            if ((side + r) % 2 == 0) {
+                rows = loadSeries(timing_path).size();
+                plain = secondsSince(start);
+            } else {
+                loadSeries(timing_path, &policy, &scratch);
+                checked = secondsSince(start);
+            }
+        }
+        ratios[r] = checked / plain;
+        plain_seconds = std::min(plain_seconds, plain);
+    }
+    std::filesystem::remove(timing_path);
+    std::sort(ratios.begin(), ratios.end());
+    auto percent = [&](std::size_t r) { return (ratios[r] - 1.0) * 100.0; };
+    const double overhead = ratios[rounds / 2] - 1.0;
+
+    std::cout << "Parse of " << rows << " rows (" << copies << " copies): " << plain_seconds * 1000.0
+              << " ms  validation adds " << overhead * 100.0 << "% (median of " << rounds << " pairs, "
+              << overhead * plain_seconds / static_cast<double>(rows) * 1e9 << " ns/row)" << std::endl;
+    std::cout << "  spread over pairs: quartiles " << percent(rounds / 4) << "% to " << percent(rounds * 3 / 4)
+              << "%, range " << percent(0) << "% to " << percent(rounds - 1) << "%" << std::endl;
+    return 0;
+}
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void requestStop(int) {
+    stop_requested = 1;
+}
+
+// sma publish [symbol csv]...
+// Loader daemon: publishes each file into shared memory and republishes it
+// whenever it changes on disk, until interrupted.
+int runPublish(int argc, char** argv) {
+    struct Source {
+        std::string symbol;
+        std::string path;
+        std::filesystem::file_time_type modified {};
+        std::uintmax_t size {};
+        std::unique_ptr<SeriesPublisher> publisher = std::make_unique<SeriesPublisher>();
+    };
+    std::vector<Source> sources;
+    for (int i = 2; i + 1 < argc; i += 2) sources.push_back(Source{argv[i], argv[i + 1]});
+    if (sources.empty()) sources.push_back(Source{"data", default_data});
+
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+
+    while (stop_requested == 0) {
+        for (Source& source : sources) {
+            std::error_code error;
+            auto modified = std::filesystem::last_write_time(source.path, error);
+            auto size = std::filesystem::file_size(source.path, error);
+            if (error || (source.publisher->generation() != 0 && modified == source.modified && size == source.size)) {
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            PriceSeries series = loadSeries(source.path);
+            if (!source.publisher->publish(source.symbol, series.view())) return 1;
+            source.modified = modified;
+            source.size = size;
+            std::cout << "Published " << source.symbol << ": " << series.size() << " bars, generation "
+                      << source.publisher->generation() << ", " << secondsSince(start) * 1000.0 << " ms" << std::endl;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+    std::cout << "Stopping, segments removed" << std::endl;
+    return 0;
+}
+
+// sma attach [symbol] [fast slow]...
+// Client: backtests straight off the shared segment, no parse and no copy.
+int runAttach(int argc, char** argv) {
+    std::string symbol = argc > 2 ? argv[2] : "data";
+    std::vector<SmaParams> pairs = readPairs(argc, argv, 3);
+
+    SharedSeries shared;
+    auto start = std::chrono::steady_clock::now();
+    if (!shared.attach(symbol)) return 1;
+    std::uint64_t generation = 0;
+    PriceView prices = shared.view(&generation);
+    double attach_seconds = secondsSince(start);
+
+    std::vector<BacktestResult> results;
+    bool consistent = false;
+    for (int attempt = 0; attempt < 100; attempt++) {
+        if (prices.size() == 0) {
+            std::cerr << "Error: no bars to backtest from " << symbol << "\n";
+            return 1;
+        }
+        results.clear();
+        for (const SmaParams& p : pairs) results.push_back(runSmaBacktest(prices, p, {}));
+        consistent = shared.unchanged(generation);
+        if (consistent) break;
+        if (shared.retired() && !shared.attach(symbol)) return 1; // republished into a bigger segment
+        prices = shared.view(&generation);
+    }
+    if (!consistent) {
+        std::cerr << "Error: " << symbol << " was republished during every one of 100 attempts, no results\n";
+        return 1;
+    }
+
+    std::cout << "Attached " << symbol << " in " << attach_seconds * 1e6 << " us: " << prices.size()
+              << " bars, generation " << generation << std::endl;
+    for (std::size_t i = 0; i < pairs.size(); i++) printResult(pairs[i], results[i]);
+    return 0;
+}
+
+// sma serve [socket] [csv]...
+// Resident server: datasets loaded and SMA columns kept warm between requests.
+int runServe(int argc, char** argv) {
+    ServerConfig config;
+    if (argc > 2) config.socket_path = argv[2];
+    for (int i = 3; i < argc; i++) config.datasets.push_back(argv[i]);
+    if (config.datasets.empty()) config.datasets.push_back(default_data);
+
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    return serveBacktests(config, stop_requested);
+}
+
+// sma client [socket] [requests] [pairs per request] [in flight]
+// Load generator: random SMA pairs against dataset 0, then the server's latency histogram.
+int runClient(int argc, char** argv) {
+    std::string socket_path = argc > 2 ? argv[2] : ServerConfig{}.socket_path;
+    int requests = argc > 3 ? std::atoi(argv[3]) : 10000;
+    int per_request = argc > 4 ? std::max(1, std::atoi(argv[4])) : 1;
+    int in_flight = argc > 5 ? std::max(1, std::atoi(argv[5])) : 16;
+
+    BacktestClient client;
+    if (!client.connect(socket_path)) return 1;
+
+    std::vector<SmaParams> grid = makeSmaGrid(2, 50, 1, 10, 200, 5);
+    std::vector<SmaParams> pairs(per_request);
+    std::vector<BacktestResult> results;
+    std::size_t next_pair = 0;
+    int sent = 0;
+    int received = 0;
+    double equity_sum = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    while (received < requests) {
+        while (sent < requests && sent - received < in_flight) {
+            for (SmaParams& p : pairs) p = grid[next_pair++ % grid.size()];
+            if (!client.send(0, pairs)) return 1;
+            sent++;
+        }
+        if (!client.receive(results)) return 1;
+        for (const BacktestResult& result : results) equity_sum += result.final_equity;
+        received++;
+    }
+    double seconds = secondsSince(start);
+
+    std::cout << "Requests: " << requests << " x " << per_request << " pairs, " << in_flight << " in flight" << std::endl;
+    std::cout << "Time: " << seconds * 1000.0 << " ms  " << requests / seconds << " requests/s  "
+              << requests * per_request / seconds << " backtests/s  (equity sum " << equity_sum << ")" << std::endl;
+
+    // A window longer than the data is refused on its own; the other pair still runs.
+    std::vector<WireStatus> statuses;
+    if (!client.send(0, {{5, std::numeric_limits<int>::max()}, grid[0]}) || !client.receive(results, &statuses)) {
+        return 1;
+    }
+    const bool refused = statuses[0] == WireStatus::WindowTooLong && statuses[1] == WireStatus::Ok;
+    std::cout << "Oversized window refused: " << (refused ? "yes" : "no") << std::endl;
+
+    LatencyHistogram histogram;
+    if (!client.stats(histogram)) return 1;
+    std::cout << "Server-side latency:" << std::endl;
+    histogram.print(std::cout);
+    return 0;
+}
+
+// sma shard-sweep [csv] [workers] [crash shard] [slow worker]
+// SMA grid over forked worker processes, checked against the in-process sweep.
+int runShardSweep(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    ShardConfig shard;
+    if (argc > 3) shard.workers = static_cast<std::size_t>(std::max(1, std::atoi(argv[3])));
+    if (argc > 4) shard.crash_shard = std::atoi(argv[4]);
+    if (argc > 5) {
+        shard.slow_worker = std::atoi(argv[5]);
+        shard.slow_ms = 200;
+    }
+
+    PriceSeries series = loadSeries(path);
+    std::vector<SmaParams> grid = makeSmaGrid(2, 50, 1, 10, 200, 5);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BacktestResult> reference = runSmaSweepBatched(series.view(), grid);
+    double local_seconds = secondsSince(start);
+
+    ShardStats stats;
+    start = std::chrono::steady_clock::now();
+    std::vector<BacktestResult> results = runSmaSweepSharded(series.view(), grid, {}, shard, &stats);
+    double sharded_seconds = secondsSince(start);
+    if (results.size() != grid.size()) return 1;
+
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < grid.size(); i++) {
+        if (!sameResult(results[i], reference[i])) mismatches++;
+    }
+
+    std::cout << "Combinations: " << grid.size() << " in " << stats.shards << " shards over "
+              << shard.workers << " workers" << std::endl;
+    std::cout << "Shards per worker:";
+    for (std::size_t n : stats.shards_per_worker) std::cout << " " << n;
+    std::cout << std::endl;
+    std::cout << "Crashes: " << stats.crashes << "  retried: " << stats.retried << "  respawned: " << stats.respawned
+              << "  re-issued stragglers: " << stats.reissued << "  duplicates dropped: " << stats.duplicates << std::endl;
+    std::cout << "In-process: " << local_seconds * 1000.0 << " ms  sharded: " << sharded_seconds * 1000.0
+              << " ms  mismatches: " << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// sma pool-bench [csv] [threads] [rounds] [nodes]
+// Batched sweep on an unpinned and a pinned pool: throughput, spread between
+// rounds, and per-worker stats. `nodes` splits the CPUs into that many fake
+// NUMA nodes, to exercise the per-node replicas on a single-socket machine.
+int runPoolBench(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    std::size_t threads = argc > 3 ? static_cast<std::size_t>(std::max(0, std::atoi(argv[3]))) : 0;
+    int rounds = argc > 4 ? std::max(2, std::atoi(argv[4])) : 20;
+    int fake_nodes = argc > 5 ? std::atoi(argv[5]) : 0;
+
+    CpuTopology topology = CpuTopology::detect();
+    if (fake_nodes > 0) {
+        std::vector<int> cpus;
+        for (const std::vector<int>& node : topology.nodes) cpus.insert(cpus.end(), node.begin(), node.end());
+        topology.nodes.assign(static_cast<std::size_t>(fake_nodes), {});
+        for (std::size_t i = 0; i < std::max(cpus.size(), topology.nodes.size()); i++) {
+            topology.nodes[i % topology.nodes.size()].push_back(cpus[i % cpus.size()]);
+        }
+    }
+    std::cout << "Topology: " << topology.nodes.size() << " node(s), " << topology.cpuCount() << " CPUs" << std::endl;
+
+    PriceSeries series = loadSeries(path);
+    std::vector<SmaParams> grid = makeSmaGrid(2, 50, 1, 10, 200, 5);
+    std::vector<BacktestResult> reference = runSmaSweepBatched(series.view(), grid);
+
+    for (PoolPinning pinning : {PoolPinning::None, PoolPinning::Cores}) {
+        ThreadPool pool(threads, pinning, &topology);
+        runSmaSweepBatched(series.view(), grid, {}, 8, &pool); // warm up
+        pool.resetStats();
+
+        std::vector<double> seconds;
+        std::size_t mismatches = 0;
+        for (int r = 0; r < rounds; r++) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<BacktestResult> results = runSmaSweepBatched(series.view(), grid, {}, 8, &pool);
+            seconds.push_back(secondsSince(start));
+            for (std::size_t i = 0; i < grid.size(); i++) {
+                if (!sameResult(results[i], reference[i])) mismatches++;
+            }
+        }
+
+        double mean = 0.0;
+        for (double s : seconds) mean += s;
+        mean /= static_cast<double>(seconds.size());
+        double variance = 0.0;
+        for (double s : seconds) variance += (s - mean) * (s - mean);
+        double stddev = std::sqrt(variance / static_cast<double>(seconds.size() - 1));
+
+        std::cout << (pinning == PoolPinning::None ? "Unpinned" : "Pinned") << ": " << pool.size() << " workers, "
+                  << mean * 1000.0 << " ms/sweep (+-" << stddev / mean * 100.0 << "%), "
+                  << static_cast<double>(grid.size()) / mean << " backtests/s, mismatches: " << mismatches << std::endl;
+        std::vector<WorkerStats> stats = pool.stats();
+        for (std::size_t w = 0; w < stats.size(); w++) {
+            std::cout << "  worker " << w << "  node " << stats[w].node << "  cpu " << stats[w].cpu
+                      << "  tasks " << stats[w].tasks << "  stolen " << stats[w].stolen_local << " local / "
+                      << stats[w].stolen_remote << " remote  busy " << stats[w].utilization * 100.0 << "%" << std::endl;
+        }
+    }
+    return 0;
+}
+
+// sma asof [csv] [minutes per bar]
+// Joins synthetic intraday bars spanning the file to its daily bars, each
+// daily bar complete one day after its stamp. Times the single and the
+// multi-series join and checks both against a binary search per row.
+int runAsOf(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    std::int64_t step = 60 * (argc > 3 ? std::max(1, std::atoi(argv[3])) : 1);
+    constexpr std::int64_t day = 86400;
+
+    PriceSeries daily = loadSeries(path);
+    if (daily.size() == 0) return 1;
+    std::vector<std::int64_t> fine;
+    for (std::int64_t t = daily.time.front(); t <= daily.time.back() + day; t += step) fine.push_back(t);
+
+    // A second coarse series: weekly bars, every fifth trading day.
+    std::vector<std::int64_t> weekly;
+    for (std::size_t i = 0; i < daily.size(); i += 5) weekly.push_back(daily.time[i]);
+
+    auto expected = [&](std::span<const std::int64_t> right, std::int64_t lag, std::int64_t t) {
+        auto it = std::upper_bound(right.begin(), right.end(), t - lag);
+        return static_cast<std::int32_t>(it - right.begin()) - 1;
+    };
+
+    std::vector<std::int32_t> index(fine.size());
+    double best = 1e9;
+    for (int r = 0; r < 10; r++) {
+        auto start = std::chrono::steady_clock::now();
+        AsOfCursor cursor(daily.time, day);
+        cursor.join(fine, index);
+        best = std::min(best, secondsSince(start));
+    }
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < fine.size(); i++) {
+        if (index[i] != expected(daily.time, day, fine[i])) mismatches++;
+    }
+    std::cout << "Single join: " << fine.size() << " rows onto " << daily.size() << " daily bars in "
+              << best * 1000.0 << " ms (" << static_cast<double>(fine.size()) / best / 1e6
+              << "M rows/s), mismatches: " << mismatches << std::endl;
+
+    // Streamed in uneven blocks, the way rows come off the parser.
+    AsOfCursor streamed(daily.time, day);
+    std::vector<std::int32_t> blocked(fine.size());
+    for (std::size_t first = 0, count = 1000; first < fine.size(); first += count, count = count * 3 % 7919 + 1) {
+        count = std::min(count, fine.size() - first);
+        streamed.join(std::span(fine).subspan(first, count), std::span(blocked).subspan(first, count));
+    }
+    std::cout << "Streamed join matches: " << (blocked == index ? "yes" : "no") << std::endl;
+
+    const std::span<const std::int64_t> rights[] = {daily.time, weekly};
+    const std::int64_t lags[] = {day, 7 * day};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<std::int32_t>> both = asOfJoin(fine, rights, lags);
+    double seconds = secondsSince(start);
+    mismatches = 0;
+    for (std::size_t i = 0; i < fine.size(); i++) {
+        if (both[0][i] != expected(daily.time, day, fine[i])) mismatches++;
+        if (both[1][i] != expected(weekly, 7 * day, fine[i])) mismatches++;
+    }
+    std::cout << "Daily + weekly join: " << seconds * 1000.0 << " ms, mismatches: " << mismatches << std::endl;
+
+    // Daily SMA 50 as seen from each intraday bar.
+    std::vector<double> trend = gatherAsOf(rollingMean(daily.close, 50), index);
+    std::size_t known = 0;
+    for (double value : trend) known += std::isnan(value) ? 0 : 1;
+    std::cout << "Daily SMA 50 known on " << known << " of " << trend.size() << " intraday bars" << std::endl;
+    return mismatches == 0 && blocked == index ? 0 : 1;
+}
+
+// sma rolling-cov [csv] [assets] [window]
+// Rolling covariance of synthetic assets (the file's returns times a beta,
+// plus noise): incremental per bar against recomputing each window from
+// scratch, and the incremental result checked against the recomputation.
+// Without `assets` and `window`, runs a grid of both.
+int runRollingCov(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    std::vector<std::size_t> asset_counts = {50, 100, 250, 500};
+    std::vector<int> windows = {20, 60, 250};
+    if (argc > 3) asset_counts = {static_cast<std::size_t>(std::max(2, std::atoi(argv[3])))};
+    if (argc > 4) windows = {std::max(2, std::atoi(argv[4]))};
+
+    PriceSeries series = loadSeries(path);
+    if (series.size() < 2) return 1;
+    const std::size_t bars = std::min<std::size_t>(series.size() - 1, 2000);
+    const std::size_t max_assets = *std::max_element(asset_counts.begin(), asset_counts.end());
+
+    std::mt19937_64 random(42);
+    std::normal_distribution<double> noise(0.0, 0.01);
+    std::uniform_real_distribution<double> beta(0.2, 1.8);
+    std::vector<double> betas(max_assets);
+    for (double& b : betas) b = beta(random);
+    std::vector<double> returns(bars * max_assets);
+    for (std::size_t t = 0; t < bars; t++) {
+        const double market = std::log(series.close[t + 1] / series.close[t]);
+        for (std::size_t a = 0; a < max_assets; a++) returns[t * max_assets + a] = betas[a] * market + noise(random);
+    }
+
+    bool ok = true;
+    for (std::size_t assets : asset_counts) {
+        std::vector<double> rows(bars * assets);
+        for (std::size_t t = 0; t < bars; t++) {
+            std::copy_n(returns.begin() + static_cast<std::ptrdiff_t>(t * max_assets), assets,
+                        rows.begin() + static_cast<std::ptrdiff_t>(t * assets));
+        }
+        auto row = [&](std::size_t t) { return std::span<const double>(rows).subspan(t * assets, assets); };
+
+        for (int window : windows) {
+            if (static_cast<std::size_t>(window) > bars) continue;
+            RollingCovariance rolling(assets, window);
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t t = 0; t < bars; t++) rolling.update(row(t));
+            const double incremental = secondsSince(start) / static_cast<double>(bars);
+
+            // From scratch is slow at the top end, so time only the last few windows.
+            const std::size_t samples = 5;
+            std::vector<double> reference;
+            start = std::chrono::steady_clock::now();
+            for (std::size_t s = samples; s-- > 0;) {
+                const std::size_t first = bars - static_cast<std::size_t>(window) - s;
+                reference = windowCovariance(std::span<const double>(rows).subspan(first * assets, window * assets),
+                                             assets);
+            }
+            const double scratch = secondsSince(start) / static_cast<double>(samples);
+
+            std::vector<double> matrix = rolling.covarianceMatrix();
+            double error = 0.0;
+            double scale = 0.0;
+            for (std::size_t k = 0; k < matrix.size(); k++) {
+                error = std::max(error, std::abs(matrix[k] - reference[k]));
+                scale = std::max(scale, std::abs(reference[k]));
+            }
+            ok = ok && error <= 1e-9 * scale;
+
+            std::cout << "N " << assets << "  W " << window << ":  incremental " << incremental * 1e6
+                      << " us/bar  from scratch " << scratch * 1e6 << " us/bar  (" << scratch / incremental
+                      << "x)  max rel error " << error / scale << std::endl;
+        }
+
+        // A pair list of 2N random pairs, e.g. each asset against two hedges.
+        std::vector<AssetPair> pairs;
+        std::uniform_int_distribution<std::uint32_t> pick(0, static_cast<std::uint32_t>(assets - 1));
+        for (std::size_t k = 0; k < 2 * assets; k++) pairs.push_back(AssetPair{pick(random), pick(random)});
+        const int window = windows.back() <= static_cast<int>(bars) ? windows.back() : windows.front();
+        RollingCovariance full(assets, window);
+        RollingCovariance subset(assets, window, pairs);
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t t = 0; t < bars; t++) subset.update(row(t));
+        const double seconds = secondsSince(start) / static_cast<double>(bars);
+        for (std::size_t t = 0; t < bars; t++) full.update(row(t));
+        double error = 0.0;
+        for (std::size_t k = 0; k < pairs.size(); k++) {
+            error = std::max(error, std::abs(subset.pairCorrelation(k) - full.correlation(pairs[k].a, pairs[k].b)));
+        }
+        ok = ok && error <= 1e-9;
+        std::cout << "N " << assets << "  W " << window << ":  " << pairs.size() << " pairs only " << seconds * 1e6
+                  << " us/bar, max correlation difference " << error << std::endl;
+    }
+    return ok ? 0 : 1;
+}
+
+// sma excursions [csv] [threads]
+// MAE/MFE, time to peak and intra-trade drawdown for every trade of an SMA
+// grid, from the range-query index and by scanning each trade's bars.
+int runExcursions(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    std::size_t threads = argc > 3 ? static_cast<std::size_t>(std::max(0, std::atoi(argv[3]))) : 0;
+
+    PriceSeries series = loadSeries(path);
+    const PriceView prices = series.view();
+    std::vector<SmaParams> grid = makeSmaGrid(2, 50, 1, 10, 200, 5);
+    ThreadPool pool(threads);
+
+    std::vector<std::vector<Trade>> per_run(grid.size());
+    for (std::size_t i = 0; i < grid.size(); i++) {
+        pool.submit([&, i] { runSmaBacktest(prices, grid[i], {}, &per_run[i]); });
+    }
+    pool.wait();
+    std::vector<Trade> trades;
+    for (const std::vector<Trade>& run : per_run) trades.insert(trades.end(), run.begin(), run.end());
+
+    auto start = std::chrono::steady_clock::now();
+    ExcursionIndex index(prices);
+    const double build = secondsSince(start);
+
+    std::vector<TradeExcursion> scanned(trades.size());
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < trades.size(); i++) scanned[i] = scanExcursion(prices, trades[i]);
+    const double scan = secondsSince(start);
+
+    std::vector<TradeExcursion> indexed(trades.size());
+    start = std::chrono::steady_clock::now();
+    index.measure(trades, indexed);
+    const double single = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    index.measure(trades, indexed, &pool);
+    const double pooled = secondsSince(start);
+
+    std::size_t mismatches = 0;
+    std::size_t held = 0;
+    double favorable = 0.0, adverse = 0.0, worst = 0.0, to_peak = 0.0;
+    for (std::size_t i = 0; i < trades.size(); i++) {
+        const TradeExcursion& a = indexed[i];
+        const TradeExcursion& b = scanned[i];
+        if (a.favorable != b.favorable || a.adverse != b.adverse || a.drawdown != b.drawdown ||
+            a.bars_to_peak != b.bars_to_peak || a.bars_to_trough != b.bars_to_trough || a.bars != b.bars) {
+            mismatches++;
+        }
+        held += static_cast<std::size_t>(a.bars);
+        favorable += a.favorable;
+        adverse += a.adverse;
+        to_peak += a.bars_to_peak;
+        worst = std::max(worst, a.drawdown);
+    }
+    const double count = static_cast<double>(std::max<std::size_t>(1, trades.size()));
+
+    std::cout << grid.size() << " runs, " << trades.size() << " trades, " << held / std::max<std::size_t>(1, trades.size())
+              << " bars held on average" << std::endl;
+    std::cout << "Index build: " << build * 1000.0 << " ms" << std::endl;
+    std::cout << "Scan:  " << scan * 1000.0 << " ms (" << scan / count * 1e9 << " ns/trade)" << std::endl;
+    std::cout << "Index: " << single * 1000.0 << " ms (" << single / count * 1e9 << " ns/trade), on "
+              << pool.size() << " threads " << pooled * 1000.0 << " ms" << std::endl;
+    // Long holds, where a scan costs the whole holding period.
+    std::mt19937_64 random(7);
+    std::vector<Trade> long_trades;
+    for (int length : {250, 1000, 4000}) {
+        if (static_cast<std::size_t>(length) + 1 >= prices.size()) break;
+        std::uniform_int_distribution<std::size_t> entry(0, prices.size() - static_cast<std::size_t>(length) - 1);
+        long_trades.clear();
+        for (int k = 0; k < 10000; k++) {
+            const std::size_t e = entry(random);
+            long_trades.push_back(Trade{static_cast<int>(e), static_cast<int>(e) + length, prices.close[e], 0.0});
+        }
+        std::vector<TradeExcursion> a(long_trades.size());
+        std::vector<TradeExcursion> b(long_trades.size());
+        start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < long_trades.size(); i++) b[i] = scanExcursion(prices, long_trades[i]);
+        const double long_scan = secondsSince(start);
+        start = std::chrono::steady_clock::now();
+        index.measure(long_trades, a);
+        const double long_index = secondsSince(start);
+        for (std::size_t i = 0; i < long_trades.size(); i++) {
+            if (a[i].favorable != b[i].favorable || a[i].drawdown != b[i].drawdown) mismatches++;
+        }
+        std::cout << "Held " << length << " bars: scan " << long_scan / 1e4 * 1e9 << " ns/trade, index "
+                  << long_index / 1e4 * 1e9 << " ns/trade" << std::endl;
+    }
+    std::cout << "Mean MFE " << favorable / count * 100.0 << "%  mean MAE " << adverse / count * 100.0
+              << "%  mean bars to peak " << to_peak / count << "  worst drawdown " << worst * 100.0 << "%" << std::endl;
+    std::cout << "Mismatches: " << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// sma rolling-quantile [csv] [window]...
+// Rolling median, 10/90% bands and percentile rank over a long synthetic
+// close column (the file's returns replayed with noise): streaming
+// skiplist, whole-column Fenwick tree, and sorting every window. The sort
+// is timed on a sample of bars at large windows.
+int runRollingQuantile(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    std::vector<int> windows;
+    for (int i = 3; i < argc; i++) windows.push_back(std::max(1, std::atoi(argv[i])));
+    if (windows.empty()) windows = {20, 100, 500, 1000, 5000};
+
+    PriceSeries series = loadSeries(path);
+    if (series.size() < 2) return 1;
+    std::mt19937_64 random(11);
+    std::normal_distribution<double> noise(0.0, 0.002);
+    std::vector<double> close{series.close.front()};
+    while (close.size() < 50000) {
+        const std::size_t t = close.size() % (series.size() - 1);
+        close.push_back(close.back() * (series.close[t + 1] / series.close[t]) * (1.0 + noise(random)));
+    }
+    const double qs[] = {0.1, 0.5, 0.9};
+
+    auto quantile = [](const std::vector<double>& sorted, double q) {
+        const double h = static_cast<double>(sorted.size() - 1) * q;
+        const std::size_t below = static_cast<std::size_t>(h);
+        const double fraction = h - static_cast<double>(below);
+        if (fraction == 0.0 || below + 1 >= sorted.size()) return sorted[below];
+        return sorted[below] + fraction * (sorted[below + 1] - sorted[below]);
+    };
+
+    std::size_t mismatches = 0;
+    for (int window : windows) {
+        if (static_cast<std::size_t>(window) > close.size()) continue;
+        const std::size_t n = close.size();
+        const std::size_t w = static_cast<std::size_t>(window);
+
+        std::vector<double> lower(n), median(n), upper(n), rank(n);
+        RollingQuantile rolling(window);
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < n; i++) {
+            rolling.update(close[i]);
+            const QuantileBand band = rolling.band(0.1);
+            lower[i] = band.lower;
+            median[i] = band.middle;
+            upper[i] = band.upper;
+            rank[i] = rolling.percentileRank(close[i]);
+        }
+        const double streaming = secondsSince(start) / static_cast<double>(n);
+
+        start = std::chrono::steady_clock::now();
+        std::vector<std::vector<double>> columns = rollingQuantiles(close, window, qs);
+        std::vector<double> ranks = rollingPercentileRank(close, window);
+        const double batch = secondsSince(start) / static_cast<double>(n);
+
+        const std::size_t sample = std::min<std::size_t>(n - w + 1, 2000);
+        std::vector<double> sorted;
+        start = std::chrono::steady_clock::now();
+        for (std::size_t i = w - 1; i < w - 1 + sample; i++) {
+            sorted.assign(close.begin() + static_cast<std::ptrdiff_t>(i + 1 - w),
+                          close.begin() + static_cast<std::ptrdiff_t>(i + 1));
+            std::sort(sorted.begin(), sorted.end());
+            auto below = std::lower_bound(sorted.begin(), sorted.end(), close[i]) - sorted.begin();
+            auto at_most = std::upper_bound(sorted.begin(), sorted.end(), close[i]) - sorted.begin();
+            const double sorted_rank = (static_cast<double>(below) + 0.5 * static_cast<double>(at_most - below)) /
+                                       static_cast<double>(w) * 100.0;
+            if (quantile(sorted, qs[0]) != columns[0][i] || quantile(sorted, qs[1]) != columns[1][i] ||
+                quantile(sorted, qs[2]) != columns[2][i] || sorted_rank != ranks[i]) {
+                mismatches++;
+            }
+        }
+        const double sorting = secondsSince(start) / static_cast<double>(sample);
+
+        for (std::size_t i = 0; i < n; i++) {
+            auto same = [](double a, double b) { return a == b || (std::isnan(a) && std::isnan(b)); };
+            if (!same(lower[i], columns[0][i]) || !same(median[i], columns[1][i]) || !same(upper[i], columns[2][i]) ||
+                !same(rank[i], ranks[i])) {
+                mismatches++;
+            }
+        }
+
+        std::cout << "W " << window << ":  skiplist " << streaming * 1e9 << " ns/bar  Fenwick " << batch * 1e9
+                  << " ns/bar  sort " << sorting * 1e9 << " ns/bar  (" << sorting / streaming << "x / "
+                  << sorting / batch << "x)" << std::endl;
+    }
+
+    // A missing close must blank exactly the windows that hold it, then leave
+    // both paths agreeing with a plain sort again once it has rolled out.
+    std::vector<double> gappy(close.begin(), close.begin() + 3000);
+    gappy[1000] = std::numeric_limits<double>::quiet_NaN();
+    const std::size_t w = 100;
+    RollingQuantile rolling(static_cast<int>(w));
+    std::vector<std::vector<double>> columns = rollingQuantiles(gappy, static_cast<int>(w), qs);
+    std::vector<double> ranks = rollingPercentileRank(gappy, static_cast<int>(w));
+    std::size_t blank = 0;
+    std::vector<double> sorted;
+    for (std::size_t i = 0; i < gappy.size(); i++) {
+        rolling.update(gappy[i]);
+        const double middle = rolling.median();
+        if (i + 1 < w) continue;
+        const bool holds_gap = i >= 1000 && i < 1000 + w;
+        if (std::isnan(middle) != holds_gap || std::isnan(columns[1][i]) != holds_gap ||
+            std::isnan(ranks[i]) != holds_gap) {
+            mismatches++;
+        }
+        blank += holds_gap;
+        if (holds_gap) continue;
+        sorted.assign(gappy.begin() + static_cast<std::ptrdiff_t>(i + 1 - w),
+                      gappy.begin() + static_cast<std::ptrdiff_t>(i + 1));
+        std::sort(sorted.begin(), sorted.end());
+        if (quantile(sorted, 0.5) != middle || middle != columns[1][i]) mismatches++;
+    }
+    std::cout << "NaN at bar 1000: " << blank << " windows blank (W " << w << ")" << std::endl;
+    std::cout << "Mismatches: " << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// sma ring-bench [count]
+// RingBuffer against std::deque for a rolling window: push/evict with a
+// running sum, and a full pass over the window each bar. Then the SPSC ring
+// against BoundedQueue between two threads, and the PriceAnalyzer exercise
+// (average of the last 5 prices) redone on RingBuffer against the original.
+int runRingBench(int argc, char** argv) {
+    const std::size_t count = argc > 2 ? static_cast<std::size_t>(std::max(1, std::atoi(argv[2]))) : 10000000;
+    constexpr std::size_t window = 64;
+
+    std::mt19937_64 random(5);
+    std::uniform_real_distribution<double> price(90.0, 110.0);
+    std::vector<double> values(count);
+    for (double& v : values) v = price(random);
+
+    auto report = [&](const char* name, double seconds, double check) {
+        std::cout << "  " << name << ": " << seconds / static_cast<double>(count) * 1e9 << " ns/value  (" << check
+                  << ")" << std::endl;
+    };
+
+    std::cout << "Rolling sum, window " << window << ":" << std::endl;
+    {
+        RingBuffer<double, window> ring;
+        double sum = 0.0, total = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (double v : values) {
+            if (ring.full()) sum -= ring.front();
+            ring.push(v);
+            sum += v;
+            total += sum;
+        }
+        report("RingBuffer", secondsSince(start), total);
+    }
+    {
+        DynamicRingBuffer<double> ring(window);
+        double sum = 0.0, total = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (double v : values) {
+            if (ring.full()) sum -= ring.front();
+            ring.push(v);
+            sum += v;
+            total += sum;
+        }
+        report("DynamicRingBuffer", secondsSince(start), total);
+    }
+    {
+        std::deque<double> queue;
+        double sum = 0.0, total = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (double v : values) {
+            if (queue.size() == window) {
+                sum -= queue.front();
+                queue.pop_front();
+            }
+            queue.push_back(v);
+            sum += v;
+            total += sum;
+        }
+        report("std::deque", secondsSince(start), total);
+    }
+
+    // Counting compares is exact in any order, so the span loops vectorize
+    // without -ffast-math.
+    std::cout << "Window values below the newest, recounted every value:" << std::endl;
+    {
+        RingBuffer<double, window> ring;
+        double total = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (double v : values) {
+            ring.push(v);
+            const RingSpans<double> parts = ring.spans();
+            std::int64_t below = 0;
+            for (double x : parts.first) below += x < v;
+            for (double x : parts.second) below += x < v;
+            total += static_cast<double>(below);
+        }
+        report("RingBuffer spans", secondsSince(start), total);
+    }
+    {
+        std::deque<double> queue;
+        double total = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (double v : values) {
+            if (queue.size() == window) queue.pop_front();
+            queue.push_back(v);
+            std::int64_t below = 0;
+            for (double x : queue) below += x < v;
+            total += static_cast<double>(below);
+        }
+        report("std::deque", secondsSince(start), total);
+    }
+
+    std::cout << "Producer to consumer thread:" << std::endl;
+    {
+        auto ring = std::make_unique<SpscRingBuffer<double, 4096>>();
+        double total = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        std::thread consumer([&] {
+            double batch[256];
+            for (std::size_t received = 0; received < count;) {
+                std::size_t got = ring->tryPop(std::span<double>(batch));
+                if (got == 0) std::this_thread::yield();
+                for (std::size_t i = 0; i < got; i++) total += batch[i];
+                received += got;
+            }
+        });
+        for (double v : values) {
+            while (!ring->tryPush(v)) std::this_thread::yield();
+        }
+        consumer.join();
+        report("SpscRingBuffer", secondsSince(start), total);
+    }
+    {
+        BoundedQueue<double> queue(4096);
+        double total = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        std::thread consumer([&] {
+            double v = 0.0;
+            while (queue.pop(v)) total += v;
+        });
+        for (double v : values) queue.push(v);
+        queue.close();
+        consumer.join();
+        report("BoundedQueue", secondsSince(start), total);
+    }
+
+    // Recall's PriceAnalyzer as written (it sits in a comment block in
+    // cpp/Recall/main.cpp, so this is where it runs), and on RingBuffer.
+    struct OriginalAnalyzer {
+        double history_buffer[5] {};
+        int prices_added {};
+        int current_index {};
+        void addPrice(double price) {
+            if (prices_added < 5) {
+                history_buffer[prices_added] = price;
+                prices_added++;
+            } else {
+                history_buffer[current_index] = price;
+                current_index++;
+                if (current_index == 5) current_index = 0;
+            }
+        }
+        double calculateAverage() const {
+            if (prices_added == 0) return 0.0;
+            double sum = 0.0;
+            for (int i = 0; i < prices_added && i < 5; ++i) sum += history_buffer[i];
+            return sum / prices_added;
+        }
+    };
+    struct RingAnalyzer {
+        RingBuffer<double, 5> history;
+        void addPrice(double price) { history.push(price); }
+        double calculateAverage() const {
+            if (history.empty()) return 0.0;
+            double sum = 0.0;
+            for (std::size_t i = 0; i < history.size(); i++) sum += history[i];
+            return sum / static_cast<double>(history.size());
+        }
+    };
+    OriginalAnalyzer original;
+    RingAnalyzer ring;
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < std::min<std::size_t>(count, 100000); i++) {
+        original.addPrice(values[i]);
+        ring.addPrice(values[i]);
+        // Same prices, summed in a different order, so allow rounding.
+        if (std::abs(original.calculateAverage() - ring.calculateAverage()) > 1e-12 * original.calculateAverage()) {
+            mismatches++;
+        }
+    }
+    std::cout << "PriceAnalyzer on RingBuffer, mismatches: " << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// sma alloc-profile [csv] [leak]
+// Batched sweep and streaming pipeline under the allocation profiler, the
+// sweep's cost with stack sampling against counting alone, then the report
+// and what is still allocated at exit. `leak` adds the MemoryLeaks sample's lost int and one
+// allocation inside a no-alloc region, to show both being caught.
+// Needs a build with -DSMA_ALLOC_PROFILER.
+int runAllocProfile(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    const bool leak = argc > 3 && std::string(argv[3]) == "leak";
+    if (!alloc_profiler_enabled) {
+        printAllocReport(std::cout);
+        return 1;
+    }
+
+    reportAllocsAtExit();
+    PriceSeries series = loadSeries(path);
+    std::vector<SmaParams> grid = makeSmaGrid(2, 50, 1, 10, 200, 5);
+    ThreadPool pool;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < 5; round++) runSmaSweepBatched(series.view(), grid, {}, 8, &pool);
+    std::cout << "Sweeps: " << secondsSince(start) * 1000.0 / 5.0 << " ms each" << std::endl;
+
+    // What sampling adds: back-to-back sweeps with it off and on, taking turns
+    // at going first, and the median of the pairs' ratios.
+    const int rounds = 15;
+    std::vector<double> ratios(rounds);
+    const std::uint64_t sampled_before = allocCounters().sampled;
+    for (int r = 0; r < rounds; r++) {
+        double seconds[2] {};
+        for (int side = 0; side < 2; side++) {
+            const bool on = (side + r) % 2 == 1;
+            setAllocSampling(on);
+            start = std::chrono::steady_clock::now();
+            runSmaSweepBatched(series.view(), grid, {}, 8, &pool);
+            seconds[on] = secondsSince(start);
+        }
+        ratios[r] = seconds[1] / seconds[0];
+    }
+    setAllocSampling(true);
+    std::sort(ratios.begin(), ratios.end());
+    std::cout << "Sampling adds " << (ratios[rounds / 2] - 1.0) * 100.0 << "% to a sweep (median of " << rounds
+              << " pairs, quartiles " << (ratios[rounds / 4] - 1.0) * 100.0 << "% to "
+              << (ratios[rounds * 3 / 4] - 1.0) * 100.0 << "%, " << allocCounters().sampled - sampled_before
+              << " stacks captured)" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    runStreamingBacktest(path, readPairs(0, argv, 0));
+    std::cout << "Pipeline: " << secondsSince(start) * 1000.0 << " ms" << std::endl;
+
+    if (leak) {
+        int* p_number {new int {67}};
+        int number {55};
+        p_number = &number; // the first int is now unreachable
+        std::cout << "Value of p_number: " << *p_number << std::endl;
+
+        NoAllocScope no_alloc("alloc-profile demo");
+        std::vector<double> scratch(1000);
+        std::cout << "Scratch: " << scratch.size() << std::endl;
+    }
+
+    const AllocCounters counters = allocCounters();
+    std::cout << "Allocations: " << counters.allocations << ", sampled: " << counters.sampled
+              << ", no-alloc violations: " << counters.violations << std::endl;
+    printAllocReport(std::cout);
+    return 0;
+}
+
+// sma rotation [csv] [symbols] [years] [k]
+// Cross-sectional rotation over synthetic symbols (the file's returns times
+// a beta, plus noise, 252 bars a year): scoring, then top-k selection by a
+// full sort per bar, by nth_element per bar and incrementally, checked to
+// pick the same members; then momentum top-k and SMA-distance bottom-k books.
+int runRotation(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    const std::size_t symbols = argc > 3 ? static_cast<std::size_t>(std::max(2, std::atoi(argv[3]))) : 1000;
+    const std::size_t bars = 252 * static_cast<std::size_t>(argc > 4 ? std::max(1, std::atoi(argv[4])) : 20);
+    // Never more members than symbols to pick them from.
+    const std::size_t k = std::min(symbols, argc > 5 ? static_cast<std::size_t>(std::max(1, std::atoi(argv[5]))) : 20);
+
+    PriceSeries series = loadSeries(path);
+    if (series.size() < 2) return 1;
+    std::vector<double> market(bars);
+    for (std::size_t t = 0; t < bars; t++) {
+        const std::size_t i = t % (series.size() - 1);
+        market[t] = std::log(series.close[i + 1] / series.close[i]);
+    }
+    std::mt19937_64 random(42);
+    std::normal_distribution<double> noise(0.0, 0.01);
+    std::uniform_real_distribution<double> beta(0.2, 1.8);
+    std::vector<double> data(symbols * bars);
+    std::vector<std::span<const double>> closes;
+    for (std::size_t s = 0; s < symbols; s++) {
+        double* column = data.data() + s * bars;
+        const double b = beta(random);
+        double log_price = std::log(100.0);
+        for (std::size_t t = 0; t < bars; t++) {
+            log_price += b * market[t] + noise(random);
+            column[t] = std::exp(log_price);
+        }
+        closes.emplace_back(column, bars);
+    }
+
+    // Scores for every bar, so the selections below are timed on their own.
+    const std::size_t tile_bars = 64;
+    std::vector<double> scores(bars * symbols);
+    CrossSectionScorer scorer(closes, ScoreKind::Momentum, 60);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t first = 0; first < bars; first += tile_bars) {
+        scorer.scores(first, tile_bars, std::span<double>(scores).subspan(first * symbols));
+    }
+    const double scoring = secondsSince(start);
+    auto row = [&](std::size_t t) { return std::span<const double>(scores).subspan(t * symbols, symbols); };
+
+    std::vector<std::uint32_t> sorted_members(bars * k);
+    std::vector<std::uint32_t> order(symbols);
+    start = std::chrono::steady_clock::now();
+    for (std::size_t t = 0; t < bars; t++) {
+        std::span<const double> x = row(t);
+        for (std::size_t s = 0; s < symbols; s++) order[s] = static_cast<std::uint32_t>(s);
+        std::sort(order.begin(), order.end(), [x](std::uint32_t a, std::uint32_t b) {
+            return x[a] > x[b] || (x[a] == x[b] && a < b);
+        });
+        std::copy_n(order.begin(), k, sorted_members.begin() + static_cast<std::ptrdiff_t>(t * k));
+    }
+    const double sorting = secondsSince(start);
+
+    TopKSelector partial(k, false);
+    TopKSelector incremental(k);
+    std::vector<std::uint32_t> members(k);
+    std::size_t mismatches = 0;
+    double partial_seconds = 0.0;
+    double incremental_seconds = 0.0;
+    std::size_t changed = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        TopKSelector& selector = pass == 0 ? partial : incremental;
+        start = std::chrono::steady_clock::now();
+        for (std::size_t t = 0; t < bars; t++) {
+            selector.update(row(t));
+            changed += pass == 1 ? selector.changed() : 0;
+        }
+        (pass == 0 ? partial_seconds : incremental_seconds) = secondsSince(start);
+    }
+    // Final membership of both against the sort, then bar by bar for the incremental one.
+    TopKSelector checked(k);
+    for (std::size_t t = 0; t < bars; t++) {
+        checked.update(row(t));
+        members.assign(checked.members().begin(), checked.members().end());
+        std::sort(members.begin(), members.end());
+        std::vector<std::uint32_t> expected(sorted_members.begin() + static_cast<std::ptrdiff_t>(t * k),
+                                            sorted_members.begin() + static_cast<std::ptrdiff_t>((t + 1) * k));
+        std::sort(expected.begin(), expected.end());
+        mismatches += members != expected;
+        if (t + 1 == bars) {
+            members.assign(partial.members().begin(), partial.members().end());
+            std::sort(members.begin(), members.end());
+            mismatches += members != expected;
+        }
+    }
+
+    const double per_bar = 1e6 / static_cast<double>(bars);
+    std::cout << symbols << " symbols x " << bars << " bars, k " << k << std::endl;
+    std::cout << "Scoring (momentum 60): " << scoring * 1000.0 << " ms (" << scoring * per_bar << " us/bar)" << std::endl;
+    std::cout << "Full sort:    " << sorting * 1000.0 << " ms (" << sorting * per_bar << " us/bar)" << std::endl;
+    std::cout << "nth_element:  " << partial_seconds * 1000.0 << " ms (" << partial_seconds * per_bar << " us/bar)"
+              << std::endl;
+    std::cout << "Incremental:  " << incremental_seconds * 1000.0 << " ms (" << incremental_seconds * per_bar
+              << " us/bar), " << incremental.unchanged_bars << " bars unchanged, " << incremental.repaired_bars
+              << " repaired, " << changed << " swaps" << std::endl;
+
+    RotationConfig config;
+    config.top_k = k;
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            config.score = ScoreKind::SmaDistance;
+            config.lookback = 20;
+            config.bottom = true;
+        }
+        start = std::chrono::steady_clock::now();
+        const RotationResult result = runRotation(closes, config);
+        const double seconds = secondsSince(start);
+        std::cout << (pass == 0 ? "Momentum 60 top " : "SMA 20 distance bottom ") << k << ": " << seconds * 1000.0
+                  << " ms  return: " << result.total_return * 100.0 << "%  max drawdown: "
+                  << result.max_drawdown * 100.0 << "%  turnover: " << result.average_turnover * 100.0
+                  << "%/bar" << std::endl;
+    }
+    std::cout << "Mismatches: " << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// sma optimize [csv] [threads] [seeds] [budget]
+// Searches SMA crossover + trend filter + trailing stop (4 parameters) with
+// CMA-ES and successive halving, against scoring every point of the grid:
+// whole-history backtests needed to reach the grid's top 1%, 0.1% and its
+// best, median over seeds, with and without the halving.
+int runOptimize(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    std::size_t threads = argc > 3 ? static_cast<std::size_t>(std::max(0, std::atoi(argv[3]))) : 0;
+    const int seeds = argc > 4 ? std::max(1, std::atoi(argv[4])) : 10;
+    const double budget = argc > 5 ? std::max(1.0, std::atof(argv[5])) : 5000.0;
+
+    PriceSeries series = loadSeries(path);
+    if (series.size() < 2) return 1;
+    const PriceView prices = series.view();
+    SmaColumnCache columns(prices);
+    ThreadPool pool(threads);
+
+    const std::vector<SearchDimension> dimensions = {
+        {2, 50, 1},      // fast
+        {10, 200, 5},    // slow
+        {0, 250, 25},    // filter, 0 = off
+        {0, 0.20, 0.02}, // trailing stop, 0 = off
+    };
+    auto paramsOf = [](std::span<const double> point) {
+        return FilteredSmaParams{static_cast<int>(point[0]), static_cast<int>(point[1]), static_cast<int>(point[2]),
+                                 point[3]};
+    };
+    std::atomic<std::size_t> backtests {0};
+    Objective objective = [&](std::span<const double> point, double fraction) {
+        const FilteredSmaParams params = paramsOf(point);
+        if (params.fast >= params.slow) return -std::numeric_limits<double>::infinity();
+        const double bars = std::max(1.0, fraction * static_cast<double>(prices.size()));
+        backtests++;
+        return runFilteredSmaBacktest(prices.slice(0, static_cast<std::size_t>(bars)), params, columns).total_return;
+    };
+
+    // Every grid point, in parallel chunks.
+    std::vector<std::vector<double>> grid;
+    for (double fast = 2; fast <= 50; fast += 1) {
+        for (double slow = 10; slow <= 200; slow += 5) {
+            if (fast >= slow) continue;
+            for (double filter = 0; filter <= 250; filter += 25) {
+                for (int stop = 0; stop <= 10; stop++) grid.push_back({fast, slow, filter, stop * 0.02});
+            }
+        }
+    }
+    for (const std::vector<double>& point : grid) {
+        columns.column(static_cast<int>(point[0]));
+        columns.column(static_cast<int>(point[1]));
+        if (point[2] > 0) columns.column(static_cast<int>(point[2]));
+    }
+    std::vector<double> grid_scores(grid.size());
+    auto start = std::chrono::steady_clock::now();
+    const std::size_t chunk = 256;
+    for (std::size_t first = 0; first < grid.size(); first += chunk) {
+        pool.submit([&, first] {
+            const std::size_t last = std::min(grid.size(), first + chunk);
+            for (std::size_t i = first; i < last; i++) grid_scores[i] = objective(grid[i], 1.0);
+        });
+    }
+    pool.wait();
+    const double grid_seconds = secondsSince(start);
+    const auto best = static_cast<std::size_t>(std::max_element(grid_scores.begin(), grid_scores.end()) -
+                                               grid_scores.begin());
+    std::vector<double> ranked = grid_scores;
+    std::sort(ranked.begin(), ranked.end(), std::greater<>());
+
+    std::cout << "Grid: " << grid.size() << " backtests in " << grid_seconds * 1000.0 << " ms on " << pool.size()
+              << " threads, best return " << grid_scores[best] * 100.0 << "% at SMA " << grid[best][0] << "/"
+              << grid[best][1] << " filter " << grid[best][2] << " stop " << grid[best][3] * 100.0 << "%" << std::endl;
+
+    struct Target {
+        const char* name;
+        double score;
+    };
+    const Target targets[] = {
+        {"top 1%", ranked[ranked.size() / 100]},
+        {"top 0.1%", ranked[ranked.size() / 1000]},
+        {"grid best", ranked.front()},
+    };
+
+    bool ok = true;
+    for (int rungs : {3, 1}) {
+        std::vector<std::vector<double>> to_target(std::size(targets));
+        double spent = 0.0;
+        double seconds = 0.0;
+        double found = 0.0;
+        for (int seed = 1; seed <= seeds; seed++) {
+            OptimizerConfig config;
+            config.budget = budget;
+            config.target = ranked.front();
+            config.rungs = rungs;
+            config.seed = static_cast<std::uint64_t>(seed);
+            start = std::chrono::steady_clock::now();
+            const OptimizerResult result = optimizeCmaEs(dimensions, objective, config, &pool);
+            seconds += secondsSince(start);
+            spent += result.evaluations;
+            found += result.best_score;
+            // The optimizer's best must be what the grid says that point scores.
+            const auto at = std::find(grid.begin(), grid.end(), result.best);
+            ok = ok && at != grid.end() && grid_scores[static_cast<std::size_t>(at - grid.begin())] == result.best_score;
+            for (std::size_t t = 0; t < std::size(targets); t++) {
+                for (const OptimizerStep& step : result.progress) {
+                    if (step.best_score >= targets[t].score) {
+                        to_target[t].push_back(step.evaluations);
+                        break;
+                    }
+                }
+            }
+        }
+        std::cout << (rungs > 1 ? "CMA-ES + halving: " : "CMA-ES:           ") << seconds / seeds * 1000.0
+                  << " ms/run, mean best return " << found / seeds * 100.0 << "%, mean spent " << spent / seeds
+                  << std::endl;
+        for (std::size_t t = 0; t < std::size(targets); t++) {
+            std::vector<double>& hits = to_target[t];
+            std::cout << "  " << targets[t].name << " (" << targets[t].score * 100.0 << "%): reached in " << hits.size()
+                      << "/" << seeds << " runs";
+            if (!hits.empty()) {
+                std::sort(hits.begin(), hits.end());
+                const double median = hits[hits.size() / 2];
+                std::cout << ", median " << median << " backtests (" << static_cast<double>(grid.size()) / median
+                          << "x fewer than the grid)";
+            }
+            std::cout << std::endl;
+        }
+    }
+    // Same seed on the pool and on the calling thread alone: same search.
+    OptimizerConfig config;
+    config.budget = budget;
+    config.seed = 1;
+    const OptimizerResult pooled = optimizeCmaEs(dimensions, objective, config, &pool);
+    const OptimizerResult serial = optimizeCmaEs(dimensions, objective, config);
+    const bool same_search = pooled.best == serial.best && pooled.best_score == serial.best_score &&
+                             pooled.backtests == serial.backtests && pooled.generations == serial.generations;
+    std::cout << "Same search on " << pool.size() << " threads and on 1: " << (same_search ? "yes" : "NO") << std::endl;
+    ok = ok && same_search;
+
+    std::cout << "Objective calls: " << backtests.load() << std::endl;
+    std::cout << (ok ? "Optimizer results match the grid" : "Optimizer results DIFFER from the grid") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// sma journal [csv] [journal] [repeat]
+// Records a live run (the file's bars `repeat` times over, four SMA
+// strategies) to a journal, then replays it as fast as possible, at the
+// recorded pace, and with a changed strategy to show a divergence caught.
+int runJournal(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    std::string journal_path = argc > 3 ? argv[3] : "sma.journal";
+    const int repeat = argc > 4 ? std::max(1, std::atoi(argv[4])) : 100;
+
+    PriceSeries file = loadSeries(path);
+    if (file.size() < 2) return 1;
+    PriceSeries series;
+    series.reserve(file.size() * static_cast<std::size_t>(repeat));
+    const std::int64_t span = file.time.back() - file.time.front() + 86400;
+    for (int r = 0; r < repeat; r++) {
+        for (std::size_t i = 0; i < file.size(); i++) {
+            series.push(file.time[i] + r * span, file.open[i], file.high[i], file.low[i], file.close[i], file.volume[i]);
+        }
+    }
+    const std::vector<SmaParams> strategies = {{10, 50}, {20, 100}, {5, 30}, {50, 200}};
+
+    // Cost of one record() on the hot thread, writer draining alongside.
+    const std::size_t events = 1 << 22;
+    JournalWriter probe;
+    if (!probe.open(journal_path)) {
+        std::cerr << "Error: cannot write " << journal_path << std::endl;
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < events; i++) probe.record(JournalKind::Bar, 0, static_cast<std::int64_t>(i), 1.0);
+    const double record_seconds = secondsSince(start);
+    const std::uint64_t probe_stalls = probe.stalls();
+    probe.close();
+
+    // The live path without and with recording.
+    start = std::chrono::steady_clock::now();
+    std::vector<BacktestResult> plain;
+    for (const SmaParams& params : strategies) {
+        SmaCrossStrategy strategy(params);
+        Backtester backtester;
+        for (double close : series.close) backtester.onBar(close, strategy.onBar(close));
+        plain.push_back(backtester.result());
+    }
+    const double plain_seconds = secondsSince(start);
+
+    JournalWriter journal;
+    journal.open(journal_path);
+    start = std::chrono::steady_clock::now();
+    std::vector<BacktestResult> live = runRecordedBacktest(series.view(), strategies, {}, journal);
+    const double live_seconds = secondsSince(start);
+    journal.close();
+    const std::uint64_t recorded = journal.records();
+
+    JournalReader reader;
+    reader.open(journal_path);
+    std::cout << "Recorded " << recorded << " events (" << series.size() << " bars x " << strategies.size()
+              << " strategies) in " << reader.blockCount() << " blocks, "
+              << std::filesystem::file_size(journal_path) / (1 << 20) << " MiB" << std::endl;
+    std::cout << "record(): " << record_seconds / static_cast<double>(events) * 1e9 << " ns/event, "
+              << probe_stalls << " stalls" << std::endl;
+    std::cout << "Live path: " << plain_seconds * 1000.0 << " ms unrecorded, " << live_seconds * 1000.0
+              << " ms recorded (" << (live_seconds - plain_seconds) / static_cast<double>(recorded) * 1e9
+              << " ns/event added)" << std::endl;
+
+    bool ok = true;
+    for (std::size_t s = 0; s < strategies.size(); s++) ok = ok && sameResult(live[s], plain[s]);
+
+    start = std::chrono::steady_clock::now();
+    ReplayResult replay = replayJournal(journal_path, strategies, {});
+    const double replay_seconds = secondsSince(start);
+    for (std::size_t s = 0; s < strategies.size(); s++) ok = ok && sameResult(replay.results[s], live[s]);
+    ok = ok && replay.mismatches == 0 && replay.records == recorded;
+    const double steps = static_cast<double>(replay.bars * strategies.size());
+    std::cout << "Replay: " << replay_seconds * 1000.0 << " ms, "
+              << static_cast<double>(replay.records) / replay_seconds / 1e6 << "M events/s (" << steps / replay_seconds / 1e6 << "M strategy bars/s), " << replay.decisions
+              << " orders and fills, " << replay.mismatches << " mismatches" << std::endl;
+
+    ReplayOptions paced;
+    paced.speed = 1.0;
+    start = std::chrono::steady_clock::now();
+    replay = replayJournal(journal_path, strategies, {}, paced);
+    std::cout << "Replay at recorded pace: " << secondsSince(start) * 1000.0 << " ms (recorded in "
+              << live_seconds * 1000.0 << " ms), " << replay.mismatches << " mismatches" << std::endl;
+    ok = ok && replay.mismatches == 0;
+
+    std::vector<SmaParams> changed = strategies;
+    changed[1].slow += 1;
+    replay = replayJournal(journal_path, changed, {});
+    std::cout << "Replay with SMA " << changed[1].fast << "/" << changed[1].slow << " in place of " << strategies[1].fast
+              << "/" << strategies[1].slow << ": " << replay.mismatches << " mismatches, first at record "
+              << replay.first_mismatch << std::endl;
+    ok = ok && replay.mismatches > 0;
+    return ok ? 0 : 1;
+}
+
+// sma intrabar [csv] [stop %] [target %] [minutes]
+// Bracket exits on an SMA grid, settled from daily OHLC (stop assumed
+// first when a bar reaches both levels), lazily from minute bars only where
+// OHLC is ambiguous, and from the minute bars of every held day. The
+// minute bars are synthetic paths through each day's OHLC, written to a
+// mapped store first.
+int runIntrabar(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    BracketExits exits;
+    exits.stop_loss = (argc > 3 ? std::atof(argv[3]) : 0.4) / 100.0;
+    exits.take_profit = (argc > 4 ? std::atof(argv[4]) : 0.4) / 100.0;
+    std::string minutes_path = argc > 5 ? argv[5] : "sma.minutes";
+
+    PriceSeries daily = loadSeries(path);
+    if (daily.size() == 0) return 1;
+
+    // 390 one-minute bars from 09:30, along a path that starts at the open,
+    // touches the high and the low at random minutes and ends at the close.
+    constexpr int session = 390;
+    std::mt19937_64 random(11);
+    std::uniform_int_distribution<int> minute(1, session - 1);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    PriceSeries fine;
+    fine.reserve(daily.size() * session);
+    std::vector<double> points(session + 1);
+    for (std::size_t d = 0; d < daily.size(); d++) {
+        const double high = daily.high[d];
+        const double low = daily.low[d];
+        int at_high = minute(random);
+        int at_low = minute(random);
+        while (at_low == at_high) at_low = minute(random);
+        std::vector<std::pair<int, double>> anchors = {{0, daily.open[d]}, {at_high, high}, {at_low, low},
+                                                       {session, daily.close[d]}};
+        std::sort(anchors.begin(), anchors.end());
+        double walk = 0.0;
+        for (std::size_t a = 0; a + 1 < anchors.size(); a++) {
+            const auto [m0, p0] = anchors[a];
+            const auto [m1, p1] = anchors[a + 1];
+            for (int m = m0; m < m1; m++) {
+                // Linear between anchors plus a wiggle that is zero at both ends.
+                const double u = static_cast<double>(m - m0) / (m1 - m0);
+                walk = m == m0 ? 0.0 : walk + noise(random) * (high - low) * 0.02;
+                points[static_cast<std::size_t>(m)] = std::clamp(p0 + (p1 - p0) * u + walk * (1.0 - u), low, high);
+            }
+        }
+        points[session] = std::clamp(daily.close[d], low, high);
+        for (int m = 0; m < session; m++) {
+            const double o = points[static_cast<std::size_t>(m)];
+            const double c = points[static_cast<std::size_t>(m) + 1];
+            fine.push(daily.time[d] + 34200 + 60 * m, o, std::max(o, c), std::min(o, c), c, 0);
+        }
+    }
+    if (!MinuteStore::write(minutes_path, fine.view())) return 1;
+    MinuteStore store;
+    const bool mapped = store.open(minutes_path);
+    const std::size_t total_rows = fine.size();
+    fine = PriceSeries {};
+
+    std::vector<SmaParams> grid = makeSmaGrid(5, 50, 5, 20, 200, 20);
+    const IntrabarPolicy policies[] = {IntrabarPolicy::Full, IntrabarPolicy::Lazy, IntrabarPolicy::StopFirst};
+    const char* names[] = {"Minute bars", "Lazy", "OHLC, stop first"};
+    std::vector<std::vector<BacktestResult>> results(3);
+    IntrabarStats stats[3];
+    double seconds[3] {};
+    for (int p = 0; p < 3; p++) {
+        auto start = std::chrono::steady_clock::now();
+        for (const SmaParams& params : grid) {
+            results[static_cast<std::size_t>(p)].push_back(
+                runBracketBacktest(daily.view(), params, exits, policies[p], &store, &stats[p]));
+        }
+        seconds[p] = secondsSince(start);
+    }
+
+    std::cout << grid.size() << " SMA pairs, stop " << exits.stop_loss * 100.0 << "%, target "
+              << exits.take_profit * 100.0 << "%, " << total_rows << " minute bars ("
+              << store.fileBytes() / (1 << 20) << " MiB mapped" << (mapped ? "" : ", not available") << ")" << std::endl;
+    const IntrabarStats& lazy = stats[1];
+    const double held = static_cast<double>(std::max<std::size_t>(1, lazy.bars_checked));
+    std::cout << "Held days: " << lazy.bars_checked << ", ambiguous: " << lazy.ambiguous << " ("
+              << 100.0 * static_cast<double>(lazy.ambiguous) / held << "%)" << std::endl;
+    std::size_t mismatches = 0;
+    for (int p = 0; p < 3; p++) {
+        double error = 0.0;
+        std::size_t differ = 0;
+        for (std::size_t g = 0; g < grid.size(); g++) {
+            const double diff = std::abs(results[static_cast<std::size_t>(p)][g].total_return - results[0][g].total_return);
+            error += diff;
+            differ += diff != 0.0;
+        }
+        if (p == 1) mismatches = differ;
+        const double read_bytes = static_cast<double>(stats[p].fine_rows_read * MinuteStore::row_bytes);
+        std::cout << names[p] << ": " << seconds[p] * 1000.0 << " ms, " << stats[p].fine_scans << " days scanned, "
+                  << stats[p].fine_rows_read << " minute rows read (" << read_bytes / (1 << 20) << " MiB), "
+                  << stats[p].unresolved << " unresolved; " << differ << " runs differ from minute bars, mean |error| "
+                  << error / static_cast<double>(grid.size()) * 100.0 << " pts" << std::endl;
+    }
+    std::cout << "Lazy read " << 100.0 * static_cast<double>(stats[1].fine_rows_read) /
+                                     static_cast<double>(std::max<std::size_t>(1, stats[0].fine_rows_read))
+              << "% of the minute rows the minute-bar runs read" << std::endl;
+    std::cout << "Lazy vs minute-bar mismatches: " << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// sma numerics [csv] [repeat]
+// Running-sum drift of the SMA over the file's closes `repeat` times over,
+// the summation kernels' speed and error, and a parallel reduction at
+// several thread counts, naive and in fixed order.
+int runNumerics(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    const int repeat = argc > 3 ? std::max(1, std::atoi(argv[3])) : 400;
+
+    PriceSeries series = loadSeries(path);
+    if (series.size() < 2) return 1;
+    std::vector<double> closes;
+    for (int r = 0; r < repeat; r++) closes.insert(closes.end(), series.close.begin(), series.close.end());
+    const std::size_t n = closes.size();
+
+    // SMA 50 by RollingMean without and with re-anchoring, value by value and
+    // in blocks as the expression engine feeds it, by the rollingMean() column,
+    // and each window summed afresh as the reference. Best of 5 each.
+    const int window = 50;
+    auto bestOf = [](auto run) {
+        double seconds = 1e9;
+        for (int r = 0; r < 5; r++) {
+            auto begin = std::chrono::steady_clock::now();
+            run();
+            seconds = std::min(seconds, secondsSince(begin));
+        }
+        return seconds;
+    };
+    std::vector<double> drifting(n);
+    std::vector<double> streamed(n);
+    std::vector<double> blocked(n);
+    std::vector<double> column;
+    auto stream = [&](std::vector<double>& out, bool reanchor) {
+        RollingMean mean(window, reanchor);
+        for (std::size_t i = 0; i < n; i++) out[i] = mean.update(closes[i]);
+    };
+    const double drifting_seconds = bestOf([&] { stream(drifting, false); });
+    const double streamed_seconds = bestOf([&] { stream(streamed, true); });
+    const double blocked_seconds = bestOf([&] {
+        RollingMean mean(window);
+        for (std::size_t first = 0; first < n; first += 2048) {
+            mean.update(std::span<const double>(closes).subspan(first, std::min<std::size_t>(2048, n - first)),
+                        blocked.data() + first);
+        }
+    });
+    const double column_seconds = bestOf([&] { column = rollingMean(closes, window); });
+    double drifting_error = 0.0;
+    double anchored_error = 0.0;
+    for (std::size_t i = window - 1; i < n; i++) {
+        const double exact = compensatedSum(std::span<const double>(closes).subspan(i + 1 - window, window)) / window;
+        drifting_error = std::max(drifting_error, std::abs(drifting[i] - exact) / exact);
+        anchored_error = std::max(anchored_error, std::abs(streamed[i] - exact) / exact);
+    }
+    auto sameBits = [](double a, double b) { return std::bit_cast<std::uint64_t>(a) == std::bit_cast<std::uint64_t>(b); };
+    const bool blocked_matches = std::equal(blocked.begin(), blocked.end(), streamed.begin(), sameBits);
+    const bool column_matches = std::equal(column.begin(), column.end(), streamed.begin(), sameBits);
+    auto per_bar = [n](double seconds) { return seconds / static_cast<double>(n) * 1e9; };
+    std::cout << "SMA " << window << " over " << n << " bars, max rel error / ns per bar:" << std::endl;
+    std::cout << "  RollingMean, running sum only  " << drifting_error << "  " << per_bar(drifting_seconds) << std::endl;
+    std::cout << "  RollingMean, re-anchored       " << anchored_error << "  " << per_bar(streamed_seconds) << " ("
+              << (streamed_seconds / drifting_seconds - 1.0) * 100.0 << "%)" << std::endl;
+    std::cout << "  RollingMean, 2048-bar blocks   " << anchored_error << "  " << per_bar(blocked_seconds)
+              << (blocked_matches ? " (same bits)" : " (DIFFERS)") << std::endl;
+    std::cout << "  rollingMean() column           " << anchored_error << "  " << per_bar(column_seconds)
+              << (column_matches ? " (same bits)" : " (DIFFERS)") << std::endl;
+
+    // Summation kernels on values whose exact sum is known: pairs +x, -x
+    // that cancel, plus small multiples of 2^-20 summed exactly as integers.
+    const std::size_t count = 1 << 24;
+    std::mt19937_64 random(5);
+    std::uniform_real_distribution<double> big(-1e6, 1e6);
+    std::uniform_int_distribution<int> small(-1000, 1000);
+    std::vector<double> values(count);
+    long long units = 0;
+    for (std::size_t i = 0; i < count; i += 4) {
+        const double x = big(random);
+        const int a = small(random);
+        const int b = small(random);
+        values[i] = x;
+        values[i + 1] = std::ldexp(a, -20);
+        values[i + 2] = std::ldexp(b, -20);
+        values[i + 3] = -x;
+        units += a + b;
+    }
+    std::shuffle(values.begin(), values.end(), random);
+    const double exact = std::ldexp(static_cast<double>(units), -20);
+
+    std::chrono::steady_clock::time_point start;
+    struct Kernel {
+        const char* name;
+        double (*sum)(std::span<const double>);
+    };
+    const Kernel kernels[] = {
+        {"naive", [](std::span<const double> v) { return std::accumulate(v.begin(), v.end(), 0.0); }},
+        {"compensated", compensatedSum},
+        {"pairwise", pairwiseSum},
+    };
+    for (const Kernel& kernel : kernels) {
+        double best = 1e9;
+        double result = 0.0;
+        for (int r = 0; r < 5; r++) {
+            start = std::chrono::steady_clock::now();
+            result = kernel.sum(values);
+            best = std::min(best, secondsSince(start));
+        }
+        std::cout << "Sum of " << count << " (" << kernel.name << "): " << best * 1000.0 << " ms, "
+                  << static_cast<double>(count) / best / 1e9 << " G/s, error " << std::abs(result - exact) << std::endl;
+    }
+
+    // Sum of squared log returns on 1, 2 and 4 threads: one chunk per
+    // thread, summed naively, against the fixed-order reduction.
+    std::vector<double> returns(n - 1);
+    for (std::size_t i = 1; i < n; i++) returns[i - 1] = std::log(closes[i] / closes[i - 1]);
+    auto squares = [&](std::size_t first, std::size_t last) {
+        double s = 0.0;
+        for (std::size_t i = first; i < last; i++) s += returns[i] * returns[i];
+        return s;
+    };
+    std::set<std::uint64_t> naive_bits;
+    std::set<std::uint64_t> fixed_bits;
+    bool ok = true;
+    for (std::size_t threads : {1, 2, 4}) {
+        ThreadPool pool(threads);
+        double naive = 0.0;
+        double naive_seconds = 1e9;
+        double fixed = 0.0;
+        double fixed_seconds = 1e9;
+        for (int r = 0; r < 5; r++) {
+            start = std::chrono::steady_clock::now();
+            std::vector<double> partial(threads);
+            const std::size_t chunk = (returns.size() + threads - 1) / threads;
+            for (std::size_t t = 0; t < threads; t++) {
+                pool.submit([&, t] {
+                    partial[t] = squares(std::min(returns.size(), t * chunk), std::min(returns.size(), (t + 1) * chunk));
+                });
+            }
+            pool.wait();
+            naive = std::accumulate(partial.begin(), partial.end(), 0.0);
+            naive_seconds = std::min(naive_seconds, secondsSince(start));
+
+            start = std::chrono::steady_clock::now();
+            fixed = reduceDeterministic<double>(&pool, returns.size(), 1 << 14, squares, std::plus<>());
+            fixed_seconds = std::min(fixed_seconds, secondsSince(start));
+        }
+        naive_bits.insert(std::bit_cast<std::uint64_t>(naive));
+        fixed_bits.insert(std::bit_cast<std::uint64_t>(fixed));
+        std::cout << threads << " threads: naive " << std::setprecision(17) << naive << " (" << std::setprecision(6)
+                  << naive_seconds * 1000.0 << " ms), fixed order " << std::setprecision(17) << fixed << " ("
+                  << std::setprecision(6) << fixed_seconds * 1000.0 << " ms)" << std::endl;
+
+        // Sweeps are per strategy, so already independent of the thread count.
+        std::vector<SmaParams> grid = makeSmaGrid(2, 50, 4, 10, 200, 20);
+        static std::vector<BacktestResult> reference;
+        std::vector<BacktestResult> results = runSmaSweepBatched(series.view(), grid, {}, 8, &pool);
+        if (reference.empty()) reference = results;
+        for (std::size_t i = 0; i < grid.size(); i++) ok = ok && sameResult(results[i], reference[i]);
+    }
+    ok = ok && fixed_bits.size() == 1;
+    std::cout << "Distinct results across thread counts: naive " << naive_bits.size() << ", fixed order "
+              << fixed_bits.size() << "; sweeps " << (ok ? "identical" : "DIFFER") << std::endl;
+    return ok && blocked_matches && column_matches ? 0 : 1;
+}
+
+// sma normalize [csv] [symbols] [years]
+// Converts synthetic symbols quoted in eight currencies to the base currency
+// with daily FX fixes, and deflates them by a monthly CPI published a month
+// late (base 100). Times join-then-gather over whole columns against the
+// fused stage, and a plain scaling pass over the same bytes as the
+// bandwidth floor.
+int runNormalize(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    const std::size_t symbols = argc > 3 ? static_cast<std::size_t>(std::max(1, std::atoi(argv[3]))) : 500;
+    const std::size_t bars = 252 * static_cast<std::size_t>(argc > 4 ? std::max(1, std::atoi(argv[4])) : 20);
+    constexpr std::int64_t day = 86400;
+    constexpr std::size_t currencies = 8;
+
+    PriceSeries series = loadSeries(path);
+    if (series.size() < 2) return 1;
+    std::vector<std::int64_t> time(bars);
+    for (std::size_t t = 0; t < bars; t++) time[t] = series.time.front() + static_cast<std::int64_t>(t) * day;
+
+    // FX fixes at 16:00 each day, so a bar sees the previous day's fix.
+    std::mt19937_64 random(42);
+    std::normal_distribution<double> noise(0.0, 0.005);
+    std::vector<std::int64_t> fx_time(bars + 1);
+    for (std::size_t t = 0; t <= bars; t++) fx_time[t] = time.front() - day + static_cast<std::int64_t>(t) * day + 57600;
+    std::vector<std::vector<double>> fx(currencies, std::vector<double>(bars + 1));
+    for (std::size_t c = 0; c < currencies; c++) {
+        double rate = 0.5 + static_cast<double>(c) * 0.25;
+        for (double& v : fx[c]) v = (rate *= std::exp(noise(random)));
+    }
+    // CPI every 30 days, usable 30 days after its stamp; the first year is missing.
+    std::vector<std::int64_t> cpi_time;
+    std::vector<double> cpi;
+    for (std::int64_t t = time.front() + 335 * day; t <= time.back(); t += 30 * day) {
+        cpi_time.push_back(t);
+        cpi.push_back(100.0 * std::pow(1.002, static_cast<double>(cpi.size())));
+    }
+
+    std::vector<RateSeries> rates;
+    for (std::size_t c = 0; c < currencies; c++) rates.push_back({fx_time, fx[c], 0, false});
+    rates.push_back({cpi_time, cpi, 30 * day, true});
+
+    std::vector<double> nominal(symbols * bars);
+    for (std::size_t s = 0; s < symbols; s++) {
+        for (std::size_t t = 0; t < bars; t++) {
+            nominal[s * bars + t] = series.close[(t + s) % series.size()] * static_cast<double>(1 + s % 7);
+        }
+    }
+    auto column = [&](std::vector<double>& data, std::size_t s) { return std::span(data).subspan(s * bars, bars); };
+    const double megabytes = static_cast<double>(2 * nominal.size() * sizeof(double)) / 1e6; // read + write
+
+    // Whole-column index maps and gathered rates, then the arithmetic.
+    std::vector<double> expected(nominal.size());
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::int32_t> cpi_index = asOfJoin(time, cpi_time, 30 * day);
+    for (std::size_t s = 0; s < symbols; s++) {
+        std::vector<double> rate = gatherAsOf(fx[s % currencies], asOfJoin(time, fx_time));
+        std::vector<double> deflator = gatherAsOf(cpi, cpi_index);
+        std::span<double> in = column(nominal, s);
+        std::span<double> out = column(expected, s);
+        for (std::size_t t = 0; t < bars; t++) out[t] = in[t] * rate[t] / deflator[t] * 100.0;
+    }
+    const double naive = secondsSince(start);
+
+    std::vector<NormalizeColumn> columns;
+    std::vector<double> real(nominal.size());
+    for (std::size_t s = 0; s < symbols; s++) {
+        columns.push_back({time, column(nominal, s), column(real, s), {s % currencies, currencies}, 100.0});
+    }
+    auto best = [&](ThreadPool* pool) {
+        double seconds = 1e9;
+        for (int r = 0; r < 5; r++) {
+            auto begin = std::chrono::steady_clock::now();
+            normalizeColumns(rates, columns, pool);
+            seconds = std::min(seconds, secondsSince(begin));
+        }
+        return seconds;
+    };
+    const double fused = best(nullptr);
+    ThreadPool pool(0);
+    const double parallel = best(&pool);
+
+    double floor = 1e9;
+    std::vector<double> scaled(nominal.size());
+    for (int r = 0; r < 5; r++) {
+        auto begin = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < nominal.size(); i++) scaled[i] = nominal[i] * 100.0;
+        floor = std::min(floor, secondsSince(begin));
+    }
+
+    std::size_t mismatches = 0;
+    std::size_t missing = 0;
+    double max_error = 0.0;
+    for (std::size_t i = 0; i < real.size(); i++) {
+        if (std::isnan(real[i]) != std::isnan(expected[i])) mismatches++;
+        if (std::isnan(real[i])) {
+            missing++;
+            continue;
+        }
+        max_error = std::max(max_error, std::abs(real[i] - expected[i]) / std::abs(expected[i]));
+    }
+    if (max_error > 1e-14) mismatches++;
+
+    std::cout << "Normalize " << symbols << " columns x " << bars << " bars through " << rates.size() << " rates ("
+              << megabytes << " MB moved)" << std::endl;
+    auto report = [&](const char* label, double seconds) {
+        std::cout << "  " << std::left << std::setw(20) << label << std::right << seconds * 1000.0 << " ms, "
+                  << megabytes / 1000.0 / seconds << " GB/s" << std::endl;
+    };
+    report("join + gather", naive);
+    report("fused", fused);
+    report("fused, pool", parallel);
+    report("scale only", floor);
+    std::cout << "Rows before the first CPI: " << missing << ", max relative difference " << max_error
+              << ", mismatches: " << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// sma results [csv] [rows] [table]
+// Sweeps a (fast, slow) grid over the file into a result table, pads it to
+// `rows` with Monte Carlo style paths (the sweep's results with noise), saves
+// it, maps it back and times filter, top-k and Pareto queries on the mapping,
+// checked against brute-force answers. Draws mean return over the grid as
+// `table`.svg straight from the mapped columns.
+int runResults(int argc, char** argv) {
+    std::string path = argc > 2 ? argv[2] : default_data;
+    const std::size_t target_rows = argc > 3 ? static_cast<std::size_t>(std::max(1, std::atoi(argv[3]))) : 10000000;
+    std::string table_path = argc > 4 ? argv[4] : "sma.results";
+
+    PriceSeries series = loadSeries(path);
+    if (series.size() < 2) return 1;
+    ThreadPool pool(0);
+    const std::vector<SmaParams> grid = makeSmaGrid(2, 100, 1, 5, 300, 5);
+    auto start = std::chrono::steady_clock::now();
+    const std::vector<BacktestResult> swept = runSmaSweepBatched(series.view(), grid, {}, 8, &pool);
+    const double sweep_seconds = secondsSince(start);
+
+    ResultTable built(ResultTable::sweepColumns());
+    start = std::chrono::steady_clock::now();
+    built.reserve(std::max(target_rows, grid.size()));
+    built.appendSweep(grid, swept);
+    std::mt19937_64 random(42);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    for (std::size_t p = 1; built.rows() < target_rows; p++) {
+        for (std::size_t i = 0; i < grid.size() && built.rows() < target_rows; i++) {
+            const BacktestResult& r = swept[i];
+            const double bars = std::max(1, r.bars);
+            const double total_return = (1.0 + r.total_return) * std::exp(0.1 * noise(random)) - 1.0;
+            const double drawdown = std::min(1.0, r.max_drawdown * std::exp(0.2 * noise(random)));
+            const double trades = std::max(0.0, std::round(r.trades + std::sqrt(r.trades) * noise(random)));
+            const double row[] = {static_cast<double>(grid[i].fast), static_cast<double>(grid[i].slow),
+                                  static_cast<double>(p), total_return, drawdown, trades, trades * 252.0 / bars,
+                                  r.bars_in_market / bars, 10000.0 * (1.0 + total_return)};
+            built.appendRow(row);
+        }
+    }
+    const double fill_seconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    if (!built.save(table_path)) return 1;
+    const double save_seconds = secondsSince(start);
+
+    ResultTable table;
+    start = std::chrono::steady_clock::now();
+    if (!table.open(table_path)) return 1;
+    const double open_seconds = secondsSince(start);
+    std::cout << "Sweep of " << grid.size() << " pairs: " << sweep_seconds * 1000.0 << " ms; table of "
+              << table.rows() << " rows x " << table.columns() << " columns built in " << fill_seconds * 1000.0
+              << " ms, saved in " << save_seconds * 1000.0 << " ms, mapped in " << open_seconds * 1000.0 << " ms"
+              << std::endl;
+
+    const std::size_t ret = table.find("total_return");
+    const std::size_t dd = table.find("max_drawdown");
+    const std::size_t turnover = table.find("turnover");
+    const RowFilter filters[] = {{dd, -1.0, 0.2}};
+    const RowFilter gaining[] = {{ret, 0.0}};
+    const ParetoAxis axes[] = {{ret, true}, {dd, false}, {turnover, false}};
+    constexpr std::size_t k = 100;
+
+    std::vector<std::uint32_t> kept;
+    std::vector<std::uint32_t> kept_gaining;
+    std::vector<std::uint32_t> best;
+    std::vector<std::uint32_t> best_kept;
+    std::vector<std::uint32_t> front;
+    for (ThreadPool* on : {static_cast<ThreadPool*>(nullptr), &pool}) {
+        auto timed = [](auto query) {
+            double seconds = 1e9;
+            for (int r = 0; r < 3; r++) {
+                auto begin = std::chrono::steady_clock::now();
+                query();
+                seconds = std::min(seconds, secondsSince(begin));
+            }
+            return seconds * 1000.0;
+        };
+        const double filter_ms = timed([&] { kept = filterRows(table, filters, nullptr, on); });
+        const double narrow_ms = timed([&] { kept_gaining = filterRows(table, gaining, &kept, on); });
+        const double top_ms = timed([&] { best = topK(table, ret, k, true, nullptr, on); });
+        const double top_kept_ms = timed([&] { best_kept = topK(table, ret, k, true, &kept, on); });
+        const double front_ms = timed([&] { front = paretoFront(table, axes, nullptr, on); });
+        std::cout << (on == nullptr ? "1 thread: " : "Pool:     ") << "drawdown < 20% " << filter_ms << " ms ("
+                  << kept.size() << " rows), of those gaining " << narrow_ms << " ms (" << kept_gaining.size()
+                  << " rows), top " << k << " return " << top_ms << " ms, top " << k
+                  << " of those " << top_kept_ms << " ms, Pareto front " << front_ms << " ms (" << front.size()
+                  << " rows)" << std::endl;
+    }
+
+    // Brute-force answers: a full scan per filter, a partial sort per top-k,
+    // and every row beaten by a front row or on the front itself.
+    std::size_t mismatches = 0;
+    const std::span<const double> returns = table.column(ret);
+    const std::span<const double> drawdowns = table.column(dd);
+    const std::span<const double> turnovers = table.column(turnover);
+    std::vector<std::uint32_t> expected_kept;
+    for (std::size_t i = 0; i < table.rows(); i++) {
+        if (drawdowns[i] >= -1.0 && drawdowns[i] < 0.2) expected_kept.push_back(static_cast<std::uint32_t>(i));
+    }
+    if (kept != expected_kept) mismatches++;
+    std::vector<std::uint32_t> expected_gaining;
+    for (std::uint32_t id : expected_kept) {
+        if (returns[id] >= 0.0) expected_gaining.push_back(id);
+    }
+    if (kept_gaining != expected_gaining) mismatches++;
+    auto expectedTop = [&](std::vector<std::uint32_t> ids) {
+        const std::size_t keep = std::min(k, ids.size());
+        std::partial_sort(ids.begin(), ids.begin() + static_cast<std::ptrdiff_t>(keep), ids.end(),
+                          [&](std::uint32_t a, std::uint32_t b) {
+                              return returns[a] > returns[b] || (returns[a] == returns[b] && a < b);
+                          });
+        ids.resize(keep);
+        return ids;
+    };
+    std::vector<std::uint32_t> all(table.rows());
+    std::iota(all.begin(), all.end(), 0u);
+    if (best != expectedTop(all)) mismatches++;
+    if (best_kept != expectedTop(expected_kept)) mismatches++;
+    auto beats = [&](std::uint32_t a, std::uint32_t b) {
+        const bool no_worse = returns[a] >= returns[b] && drawdowns[a] <= drawdowns[b] && turnovers[a] <= turnovers[b];
+        return no_worse && (returns[a] > returns[b] || drawdowns[a] < drawdowns[b] || turnovers[a] < turnovers[b]);
+    };
+    std::vector<char> on_front(table.rows(), 0);
+    for (std::uint32_t f : front) on_front[f] = 1;
+    for (std::size_t i = 0; i < table.rows(); i++) {
+        const auto id = static_cast<std::uint32_t>(i);
+        bool beaten = false;
+        for (std::uint32_t f : front) beaten = beaten || beats(f, id);
+        if (beaten == static_cast<bool>(on_front[i])) mismatches++;
+    }
+    std::cout << "Checked against brute force, mismatches: " << mismatches << std::endl;
+
+    const std::string svg_path = table_path + ".svg";
+    start = std::chrono::steady_clock::now();
+    const HeatmapSpec spec {table.find("fast"), table.find("slow"), ret, "Mean total return, fast & slow"};
+    const bool drawn = writeHeatmap(table, spec, svg_path);
+    if (drawn) std::cout << "Heatmap " << svg_path << " in " << secondsSince(start) * 1000.0 << " ms" << std::endl;
+    return mismatches == 0 && drawn ? 0 : 1;
+}
+
+void printUsage() {
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  sma run [csv] [fast slow]...   streaming SMA crossover backtest" << std::endl;
+    std::cout << "  sma sweep [csv] [lanes] [threads]   SMA grid, scalar vs batched kernel" << std::endl;
+    std::cout << "  sma pool-bench [csv] [threads] [rounds] [nodes]   pinned vs unpinned thread pool" << std::endl;
+    std::cout << "  sma shard-sweep [csv] [workers] [crash shard] [slow worker]   sweep over worker processes" << std::endl;
+    std::cout << "  sma cached-sweep [csv] [cache] [fast_max] [slow_max]   sweep through the result cache" << std::endl;
+    std::cout << "  sma update [csv] [state] [fast slow]...   incremental run over appended bars" << std::endl;
+    std::cout << "  sma publish [symbol csv]...   serve files from shared memory until interrupted" << std::endl;
+    std::cout << "  sma attach [symbol] [fast slow]...   backtest a published symbol" << std::endl;
+    std::cout << "  sma serve [socket] [csv]...   resident backtest server on a Unix socket" << std::endl;
+    std::cout << "  sma client [socket] [requests] [pairs] [in flight]   load test a running server" << std::endl;
+    std::cout << "  sma asof [csv] [minutes per bar]   align intraday bars to daily bars" << std::endl;
+    std::cout << "  sma rolling-cov [csv] [assets] [window]   incremental vs from-scratch covariance" << std::endl;
+    std::cout << "  sma excursions [csv] [threads]   MAE/MFE of every trade of an SMA grid" << std::endl;
+    std::cout << "  sma rolling-quantile [csv] [window]...   rolling median/rank/bands vs sorting each window" << std::endl;
+    std::cout << "  sma ring-bench [count]   ring buffers against std::deque and BoundedQueue" << std::endl;
+    std::cout << "  sma alloc-profile [csv] [leak]   heap profile of a sweep (build with -DSMA_ALLOC_PROFILER)" << std::endl;
+    std::cout << "  sma rotation [csv] [symbols] [years] [k]   cross-sectional top-k rotation" << std::endl;
+    std::cout << "  sma optimize [csv] [threads] [seeds] [budget]   CMA-ES with successive halving vs the full grid" << std::endl;
+    std::cout << "  sma journal [csv] [journal] [repeat]   record a live run, replay and check it" << std::endl;
+    std::cout << "  sma intrabar [csv] [stop %] [target %] [minutes]   bracket fills from OHLC, lazily from minute bars" << std::endl;
+    std::cout << "  sma numerics [csv] [repeat]   SMA drift, summation kernels, fixed-order reduction" << std::endl;
+    std::cout << "  sma normalize [csv] [symbols] [years]   FX conversion and CPI deflation of many columns" << std::endl;
+    std::cout << "  sma results [csv] [rows] [table]   columnar result table: filter, top-k, Pareto, heatmap" << std::endl;
+    std::cout << "  sma validate [csv] [keep|drop|merge] [fill] [repair] [days=012345] [short=0] [copies]   anomaly report"
+              << std::endl;
+    std::cout << "  sma expr [csv] [rule]...       backtest an expression rule, e.g." << std::endl;
+    std::cout << "                                 \"sma(close,10) > sma(close,50) and rsi(close,14) < 70\"" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string mode = argc > 1 ? argv[1] : "run";
+
+    if (mode == "run") return runStreaming(argc, argv);
+    if (mode == "sweep") return runSweep(argc, argv);
+    if (mode == "expr") return runExpression(argc, argv);
+    if (mode == "cached-sweep") return runCachedSweep(argc, argv);
+    if (mode == "shard-sweep") return runShardSweep(argc, argv);
+    if (mode == "pool-bench") return runPoolBench(argc, argv);
+    if (mode == "update") return runUpdate(argc, argv);
+    if (mode == "asof") return runAsOf(argc, argv);
+    if (mode == "rolling-cov") return runRollingCov(argc, argv);
+    if (mode == "excursions") return runExcursions(argc, argv);
+    if (mode == "rolling-quantile") return runRollingQuantile(argc, argv);
+    if (mode == "ring-bench") return runRingBench(argc, argv);
+    if (mode == "alloc-profile") return runAllocProfile(argc, argv);
+    if (mode == "rotation") return runRotation(argc, argv);
+    if (mode == "optimize") return runOptimize(argc, argv);
+    if (mode == "journal") return runJournal(argc, argv);
+    if (mode == "intrabar") return runIntrabar(argc, argv);
+    if (mode == "numerics") return runNumerics(argc, argv);
+    if (mode == "normalize") return runNormalize(argc, argv);
+    if (mode == "results") return runResults(argc, argv);
+    if (mode == "validate") return runValidate(argc, argv);
+    if (mode == "publish") return runPublish(argc, argv);
+    if (mode == "attach") return runAttach(argc, argv);
+    if (mode == "serve") return runServe(argc, argv);
+    if (mode == "client") return runClient(argc, argv);
+
+    printUsage();
+    return 1;
+}